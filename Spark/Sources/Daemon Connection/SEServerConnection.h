@@ -32,6 +32,9 @@ NSString * const SEServerStatusDidChangeNotification;
 
 - (UInt32)version;
 
+/* daemon runtime metrics (nil if not available) */
+- (NSDictionary *)metrics;
+
 @end
 
 SPARK_PRIVATE
@@ -94,6 +94,17 @@ BOOL SEDaemonTerminate(NSRunningApplication *daemon) {
   return -1;
 }
 
+- (NSDictionary *)metrics {
+  if ([self isConnected] && [self.server respondsToSelector:@selector(metrics)]) {
+    @try {
+      return [self.server metrics];
+    } @catch (id exception) {
+      SPXLogException(exception);
+    }
+  }
+  return nil;
+}
+
 - (void)restart {
   if ([self isConnected]) {
     se_scFlags.restart = 1;
@@ -163,10 +174,17 @@ BOOL SEDaemonTerminate(NSRunningApplication *daemon) {
 
 /* MUST be called after connection */
 - (void)configure {
-  if (!se_sync)
-    se_sync = [[SparkLibrarySynchronizer alloc] initWithLibrary:SparkActiveLibrary()];
-  
-  [se_sync setDistantLibrary:[se_server library]];
+  if (se_sync) {
+    [se_sync setDistantLibrary:[se_server library]];
+  } else {
+    /* the active library may still be loading */
+    SparkLoadActiveLibrary(^(SparkLibrary *library, NSError *error) {
+      if (library && !self->se_sync && [self isConnected]) {
+        self->se_sync = [[SparkLibrarySynchronizer alloc] initWithLibrary:library];
+        [self->se_sync setDistantLibrary:[self->se_server library]];
+      }
+    });
+  }
 }
 
 - (BOOL)isConnected {
@@ -7,6 +7,7 @@
  */
 
 #import <WonderBox/WBTableView.h>
+#import <WonderBox/WBImageAndTextCell.h>
 
 @class SETriggerTable;
 @protocol SETriggerTableDelegate <WBTableViewDelegate>
@@ -21,3 +22,8 @@
 @property(assign) id<SETriggerTableDelegate> delegate;
 
 @end
+
+/* Name cell: does not pull the entry icon synchronously, it is set by the table delegate */
+@interface SETriggerCell : WBImageAndTextCell
+
+@end
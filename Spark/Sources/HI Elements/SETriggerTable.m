@@ -8,6 +8,8 @@
 
 #import "SETriggerTable.h"
 
+#import <SparkKit/SparkEntry.h>
+
 @implementation SETriggerTable
 
 - (id<SETriggerTableDelegate>)delegate { return (id<SETriggerTableDelegate>)[super delegate]; }
@@ -167,3 +169,16 @@
 }
 
 @end
+
+@implementation SETriggerCell
+
+- (void)setObjectValue:(id)anObject {
+  if ([anObject isKindOfClass:[SparkEntry class]]) {
+    /* the image is provided by the icon loader */
+    [super setObjectValue:[anObject name]];
+  } else {
+    [super setObjectValue:anObject];
+  }
+}
+
+@end
@@ -82,6 +82,7 @@
     se_library = aLibrary;
     [self reload];
     if (se_library) {
+      se_library.postsLegacyNotifications = YES;
       [se_library.notificationCenter addObserver:self
                                         selector:@selector(didAddApplication:)
                                             name:SparkObjectSetDidAddObjectNotification
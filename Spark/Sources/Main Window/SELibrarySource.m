@@ -101,9 +101,13 @@
     if ([plugin isEnabled]) {
       SEEntryList *list = [[SEEntryList alloc] initWithName:[plugin name] icon:[plugin icon]];
       [list setDocument:[self document]];
-      list.filter = ^bool(SparkList *_, SparkEntry *entry) {
-        return [entry.action isKindOfClass:[plugin actionClass]];
-      };
+      /* only entries of this plugin are sent to the list.
+       Match on the identifier, so the plugin code is not loaded (the loader caches the lookup) */
+      NSString *identifier = plugin.identifier;
+      SparkActionLoader *loader = [SparkActionLoader sharedLoader];
+      [list setFilter:^bool(SparkList *_, SparkEntry *entry) {
+        return [[loader plugInForAction:entry.action].identifier isEqualToString:identifier];
+      } kind:kSparkListFilterActionClass value:plugin.actionClassName];
       [list setGroup:3];
       [se_plugins setObject:plugin forKey:list];
       
@@ -182,6 +186,7 @@
   if (se_library) {
     [self buildLists];
     /* Register for notifications */
+    [se_library setPostsLegacyNotifications:YES];
     [[se_library notificationCenter] addObserver:self
                                         selector:@selector(applicationDidChange:)
                                             name:SEApplicationDidChangeNotification
@@ -452,17 +457,17 @@
 	/* refresh */
 	SparkApplication *previous = [[aNotification userInfo] objectForKey:SEPreviousApplicationKey];
 	if (!previous || ![[[[aNotification object] library] applicationSet] containsObject:previous]) {
-		[[self selectedObject] snapshot];
+		[[self selectedObject] refresh];
 	} else {
 		/* Reload when switching to/from global */
 		if ([application uid] == 0 || [previous uid] == 0) {
-			[[self selectedObject] snapshot];
+			[[self selectedObject] refresh];
 		} else {
 			/* Reload if previous or current contains custom entries */
 			SparkEntryManager *manager = [[[aNotification object] library] entryManager];
 			if ([manager containsEntryForApplication:previous] || [manager containsEntryForApplication:application]) {
 				/* I don't understand why snapshot does not trigger a reload in trigger controller, so force it to reload */
-				[[self selectedObject] snapshot];
+				[[self selectedObject] refresh];
 			}
 		}
 	}
@@ -496,7 +501,13 @@
 }
 
 - (void)reloadSelection:(NSNotification *)aNotification {
-	[[self selectedObject] snapshot];
+  /* only the entry row changed, other lists are updated when selected */
+  SEEntryList *selection = [self selectedObject];
+  for (SEEntryList *list in [self arrangedObjects]) {
+    if (list != selection)
+      [list setNeedsReload:YES];
+  }
+	[selection refreshEntry:SparkNotificationObject(aNotification)];
 }
 
 @end
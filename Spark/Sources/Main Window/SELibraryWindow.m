@@ -30,7 +30,12 @@
 #import <WonderBox/NSImage+WonderBox.h>
 #import <WonderBox/NSArrayController+WonderBox.h>
 
-@implementation SELibraryWindow
+@implementation SELibraryWindow {
+@private
+  /* displayed while the library is loading */
+  NSProgress *se_progress;
+  NSProgressIndicator *se_indicator;
+}
 
 - (id)init {
   if (self = [super initWithWindowNibName:@"SELibraryWindow"]) {
@@ -53,6 +58,7 @@
 
 - (void)dealloc {
   [[NSNotificationCenter defaultCenter] removeObserver:self];
+  [self se_stopLoadingIndicator];
   [self setLibrary:nil];
 }
 
@@ -66,9 +72,53 @@
 - (void)windowDidLoad {
   [[self window] center];
   [[self window] setFrameAutosaveName:@"SparkMainWindow"];
+  /* library still loading */
+  NSProgress *progress = [[self document] loadingProgress];
+  if (progress && ![self library])
+    [self se_startLoadingIndicator:progress];
   [[self window] display];
 }
 
+#pragma mark Loading
+- (void)se_startLoadingIndicator:(NSProgress *)progress {
+  NSView *content = [[self window] contentView];
+  NSRect frame = NSMakeRect(0, 0, 240, 20);
+  frame.origin.x = NSMidX([content bounds]) - NSWidth(frame) / 2;
+  frame.origin.y = NSMidY([content bounds]) - NSHeight(frame) / 2;
+  se_indicator = [[NSProgressIndicator alloc] initWithFrame:NSIntegralRect(frame)];
+  [se_indicator setStyle:NSProgressIndicatorBarStyle];
+  [se_indicator setIndeterminate:NO];
+  [se_indicator setMinValue:0];
+  [se_indicator setMaxValue:1];
+  [se_indicator setDoubleValue:[progress fractionCompleted]];
+  [se_indicator setAutoresizingMask:NSViewMinXMargin | NSViewMaxXMargin | NSViewMinYMargin | NSViewMaxYMargin];
+  [content addSubview:se_indicator positioned:NSWindowAbove relativeTo:nil];
+  
+  se_progress = progress;
+  [se_progress addObserver:self forKeyPath:@"fractionCompleted" options:0 context:nil];
+}
+
+- (void)se_stopLoadingIndicator {
+  if (se_progress) {
+    [se_progress removeObserver:self forKeyPath:@"fractionCompleted"];
+    se_progress = nil;
+  }
+  [se_indicator removeFromSuperview];
+  se_indicator = nil;
+}
+
+- (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary *)change context:(void *)context {
+  if (object == se_progress && [@"fractionCompleted" isEqualToString:keyPath]) {
+    /* the library is loaded in background */
+    double fraction = [object fractionCompleted];
+    dispatch_async(dispatch_get_main_queue(), ^{
+      [self->se_indicator setDoubleValue:fraction];
+    });
+  } else {
+    [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
+  }
+}
+
 - (void)setLibrary:(SparkLibrary *)aLibrary {
   if (_library != aLibrary) {
     if (_library) {
@@ -247,6 +297,7 @@
 
 /* Notification handler */
 - (void)libraryDidChange:(NSNotification *)aNotification {
+  [self se_stopLoadingIndicator];
   [self setLibrary:[[aNotification object] library]];
   
   /* Load applications */
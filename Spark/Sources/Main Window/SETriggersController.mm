@@ -13,6 +13,8 @@
 #import "SEPreferences.h"
 #import "SEEntryEditor.h"
 #import "SEEntryList.h"
+#import "SESearchIndex.h"
+#import "SEIconLoader.h"
 #import "Spark.h"
 
 #import <SparkKit/SparkLibrary.h>
@@ -44,7 +46,11 @@ NSString * sSEHiddenPluggedObserverKey = nil;
 - (void)setActive:(BOOL)active;
 @end
 
-@implementation SETriggersController
+@implementation SETriggersController {
+@private
+  SEIconLoader *se_icons;
+  BOOL se_redisplay;
+}
 
 + (void)initialize {
   if ([SETriggersController class] == self) {
@@ -89,6 +95,7 @@ NSString * sSEHiddenPluggedObserverKey = nil;
 
 - (void)dealloc {
 	//[self setSelectedList:nil];
+  [[NSNotificationCenter defaultCenter] removeObserver:self];
   [[NSUserDefaultsController sharedUserDefaultsController] removeObserver:self
                                                                forKeyPath:sSEHiddenPluggedObserverKey];
 }
@@ -101,7 +108,12 @@ NSString * sSEHiddenPluggedObserverKey = nil;
   return [ibWindow application];
 }
 
+- (SESearchIndex *)searchIndex {
+  return [(SELibraryDocument *)[ibWindow document] searchIndex];
+}
+
 - (void)awakeFromNib {
+  __weak SETriggersController *weakSelf = self;
   self.filterBlock = ^BOOL(NSString *search, SparkEntry *entry) {
     /* Hide unplugged if needed */
     if ([[NSUserDefaults standardUserDefaults] boolForKey:kSEPreferencesHideDisabled] && ![entry isPlugged])
@@ -110,6 +122,10 @@ NSString * sSEHiddenPluggedObserverKey = nil;
     if (!search)
       return YES;
 
+    SESearchIndex *index = [weakSelf searchIndex];
+    if (index)
+      return [index entry:entry matchesSearch:search];
+
     if ([[entry name] rangeOfString:search options:NSCaseInsensitiveSearch].location != NSNotFound)
       return YES;
 
@@ -132,6 +148,46 @@ NSString * sSEHiddenPluggedObserverKey = nil;
   
   [uiTable setVerticalMotionCanBeginDrag:YES];
   [uiTable setContinueEditing:NO];
+
+  /* Icons are decoded in background, and rows near the viewport are prefetched */
+  se_icons = [[SEIconLoader alloc] initWithIconSize:NSMakeSize(16, 16)];
+  se_icons.placeholder = [[NSImage alloc] initWithSize:NSMakeSize(16, 16)];
+  se_icons.iconDidLoad = ^(SparkEntry *entry) {
+    [weakSelf iconDidLoad];
+  };
+  NSClipView *clip = [[uiTable enclosingScrollView] contentView];
+  [clip setPostsBoundsChangedNotifications:YES];
+  [[NSNotificationCenter defaultCenter] addObserver:self
+                                           selector:@selector(tableViewDidScroll:)
+                                               name:NSViewBoundsDidChangeNotification
+                                             object:clip];
+}
+
+- (void)iconDidLoad {
+  /* coalesce redisplay of rows loaded in the same run loop cycle */
+  if (se_redisplay)
+    return;
+  se_redisplay = YES;
+  dispatch_async(dispatch_get_main_queue(), ^{
+    self->se_redisplay = NO;
+    [self->uiTable setNeedsDisplayInRect:[self->uiTable visibleRect]];
+  });
+}
+
+- (void)tableViewDidScroll:(NSNotification *)aNotification {
+  NSUInteger count = [self count];
+  NSRange visible = [uiTable rowsInRect:[uiTable visibleRect]];
+  if (!count || !visible.length)
+    return;
+  /* one page above and below. visible rows are loaded when drawn */
+  NSUInteger start = visible.location > visible.length ? visible.location - visible.length : 0;
+  NSUInteger end = MIN(NSMaxRange(visible) + visible.length, count);
+  NSMutableArray *entries = [[NSMutableArray alloc] initWithCapacity:end - start];
+  for (NSUInteger idx = start; idx < end; idx++) {
+    if (!NSLocationInRange(idx, visible))
+      [entries addObject:[self objectAtIndex:idx]];
+  }
+  [se_icons prefetchEntries:entries];
 }
 
 - (NSView *)tableView {
@@ -141,6 +197,7 @@ NSString * sSEHiddenPluggedObserverKey = nil;
 - (void)setListEnabled:(BOOL)flag {
   SparkUID app = [[self application] uid];
 	SparkEntryManager *manager = [[self library] entryManager];
+  [[self library] beginTransaction];
 	for (NSUInteger idx = 0, count = [self count]; idx < count; idx++) {
     SparkEntry *entry = [self objectAtIndex:idx];
     if ([[entry application] uid] == app) {
@@ -153,6 +210,7 @@ NSString * sSEHiddenPluggedObserverKey = nil;
 			}
     }
   }
+  [[self library] commitTransaction];
 }
 
 - (IBAction)search:(id)sender {
@@ -230,6 +288,10 @@ NSString * sSEHiddenPluggedObserverKey = nil;
 
 - (void)tableView:(NSTableView *)aTableView willDisplayCell:(id)aCell forTableColumn:(NSTableColumn *)aTableColumn row:(NSInteger)rowIndex {
   SparkEntry *entry = [self objectAtIndex:rowIndex];
+
+  /* Icon: placeholder until loaded */
+  if ([aCell isKindOfClass:[SETriggerCell class]])
+    [aCell setImage:[se_icons iconForEntry:entry]];
   
   /* Text field cell */
   if ([aCell respondsToSelector:@selector(setTextColor:)]) {  
@@ -9,7 +9,7 @@
 #import <SparkKit/SparkList.h>
 
 @class SELibraryDocument;
-@class SparkApplication, SparkList;
+@class SparkApplication, SparkList, SparkEntry;
 @interface SEEntryList : NSObject
 
 + (SEEntryList *)separatorList;
@@ -20,7 +20,12 @@
 
 @property(nonatomic, readonly) SparkList *sparkList;
 
+/* rebuild the entries */
 - (void)snapshot;
+/* notify the entries changed, rebuild them only if needed */
+- (void)refresh;
+/* an entry or one of its variants changed, update its row only */
+- (void)refreshEntry:(SparkEntry *)anEntry;
 
 - (void)setNeedsReload:(BOOL)flag;
 - (void)setSpecificFilter:(BOOL)flag;
@@ -38,5 +43,6 @@
 - (void)setApplication:(SparkApplication *)anApplication;
 
 @property(nonatomic, copy) SparkListFilter filter;
+- (void)setFilter:(SparkListFilter)aFilter kind:(SparkListFilterKind)kind value:(id)value;
 
 @end
@@ -29,11 +29,19 @@ SparkEntry *__SEEntryForApplication(SparkEntry *entry, SparkApplication *app, bo
   return nil;
 }
 
+/* cached application snapshots */
+#define kSEEntryListMaxCachedApplications 8
+
 @implementation SEEntryList {
 @private
   SparkList *se_list;
+  /* rows parallel to the list entries: entry resolved for the current application, or NSNull */
+  NSMutableArray *se_rows;
+  /* rows without NSNull */
   NSMutableArray *se_snapshot;
   SparkApplication *se_application;
+  /* application => @[rows, snapshot], only valid until the list changes */
+  NSMapTable *se_cache;
 
   BOOL _dirty;
   BOOL _virtual;
@@ -78,30 +86,175 @@ SparkEntry *__SEEntryForApplication(SparkEntry *entry, SparkApplication *app, bo
 }
 
 #pragma mark -
+- (id)resolveEntry:(SparkEntry *)anEntry {
+  SparkEntry *entry = __SEEntryForApplication(anEntry, se_application, _specific);
+  /* if dynamic list, we have to revalidate the entry */
+  if (entry && (![se_list isDynamic] || [se_list acceptsEntry:entry]))
+    return entry;
+  return [NSNull null];
+}
+
+- (void)rebuild {
+  NSArray *entries = [se_list entries];
+  NSUInteger count = [entries count];
+  se_rows = [[NSMutableArray alloc] initWithCapacity:count];
+  se_snapshot = [[NSMutableArray alloc] initWithCapacity:count];
+  for (NSUInteger idx = 0; idx < count; idx++) {
+    id entry = [self resolveEntry:entries[idx]];
+    [se_rows addObject:entry];
+    if (entry != [NSNull null])
+      [se_snapshot addObject:entry];
+  }
+  _dirty = 0;
+  //SPXDebug(@"snapshot: %@", [self name]);
+}
+
 - (void)snapshot {
 	if (_separator)
     return;
 	[self willChangeValueForKey:@"entries"];
-	if (se_snapshot)
-		[se_snapshot removeAllObjects];
-	else
-		se_snapshot = [[NSMutableArray alloc] init];
-	
-	NSArray *entries = [se_list entries];
-	NSUInteger count = [entries count];
-	for (NSUInteger idx = 0; idx < count; idx++) {
-		SparkEntry *entry = __SEEntryForApplication(entries[idx], se_application, _specific);
-		if (entry) {
-			/* if dynamic list, we have to revalidate the entry */
-			if (![se_list isDynamic] || [se_list acceptsEntry:entry])
-				[se_snapshot addObject:entry];
-		}
-	}
-	_dirty = 0;
-	//SPXDebug(@"snapshot: %@", [self name]);
+  [self rebuild];
 	[self didChangeValueForKey:@"entries"];
 }
 
+- (void)refresh {
+  if (_separator)
+    return;
+  [self willChangeValueForKey:@"entries"];
+  if (_dirty)
+    [self rebuild];
+  [self didChangeValueForKey:@"entries"];
+}
+
+/* snapshot index of a row (or insertion index if the row is not displayed) */
+- (NSUInteger)snapshotIndexForRow:(NSUInteger)row {
+  NSUInteger idx = 0;
+  NSNull *null = [NSNull null];
+  for (NSUInteger i = 0; i < row; i++) {
+    if (se_rows[i] != null)
+      idx++;
+  }
+  return idx;
+}
+
+/* Resolve a row again, and apply the change to the snapshot */
+- (void)updateRow:(NSUInteger)row force:(BOOL)force {
+  NSNull *null = [NSNull null];
+  id previous = se_rows[row];
+  id entry = [self resolveEntry:[se_list entries][row]];
+  if (entry == previous && (!force || entry == null))
+    return;
+
+  [se_cache removeAllObjects];
+  se_rows[row] = entry;
+  NSUInteger idx = [self snapshotIndexForRow:row];
+  NSIndexSet *idxs = [NSIndexSet indexSetWithIndex:idx];
+  if (previous == null) {
+    [self willChange:NSKeyValueChangeInsertion valuesAtIndexes:idxs forKey:@"entries"];
+    [se_snapshot insertObject:entry atIndex:idx];
+    [self didChange:NSKeyValueChangeInsertion valuesAtIndexes:idxs forKey:@"entries"];
+  } else if (entry == null) {
+    [self willChange:NSKeyValueChangeRemoval valuesAtIndexes:idxs forKey:@"entries"];
+    [se_snapshot removeObjectAtIndex:idx];
+    [self didChange:NSKeyValueChangeRemoval valuesAtIndexes:idxs forKey:@"entries"];
+  } else {
+    [self willChange:NSKeyValueChangeReplacement valuesAtIndexes:idxs forKey:@"entries"];
+    [se_snapshot replaceObjectAtIndex:idx withObject:entry];
+    [self didChange:NSKeyValueChangeReplacement valuesAtIndexes:idxs forKey:@"entries"];
+  }
+}
+
+- (BOOL)isSynchronized {
+  return !_dirty && se_rows && [se_rows count] == [se_list count];
+}
+
+- (void)refreshEntry:(SparkEntry *)anEntry {
+  if (_separator || !anEntry)
+    return;
+  /* the entry may be displayed for other applications, even if this row does not change */
+  [se_cache removeAllObjects];
+  if (![self isSynchronized]) {
+    [self setNeedsReload:YES];
+    [self refresh];
+    return;
+  }
+  NSUInteger row = [se_list indexOfEntry:[anEntry root]];
+  /* removed variant: look for the row displaying it */
+  if (NSNotFound == row)
+    row = [se_rows indexOfObjectIdenticalTo:anEntry];
+  if (NSNotFound != row)
+    [self updateRow:row force:YES];
+}
+
+/* Apply list changes to the rows and the snapshot */
+- (void)applyChange:(NSDictionary *)change {
+  NSKeyValueChange kind = [change[NSKeyValueChangeKindKey] unsignedIntegerValue];
+  NSIndexSet *rows = change[NSKeyValueChangeIndexesKey];
+  if (NSKeyValueChangeSetting == kind || !rows || _dirty || !se_rows) {
+    [se_cache removeAllObjects];
+    [self snapshot];
+    return;
+  }
+
+  [se_cache removeAllObjects];
+  NSNull *null = [NSNull null];
+  switch (kind) {
+    case NSKeyValueChangeInsertion: {
+      NSArray *entries = [[se_list entries] objectsAtIndexes:rows];
+      __block NSUInteger i = 0;
+      [rows enumerateIndexesUsingBlock:^(NSUInteger row, BOOL *stop) {
+        [self->se_rows insertObject:[self resolveEntry:entries[i++]] atIndex:row];
+      }];
+      /* snapshot indexes of the visible inserted rows */
+      NSMutableIndexSet *idxs = [[NSMutableIndexSet alloc] init];
+      NSMutableArray *inserted = [[NSMutableArray alloc] init];
+      NSUInteger idx = 0;
+      for (NSUInteger row = 0; row <= [rows lastIndex]; row++) {
+        id entry = se_rows[row];
+        if (entry == null) continue;
+        if ([rows containsIndex:row]) {
+          [idxs addIndex:idx];
+          [inserted addObject:entry];
+        }
+        idx++;
+      }
+      if ([idxs count]) {
+        [self willChange:NSKeyValueChangeInsertion valuesAtIndexes:idxs forKey:@"entries"];
+        [se_snapshot insertObjects:inserted atIndexes:idxs];
+        [self didChange:NSKeyValueChangeInsertion valuesAtIndexes:idxs forKey:@"entries"];
+      }
+    }
+      break;
+    case NSKeyValueChangeRemoval: {
+      NSMutableIndexSet *idxs = [[NSMutableIndexSet alloc] init];
+      NSUInteger idx = 0;
+      for (NSUInteger row = 0; row <= [rows lastIndex] && row < [se_rows count]; row++) {
+        if (se_rows[row] == null) continue;
+        if ([rows containsIndex:row])
+          [idxs addIndex:idx];
+        idx++;
+      }
+      [se_rows removeObjectsAtIndexes:rows];
+      if ([idxs count]) {
+        [self willChange:NSKeyValueChangeRemoval valuesAtIndexes:idxs forKey:@"entries"];
+        [se_snapshot removeObjectsAtIndexes:idxs];
+        [self didChange:NSKeyValueChangeRemoval valuesAtIndexes:idxs forKey:@"entries"];
+      }
+    }
+      break;
+    case NSKeyValueChangeReplacement:
+      [rows enumerateIndexesUsingBlock:^(NSUInteger row, BOOL *stop) {
+        [self updateRow:row force:YES];
+      }];
+      break;
+    default:
+      break;
+  }
+  /* should not append, but do not display inconsistent content */
+  if ([se_rows count] != [se_list count])
+    [self snapshot];
+}
+
 - (SparkList *)sparkList {
 	return se_list;
 }
@@ -143,13 +296,38 @@ SparkEntry *__SEEntryForApplication(SparkEntry *entry, SparkApplication *app, bo
 }
 
 - (void)setApplication:(SparkApplication *)anApplication {
-	SPXSetterRetainAndDo(se_application, anApplication, {
-    [self setNeedsReload:YES];
-  });
+  if (se_application == anApplication)
+    return;
+  /* cached rows are only valid if nothing changed since the list was last resolved */
+  if (![self isSynchronized])
+    [se_cache removeAllObjects];
+  /* keep the current rows, switching back to this application will not have to resolve entries again */
+  else if (se_application) {
+    if (!se_cache)
+      se_cache = [NSMapTable weakToStrongObjectsMapTable];
+    else if ([se_cache count] >= kSEEntryListMaxCachedApplications)
+      [se_cache removeAllObjects];
+    [se_cache setObject:@[se_rows, se_snapshot] forKey:se_application];
+  }
+  se_application = anApplication;
+
+  NSArray *cached = anApplication ? [se_cache objectForKey:anApplication] : nil;
+  if (cached) {
+    [se_cache removeObjectForKey:anApplication];
+    se_rows = cached[0];
+    se_snapshot = cached[1];
+    _dirty = 0;
+  } else {
+    /* not setNeedsReload:, the list did not change and the cache remains valid */
+    _dirty = 1;
+  }
 }
 
 - (void)setSpecificFilter:(BOOL)flag {
-  _specific = flag;
+  if (spx_xor(flag, _specific)) {
+    _specific = flag;
+    [self setNeedsReload:YES];
+  }
 }
 
 - (SparkListFilter)filter {
@@ -158,6 +336,9 @@ SparkEntry *__SEEntryForApplication(SparkEntry *entry, SparkApplication *app, bo
 - (void)setFilter:(SparkListFilter)aFilter {
   se_list.filter = aFilter;
 }
+- (void)setFilter:(SparkListFilter)aFilter kind:(SparkListFilterKind)kind value:(id)value {
+  [se_list setFilter:aFilter kind:kind value:value];
+}
 
 - (id)representation {
 	return self;
@@ -169,6 +350,8 @@ SparkEntry *__SEEntryForApplication(SparkEntry *entry, SparkApplication *app, bo
 #pragma mark KVC
 - (void)setNeedsReload:(BOOL)flag {
 	SPXFlagSet(_dirty, flag);
+  if (flag)
+    [se_cache removeAllObjects];
 }
 
 - (NSArray *)entries {
@@ -211,7 +394,7 @@ SparkEntry *__SEEntryForApplication(SparkEntry *entry, SparkApplication *app, bo
 #pragma mark Sync with SparkList
 - (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary *)change context:(void *)context {
   if ([@"entries" isEqualToString:keyPath]) {
-		[self snapshot];
+    [self applyChange:change];
 		//SPXDebug(@"%@", change);
   } else {
 		[super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
@@ -24,14 +24,21 @@
 
 #import <WonderBox/WBXMLTemplate.h>
 
+static
+NSString *_SEImageTag(NSImage *image, NSSize size);
+
 @implementation SEHTMLGenerator {
 @private
   SELibraryDocument *_document;
+  /* image => { size => tag } */
+  NSMapTable *_tags;
 }
 
 - (id)initWithDocument:(SELibraryDocument *)document {
   if (self = [super init]) {
     _document = document;
+    _tags = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality
+                                  valueOptions:NSPointerFunctionsStrongMemory];
   }
   return self;
 }
@@ -41,36 +48,28 @@ NSInteger _SESortEntries(SparkEntry *e1, SparkEntry *e2, void *ctxt) {
   return [e1.trigger compare:e2.trigger];
 }
 
-- (void)dumpCategories:(NSArray *)categories entries:(NSArray *)entries template:(WBTemplate *)tpl {
-  entries = [entries sortedArrayUsingFunction:_SESortEntries context:nil];
-  for (NSUInteger idx = 0; idx < [categories count]; idx++) {
-    bool dump = false;
+- (void)dumpCategories:(NSMapTable *)categories template:(WBTemplate *)tpl {
+  NSArray *plugins = [[[categories keyEnumerator] allObjects] sortedArrayUsingDescriptors:gSortByNameDescriptors];
+  for (SparkPlugIn *plugin in plugins) {
     WBTemplate *block = [tpl blockWithName:@"category"];
-    SparkPlugIn *plugin = categories[idx];
-    for (NSUInteger idx2 = 0; idx2 < [entries count]; idx2++) {
-      SparkEntry *entry = entries[idx2];
-      SparkAction *action = [entry action];
-      if ([action isKindOfClass:[plugin actionClass]]) {
-        dump = true;
-        WBTemplate *ablock = [block blockWithName:@"entry"];
-        [ablock setVariable:[entry name] forKey:@"name"];
-        if (_includesIcons && [ablock containsKey:@"icon"])
-          [ablock setVariable:[self imageTagForImage:[entry icon] size:NSMakeSize(16, 16)] ?: @"" forKey:@"icon"];
-        [ablock setVariable:[entry triggerDescription] forKey:@"keystroke"];
-        [ablock setVariable:[entry actionDescription] forKey:@"description"];
-				if (_strikeDisabled)
-					[ablock setVariable:[entry isEnabled] ? @"enabled" : @"disabled" forKey:@"status"];
-				else 
-					[ablock setVariable:@"enabled" forKey:@"status"];
-        [ablock dumpBlock];
-      }
-    }
-    if (dump) {
-      [block setVariable:[plugin name] forKey:@"name"];
-      if (_includesIcons && [block containsKey:@"icon"])
-        [block setVariable:[self imageTagForImage:[plugin icon] size:NSMakeSize(18, 18)] forKey:@"icon"];
-      [block dumpBlock];
+    NSArray *entries = [[categories objectForKey:plugin] sortedArrayUsingFunction:_SESortEntries context:nil];
+    for (SparkEntry *entry in entries) {
+      WBTemplate *ablock = [block blockWithName:@"entry"];
+      [ablock setVariable:[entry name] forKey:@"name"];
+      if (_includesIcons && [ablock containsKey:@"icon"])
+        [ablock setVariable:[self imageTagForImage:[entry icon] size:NSMakeSize(16, 16)] ?: @"" forKey:@"icon"];
+      [ablock setVariable:[entry triggerDescription] forKey:@"keystroke"];
+      [ablock setVariable:[entry actionDescription] forKey:@"description"];
+      if (_strikeDisabled)
+        [ablock setVariable:[entry isEnabled] ? @"enabled" : @"disabled" forKey:@"status"];
+      else
+        [ablock setVariable:@"enabled" forKey:@"status"];
+      [ablock dumpBlock];
     }
+    [block setVariable:[plugin name] forKey:@"name"];
+    if (_includesIcons && [block containsKey:@"icon"])
+      [block setVariable:[self imageTagForImage:[plugin icon] size:NSMakeSize(18, 18)] ?: @"" forKey:@"icon"];
+    [block dumpBlock];
   }
 }
 
@@ -79,9 +78,109 @@ NSInteger _SESortEntries(SparkEntry *e1, SparkEntry *e2, void *ctxt) {
 }
 static
 NSComparisonResult _SETriggerCompare(SparkTrigger *t1, SparkTrigger *t2, void *ctxt) {
-  return SETriggerSortValue(t1) - SETriggerSortValue(t2);
+  NSUInteger v1 = SETriggerSortValue(t1), v2 = SETriggerSortValue(t2);
+  return v1 < v2 ? NSOrderedAscending : (v1 > v2 ? NSOrderedDescending : NSOrderedSame);
+}
+
+/* Single pass over the library: group uid => (plugin => entries) */
+- (NSDictionary *)groupEntries:(SparkEntryManager *)manager byField:(SparkUID (^)(SparkEntry *entry))field {
+  NSMutableDictionary *groups = [[NSMutableDictionary alloc] init];
+  SparkActionLoader *loader = [SparkActionLoader sharedLoader];
+  [manager enumerateEntriesUsingBlock:^(SparkEntry *entry, BOOL *stop) {
+    /* lookup is cached by the loader */
+    SparkPlugIn *plugin = [loader plugInForActionClass:[[entry action] class]];
+    if (!plugin)
+      return;
+    NSNumber *key = @(field(entry));
+    NSMapTable *categories = groups[key];
+    if (!categories) {
+      categories = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality
+                                         valueOptions:NSPointerFunctionsStrongMemory];
+      groups[key] = categories;
+    }
+    NSMutableArray *entries = [categories objectForKey:plugin];
+    if (!entries) {
+      entries = [[NSMutableArray alloc] init];
+      [categories setObject:entries forKey:plugin];
+    }
+    [entries addObject:entry];
+  }];
+  return groups;
+}
+
+#pragma mark Icons
+- (NSString *)cachedTagForImage:(NSImage *)image size:(NSSize)size {
+  return [[_tags objectForKey:image] objectForKey:[NSValue valueWithSize:size]];
+}
+
+- (void)setTag:(NSString *)tag forImage:(NSImage *)image size:(NSSize)size {
+  NSMutableDictionary *tags = [_tags objectForKey:image];
+  if (!tags) {
+    tags = [[NSMutableDictionary alloc] init];
+    [_tags setObject:tags forKey:image];
+  }
+  /* NSNull for images that cannot be rendered */
+  tags[[NSValue valueWithSize:size]] = tag ? : (id)[NSNull null];
+}
+
+/* render all the icons of the document concurrently, before filling the template */
+- (void)prepareImages:(NSArray *)images size:(NSSize)size {
+  NSMutableArray *pending = [[NSMutableArray alloc] init];
+  NSHashTable *seen = [NSHashTable hashTableWithOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality];
+  for (NSImage *image in images) {
+    if (![seen containsObject:image] && ![self cachedTagForImage:image size:size]) {
+      [seen addObject:image];
+      [pending addObject:image];
+    }
+  }
+  NSUInteger count = [pending count];
+  if (!count)
+    return;
+
+  NSMutableArray *tags = [[NSMutableArray alloc] initWithCapacity:count];
+  for (NSUInteger idx = 0; idx < count; idx++)
+    [tags addObject:[NSNull null]];
+  dispatch_apply(count, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t idx) {
+    @autoreleasepool {
+      NSString *tag = _SEImageTag(pending[idx], size);
+      if (tag) {
+        @synchronized(tags) {
+          tags[idx] = tag;
+        }
+      }
+    }
+  });
+  for (NSUInteger idx = 0; idx < count; idx++) {
+    id tag = tags[idx];
+    [self setTag:tag != [NSNull null] ? tag : nil forImage:pending[idx] size:size];
+  }
+}
+
+- (void)prepareIcons:(NSDictionary *)groups applications:(NSArray *)applications {
+  NSMutableArray *entries = [[NSMutableArray alloc] init];
+  NSMutableArray *plugins = [[NSMutableArray alloc] init];
+  for (NSMapTable *categories in [groups objectEnumerator]) {
+    for (SparkPlugIn *plugin in categories) {
+      if ([plugin icon])
+        [plugins addObject:[plugin icon]];
+      for (SparkEntry *entry in [categories objectForKey:plugin]) {
+        if ([entry icon])
+          [entries addObject:[entry icon]];
+      }
+    }
+  }
+  [self prepareImages:entries size:NSMakeSize(16, 16)];
+  [self prepareImages:plugins size:NSMakeSize(18, 18)];
+
+  NSMutableArray *icons = [[NSMutableArray alloc] init];
+  for (SparkApplication *app in applications) {
+    if (app.icon)
+      [icons addObject:app.icon];
+  }
+  [self prepareImages:icons size:NSMakeSize(20, 20)];
 }
 
+#pragma mark -
 - (BOOL)writeToURL:(NSURL *)url atomically:(BOOL)useAuxiliaryFile error:(__autoreleasing NSError **)error {
   NSURL *tplURL = [[NSBundle mainBundle] URLForResource:[self se_template] withExtension:@"xml"];
   NSAssert1(tplURL, @"Missing resource file: %@.xml", [self se_template]);
@@ -91,62 +190,82 @@ NSComparisonResult _SETriggerCompare(SparkTrigger *t1, SparkTrigger *t2, void *c
 
   SparkLibrary *library = [_document library];
   SparkEntryManager *manager = [library entryManager];
-
-  NSArray *plugins = [[SparkActionLoader sharedLoader] plugIns];
-  plugins = [plugins sortedArrayUsingDescriptors:gSortByNameDescriptors];
   
   if (_groupBy == 1) {
-    NSMutableArray *customs = [NSMutableArray array];
+    NSDictionary *groups = [self groupEntries:manager byField:^SparkUID(SparkEntry *entry) {
+      return [[entry application] uid];
+    }];
 
+    /* applications that contain at least one entry, system first */
+    NSMutableArray *customs = [NSMutableArray array];
     SparkApplication *system = [library systemApplication];
-
-    if ([manager containsEntryForApplication:system])
-      [customs addObject:system];
-
-    [library.applicationSet enumerateObjectsUsingBlock:^(id obj, BOOL *stop) {
-      if ([manager containsEntryForApplication:system])
-        [customs addObject:system];
+    [library.applicationSet enumerateObjectsUsingBlock:^(SparkApplication *app, BOOL *stop) {
+      if ([app uid] != [system uid] && groups[@([app uid])])
+        [customs addObject:app];
     }];
+    [customs sortUsingComparator:SparkObjectCompare];
+    if (groups[@([system uid])])
+      [customs insertObject:system atIndex:0];
+
+    if (_includesIcons)
+      [self prepareIcons:groups applications:customs];
     
-    [customs sortedArrayUsingComparator:SparkObjectCompare];
-    
-    /* foreach application that contains at least one entry */
     for (SparkApplication *app in customs) {
       WBTemplate *block = [tpl blockWithName:@"application"];
       [block setVariable:app.name forKey:@"name"];
       if (_includesIcons && [block containsKey:@"icon"])
-        [block setVariable:[self imageTagForImage:app.icon size:NSMakeSize(20, 20)] forKey:@"icon"];
+        [block setVariable:[self imageTagForImage:app.icon size:NSMakeSize(20, 20)] ?: @"" forKey:@"icon"];
       
       /* process entries */
-      [self dumpCategories:plugins entries:[manager entriesForApplication:app] template:block];
+      [self dumpCategories:groups[@([app uid])] template:block];
       
       [block dumpBlock];
     }
   } else {
+    NSDictionary *groups = [self groupEntries:manager byField:^SparkUID(SparkEntry *entry) {
+      return [[entry trigger] uid];
+    }];
+    if (_includesIcons)
+      [self prepareIcons:groups applications:nil];
+
     NSArray *triggers = [[[library triggerSet] allObjects] sortedArrayUsingFunction:_SETriggerCompare context:nil];
     
     /* foreach trigger */
-    for (NSUInteger idx = 0, count = [triggers count]; idx < count; idx++) {
-      SparkTrigger *trigger = triggers[idx];
+    for (SparkTrigger *trigger in triggers) {
+      NSMapTable *categories = groups[@([trigger uid])];
+      if (!categories)
+        continue;
+
       WBTemplate *block = [tpl blockWithName:@"shortcut"];
       [block setVariable:[trigger triggerDescription] forKey:@"description"];
       
-      // retreive entries list.
-//      if (_includesIcon && [block containsKey:@"icon"])
-//        [block setVariable:[self imageTagForImage:[app icon] size:NSMakeSize(20, 20)] forKey:@"icon"];
-      
       /* process entries */
-//      [self dumpCategories:plugins entries:[manager entriesForApplication:app] template:block];
+      [self dumpCategories:categories template:block];
       
       [block dumpBlock];
     }
-    
   }
   [tpl writeToURL:url atomically:useAuxiliaryFile andReset:NO];
   return YES;
 }
 
 - (NSString *)imageTagForImage:(NSImage *)image size:(NSSize)size {
+  if (!image)
+    return nil;
+  id tag = [self cachedTagForImage:image size:size];
+  if (!tag) {
+    tag = _SEImageTag(image, size);
+    [self setTag:tag forImage:image size:size];
+  }
+  return tag != [NSNull null] ? tag : nil;
+}
+
+@end
+
+#pragma mark -
+/* Thread safe: draws in a private bitmap context */
+static
+NSString *_SEImageTag(NSImage *image, NSSize size) {
   size_t bytesPerRow = ceil(size.width) * 4;
   char *data = malloc(bytesPerRow * ceil(size.height));
   CGColorSpaceRef space = CGColorSpaceCreateWithName(kCGColorSpaceGenericRGB);
@@ -174,20 +293,13 @@ NSComparisonResult _SETriggerCompare(SparkTrigger *t1, SparkTrigger *t2, void *c
   CGImageRelease(img);
   CFRelease(dest);
   
-  CFDataRef b64 = SPXCFDataBridgingRetain([SPXCFToNSData(png) base64EncodedDataWithOptions:0]);
+  /* base64 data is not nul terminated */
+  NSString *b64 = [SPXCFToNSData(png) base64EncodedStringWithOptions:0];
   CGContextRelease(ctxt);
   CFRelease(png);
   free(data);
   
-  if (b64) {
-    CFMutableStringRef str = CFStringCreateMutable(kCFAllocatorDefault, 0);
-    CFStringAppend(str, CFSTR("<img class=\"icon\" alt=\"icon\" src=\"data:image/png;base64, "));
-    CFStringAppendCString(str, (const char *)CFDataGetBytePtr(b64), kCFStringEncodingASCII);
-    CFStringAppend(str, CFSTR("\" />"));
-    CFRelease(b64);
-    return SPXCFStringBridgingRelease(str);
-  }
+  if (b64)
+    return [NSString stringWithFormat:@"<img class=\"icon\" alt=\"icon\" src=\"data:image/png;base64, %@\" />", b64];
   return nil;
 }
-
-@end
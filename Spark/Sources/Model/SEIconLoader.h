@@ -0,0 +1,36 @@
+/*
+ *  SEIconLoader.h
+ *  Spark Editor
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+@class SparkEntry;
+
+/*
+ Asynchronous entry icon loader for the trigger table.
+ Icons are read from the library icon cache and scaled to iconSize on a bounded background queue,
+ and kept in memory. Must be used from the main thread.
+ */
+@interface SEIconLoader : NSObject
+
+- (instancetype)initWithIconSize:(NSSize)aSize;
+
+@property(nonatomic, readonly) NSSize iconSize;
+
+/* returned while the icon is loading */
+@property(nonatomic, retain) NSImage *placeholder;
+
+/* called on the main thread each time an icon is ready */
+@property(nonatomic, copy) void (^iconDidLoad)(SparkEntry *entry);
+
+/* returns the placeholder and starts loading if the icon is not available yet */
+- (NSImage *)iconForEntry:(SparkEntry *)anEntry;
+
+/* load icons that will be displayed soon (low priority). Cancel the previous prefetch requests. */
+- (void)prefetchEntries:(NSArray *)entries;
+
+- (void)removeAllIcons;
+
+@end
@@ -0,0 +1,231 @@
+/*
+ *  SEIconLoader.m
+ *  Spark Editor
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+#import "SEIconLoader.h"
+
+#import <SparkKit/SparkEntry.h>
+#import <SparkKit/SparkAction.h>
+#import <SparkKit/SparkLibrary.h>
+#import <SparkKit/SparkIconManager.h>
+
+static
+NSImage *SEIconLoaderScaleImage(NSImage *image, NSSize size, CGFloat scale, NSUInteger *cost) {
+  NSBitmapImageRep *rep = [[NSBitmapImageRep alloc] initWithBitmapDataPlanes:NULL
+                                                                  pixelsWide:(NSInteger)(size.width * scale)
+                                                                  pixelsHigh:(NSInteger)(size.height * scale)
+                                                               bitsPerSample:8
+                                                             samplesPerPixel:4
+                                                                    hasAlpha:YES
+                                                                    isPlanar:NO
+                                                              colorSpaceName:NSCalibratedRGBColorSpace
+                                                                 bytesPerRow:0
+                                                                bitsPerPixel:0];
+  if (!rep)
+    return nil;
+  [rep setSize:size];
+
+  /* keep ratio */
+  NSSize src = [image size];
+  NSRect dest = NSMakeRect(0, 0, size.width, size.height);
+  if (src.width > 0 && src.height > 0) {
+    CGFloat ratio = MIN(size.width / src.width, size.height / src.height);
+    dest.size = NSMakeSize(round(src.width * ratio), round(src.height * ratio));
+    dest.origin = NSMakePoint(round((size.width - dest.size.width) / 2), round((size.height - dest.size.height) / 2));
+  }
+
+  [NSGraphicsContext saveGraphicsState];
+  [NSGraphicsContext setCurrentContext:[NSGraphicsContext graphicsContextWithBitmapImageRep:rep]];
+  [[NSGraphicsContext currentContext] setImageInterpolation:NSImageInterpolationHigh];
+  [image drawInRect:dest fromRect:NSZeroRect operation:NSCompositingOperationCopy fraction:1];
+  [NSGraphicsContext restoreGraphicsState];
+
+  NSImage *scaled = [[NSImage alloc] initWithSize:size];
+  [scaled addRepresentation:rep];
+  *cost = [rep bytesPerRow] * [rep pixelsHigh];
+  return scaled;
+}
+
+/* Scaled icon, and the action icon it was made from */
+@interface SEIconRecord : NSObject {
+@public
+  __weak NSImage *se_source;
+  NSImage *se_image;
+}
+@end
+
+@implementation SEIconRecord
+@end
+
+@implementation SEIconLoader {
+@private
+  /* action => record */
+  NSCache *se_icons;
+  NSOperationQueue *se_queue;
+  /* action => scaling operation (or NSNull while reading the icon cache) */
+  NSMapTable *se_pending;
+  /* low priority operations, cancelled by the next prefetch */
+  NSHashTable *se_prefetch;
+}
+
+- (instancetype)init {
+  return [self initWithIconSize:NSMakeSize(16, 16)];
+}
+
+- (instancetype)initWithIconSize:(NSSize)aSize {
+  if (self = [super init]) {
+    _iconSize = aSize;
+    se_icons = [[NSCache alloc] init];
+    /* around 1000 retina icons */
+    se_icons.totalCostLimit = 4 * 1024 * 1024;
+
+    se_queue = [[NSOperationQueue alloc] init];
+    se_queue.name = @"org.shadowlab.spark.icon-loader";
+    se_queue.qualityOfService = NSQualityOfServiceUserInitiated;
+    se_queue.maxConcurrentOperationCount = 2;
+
+    se_pending = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality
+                                       valueOptions:NSPointerFunctionsStrongMemory];
+    se_prefetch = [NSHashTable hashTableWithOptions:NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality];
+  }
+  return self;
+}
+
+- (void)dealloc {
+  [se_queue cancelAllOperations];
+}
+
+#pragma mark -
+- (void)didLoadIcon:(NSImage *)anImage cost:(NSUInteger)cost source:(NSImage *)source
+             action:(SparkAction *)anAction entry:(SparkEntry *)anEntry operation:(NSOperation *)operation {
+  if ([se_pending objectForKey:anAction] == operation)
+    [se_pending removeObjectForKey:anAction];
+  if (!anImage)
+    return;
+
+  SEIconRecord *record = [[SEIconRecord alloc] init];
+  record->se_source = source;
+  record->se_image = anImage;
+  [se_icons setObject:record forKey:anAction cost:cost];
+
+  if (_iconDidLoad)
+    _iconDidLoad(anEntry);
+}
+
+- (NSOperation *)scaleIcon:(NSImage *)source action:(SparkAction *)anAction
+                     entry:(SparkEntry *)anEntry priority:(NSOperationQueuePriority)priority {
+  if (!source) {
+    [se_pending removeObjectForKey:anAction];
+    return nil;
+  }
+
+  NSSize size = _iconSize;
+  CGFloat scale = [[NSScreen mainScreen] backingScaleFactor] ? : 1;
+  NSBlockOperation *operation = [[NSBlockOperation alloc] init];
+  __weak NSBlockOperation *weakOperation = operation;
+  [operation addExecutionBlock:^{
+    NSBlockOperation *strongOperation = weakOperation;
+    if (!strongOperation || [strongOperation isCancelled])
+      return;
+    NSUInteger cost = 0;
+    NSImage *image = SEIconLoaderScaleImage(source, size, scale, &cost);
+    dispatch_async(dispatch_get_main_queue(), ^{
+      [self didLoadIcon:image cost:cost source:source action:anAction entry:anEntry operation:strongOperation];
+    });
+  }];
+  operation.queuePriority = priority;
+  [se_pending setObject:operation forKey:anAction];
+  [se_queue addOperation:operation];
+  return operation;
+}
+
+- (NSOperation *)loadEntry:(SparkEntry *)anEntry priority:(NSOperationQueuePriority)priority {
+  SparkAction *action = [anEntry action];
+  id pending = [se_pending objectForKey:action];
+  if (pending) {
+    if ([pending isKindOfClass:[NSOperation class]] && [pending queuePriority] < priority) {
+      [pending setQueuePriority:priority];
+      [se_prefetch removeObject:pending];
+    }
+    return nil;
+  }
+
+  SparkIconManager *manager = [[action library] iconManager];
+  if ([action hasIcon] || ![action shouldSaveIcon] || !manager)
+    return [self scaleIcon:[anEntry icon] action:action entry:anEntry priority:priority];
+
+  /* avoid the synchronous disk access of -[SparkEntry icon] */
+  [se_pending setObject:[NSNull null] forKey:action];
+  [manager loadIconForObject:action completionHandler:^(NSImage *icon) {
+    if ([anEntry action] == action) {
+      /* no longer hits the disk */
+      [self scaleIcon:[anEntry icon] action:action entry:anEntry priority:priority];
+    } else {
+      [self->se_pending removeObjectForKey:action];
+    }
+  }];
+  return nil;
+}
+
+- (SEIconRecord *)recordForAction:(SparkAction *)anAction {
+  SEIconRecord *record = [se_icons objectForKey:anAction];
+  /* icon changed since it was scaled */
+  if (record && [anAction hasIcon] && [anAction icon] != record->se_source)
+    return nil;
+  return record;
+}
+
+- (NSImage *)iconForEntry:(SparkEntry *)anEntry {
+  SparkAction *action = [anEntry action];
+  if (!action)
+    return _placeholder;
+
+  SEIconRecord *record = [self recordForAction:action];
+  if (record)
+    return record->se_image;
+
+  [self loadEntry:anEntry priority:NSOperationQueuePriorityHigh];
+  /* previous icon is better than the placeholder */
+  record = [se_icons objectForKey:action];
+  return record ? record->se_image : _placeholder;
+}
+
+- (void)prefetchEntries:(NSArray *)entries {
+  /* rows that left the prefetch range */
+  for (NSOperation *operation in [se_prefetch allObjects]) {
+    if (![operation isExecuting])
+      [operation cancel];
+  }
+  [se_prefetch removeAllObjects];
+  /* remove cancelled operations from the pending table */
+  NSMutableArray *cancelled = [[NSMutableArray alloc] init];
+  for (id action in se_pending) {
+    id pending = [se_pending objectForKey:action];
+    if ([pending isKindOfClass:[NSOperation class]] && [pending isCancelled])
+      [cancelled addObject:action];
+  }
+  for (id action in cancelled)
+    [se_pending removeObjectForKey:action];
+
+  for (SparkEntry *entry in entries) {
+    SparkAction *action = [entry action];
+    if (!action || [self recordForAction:action])
+      continue;
+    NSOperation *operation = [self loadEntry:entry priority:NSOperationQueuePriorityVeryLow];
+    if (operation)
+      [se_prefetch addObject:operation];
+  }
+}
+
+- (void)removeAllIcons {
+  [se_queue cancelAllOperations];
+  [se_prefetch removeAllObjects];
+  [se_pending removeAllObjects];
+  [se_icons removeAllObjects];
+}
+
+@end
@@ -8,7 +8,7 @@
 
 #import <SparkKit/SparkKit.h>
 
-@class SELibraryWindow;
+@class SELibraryWindow, SESearchIndex;
 @class SparkPlugIn, SparkEntry;
 @class SparkLibrary, SparkApplication;
 
@@ -16,10 +16,18 @@
 
 @property(nonatomic, retain) SparkLibrary *library;
 
+/* Load the active library in background. The library is set once loaded. */
+- (void)loadActiveLibrary;
+/* not nil while the library is loading. Closing the document cancels loading. */
+@property(nonatomic, readonly) NSProgress *loadingProgress;
+
 @property(nonatomic, retain) SparkApplication *application;
 
 @property(nonatomic, readonly) SELibraryWindow *mainWindowController;
 
+/* entries full text index, created on demand */
+@property(nonatomic, readonly) SESearchIndex *searchIndex;
+
 /* Entry editor */
 - (void)makeEntryOfType:(SparkPlugIn *)type;
 - (void)editEntry:(SparkEntry *)anEntry;
@@ -14,12 +14,14 @@
 #import "SEHTMLGenerator.h"
 #import "SEExportOptions.h"
 #import "SELibraryWindow.h"
+#import "SESearchIndex.h"
 #import "SEEntryEditor.h"
 
 #import <SparkKit/SparkEntry.h>
 #import <SparkKit/SparkAction.h>
 #import <SparkKit/SparkPrivate.h>
 #import <SparkKit/SparkLibrary.h>
+#import <SparkKit/SparkLibraryDiff.h>
 #import <SparkKit/SparkTrigger.h>
 #import <SparkKit/SparkObjectSet.h>
 #import <SparkKit/SparkApplication.h>
@@ -50,6 +52,8 @@ SELibraryDocument *SEGetDocumentForLibrary(SparkLibrary *library) {
   SEEntryEditor *_editor;
 }
 
+@synthesize searchIndex = _searchIndex;
+
 - (instancetype)initWithType:(NSString *)typeName error:(__autoreleasing NSError **)outError {
   if (self = [super initWithType:typeName error:outError]) {
     //_library = [[SparkLibrary alloc] init];
@@ -98,12 +102,34 @@ SELibraryDocument *SEGetDocumentForLibrary(SparkLibrary *library) {
   windowController.window.restorable = NO;
 }
 
+- (void)loadActiveLibrary {
+  NSParameterAssert(!_library);
+  __weak SELibraryDocument *weakSelf = self;
+  NSProgress *progress = SparkLoadActiveLibrary(^(SparkLibrary *library, NSError *error) {
+    SELibraryDocument *document = weakSelf;
+    if (!document)
+      return;
+    [document willChangeValueForKey:@"loadingProgress"];
+    document->_loadingProgress = nil;
+    [document didChangeValueForKey:@"loadingProgress"];
+    if (library) {
+      [document setLibrary:library];
+    } else if (error && !([error.domain isEqualToString:NSCocoaErrorDomain] && error.code == NSUserCancelledError)) {
+      [document presentError:error];
+    }
+  });
+  [self willChangeValueForKey:@"loadingProgress"];
+  _loadingProgress = progress;
+  [self didChangeValueForKey:@"loadingProgress"];
+}
+
 - (void)setLibrary:(SparkLibrary *)aLibrary {
   if (_library != aLibrary) {
     if (_library) {
       [_library setUndoManager:nil];
     }
     _library = aLibrary;
+    _searchIndex = nil;
     /* Cleanup undo stack */
     [self updateChangeCount:NSChangeCleared];
     if (_library) {
@@ -118,6 +144,12 @@ SELibraryDocument *SEGetDocumentForLibrary(SparkLibrary *library) {
   }
 }
 
+- (SESearchIndex *)searchIndex {
+  if (!_searchIndex && _library)
+    _searchIndex = [[SESearchIndex alloc] initWithLibrary:_library];
+  return _searchIndex;
+}
+
 - (void)setApplication:(SparkApplication *)anApplication {
   if (_application != anApplication) {
     NSNotification *notify = [NSNotification notificationWithName:SEApplicationDidChangeNotification
@@ -180,24 +212,21 @@ SELibraryDocument *SEGetDocumentForLibrary(SparkLibrary *library) {
                                        NSLocalizedString(@"Cancel", @"Cancel - Button"),
                                        nil, archive.lastPathComponent);
     if (result == NSModalResponseOK) {
-      SparkLibrary *previous = _library;
-      if (SparkActiveLibrary() == previous) {
-        SparkSetActiveLibrary(library);
-      }
-      SparkLibraryUnregisterLibrary(previous);
-      SparkLibraryDeleteIconCache(previous);
-
-      library.URL = previous.URL;
-      [self setLibrary:library];
-      [library synchronize];
-      
-      [previous unload];
-      
-      /* Restart daemon if needed */
-      if ([[SEServerConnection defaultConnection] isRunning] && _library == SparkActiveLibrary()) {
-        [[SEServerConnection defaultConnection] restart];
+      /* Apply only the differences: windows, lists and the daemon keep working on the same library,
+       and changes are sent to the daemon through the synchronizer */
+      SparkLibraryDiff *diff = [[SparkLibraryDiff alloc] initWithLibrary:_library target:library];
+      if (![diff isEmpty]) {
+        NSUndoManager *undo = [_library undoManager];
+        [undo disableUndoRegistration];
+        [diff applyMerging:NO];
+        [undo enableUndoRegistration];
+        /* previous actions refer to removed objects */
+        [undo removeAllActions];
+        [_library synchronize];
+        [self updateChangeCount:NSChangeCleared];
       }
     }
+    [library unload];
   } else {
     SPXDebug(@"Invalid archive: %@", archive);
   }
@@ -285,14 +314,7 @@ SELibraryDocument *SEGetDocumentForLibrary(SparkLibrary *library) {
 
 /* Find equivalent trigger in library */
 - (SparkTrigger *)memberTrigger:(SparkTrigger *)aTrigger {
-  __block SparkTrigger *member = nil;
-  [self.library.triggerSet enumerateObjectsUsingBlock:^(id obj, BOOL *stop) {
-    if ([aTrigger isEqualToTrigger:obj]) {
-      member = obj;
-      *stop = YES;
-    }
-  }];
-  return member;
+  return [self.library.triggerSet memberTrigger:aTrigger];
 }
 
 static 
@@ -442,6 +464,7 @@ NSAlert *_SELibraryTriggerAlreadyUsedAlert(SparkEntry *previous, SparkEntry *ent
 	NSUInteger removed = 0;
 	NSUInteger count = [entries count];
 	SparkEntryManager *manager = [_library entryManager];
+  [_library beginTransaction];
 	while (count-- > 0) {
 		SparkEntry *entry = entries[count];
 		/* Remove only custom entry */
@@ -462,6 +485,7 @@ NSAlert *_SELibraryTriggerAlreadyUsedAlert(SparkEntry *previous, SparkEntry *ent
 			[manager removeEntry:entry];
 		}
   }
+  [_library commitTransaction];
 	return removed;
 }
 
@@ -0,0 +1,31 @@
+/*
+ *  SESearchIndex.h
+ *  Spark Editor
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+@class SparkLibrary, SparkEntry;
+
+/*
+ Full text index of the library entries (name, category and action description).
+ Text is case and diacritic folded, and split into words. A search matches the entries
+ containing a word starting with each word of the search string.
+ The index is built on first query and then kept up to date using the library notifications.
+ */
+@interface SESearchIndex : NSObject
+
+- (instancetype)initWithLibrary:(SparkLibrary *)aLibrary;
+
+@property(nonatomic, readonly) SparkLibrary *library;
+
+/* nil if the search string is empty (everything matches) */
+- (NSSet *)entriesMatchingSearch:(NSString *)search;
+
+/* reuse the result of the previous query, should be used to filter a list */
+- (BOOL)entry:(SparkEntry *)anEntry matchesSearch:(NSString *)search;
+
+- (void)invalidate;
+
+@end
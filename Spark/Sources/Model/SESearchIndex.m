@@ -0,0 +1,255 @@
+/*
+ *  SESearchIndex.m
+ *  Spark Editor
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+#import "SESearchIndex.h"
+
+#import <SparkKit/SparkEntry.h>
+#import <SparkKit/SparkLibrary.h>
+#import <SparkKit/SparkEntryManager.h>
+#import <SparkKit/SparkLibraryObserver.h>
+
+static
+NSArray *SESearchIndexTokenize(NSString *text) {
+  if (![text length])
+    return @[];
+  NSString *folded = [text stringByFoldingWithOptions:NSCaseInsensitiveSearch | NSDiacriticInsensitiveSearch | NSWidthInsensitiveSearch
+                                               locale:nil];
+  NSMutableArray *tokens = [[NSMutableArray alloc] init];
+  [folded enumerateSubstringsInRange:NSMakeRange(0, [folded length])
+                             options:NSStringEnumerationByWords | NSStringEnumerationLocalized
+                          usingBlock:^(NSString *word, NSRange range, NSRange enclosing, BOOL *stop) {
+    [tokens addObject:word];
+  }];
+  /* keystrokes and symbols are not words */
+  if (![tokens count])
+    [tokens addObject:folded];
+  return tokens;
+}
+
+/* Indexed values of an entry */
+@interface SESearchRecord : NSObject {
+@public
+  NSString *se_name;
+  NSSet *se_tokens;
+}
+@end
+
+@implementation SESearchRecord
+@end
+
+@interface SESearchIndex () <SparkLibraryObserver>
+
+@end
+
+@implementation SESearchIndex {
+@private
+  BOOL se_built;
+  /* entry => record */
+  NSMapTable *se_records;
+  /* token => entries */
+  NSMutableDictionary *se_postings;
+  /* sorted tokens for prefix lookup, nil if tokens changed */
+  NSArray *se_tokens;
+
+  /* last query */
+  NSString *se_query;
+  NSSet *se_matches;
+}
+
+- (instancetype)initWithLibrary:(SparkLibrary *)aLibrary {
+  NSParameterAssert(aLibrary);
+  if (self = [super init]) {
+    _library = aLibrary;
+    se_records = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality
+                                       valueOptions:NSPointerFunctionsStrongMemory];
+    se_postings = [[NSMutableDictionary alloc] init];
+
+    [aLibrary addLibraryObserver:self];
+  }
+  return self;
+}
+
+- (void)dealloc {
+  [_library removeLibraryObserver:self];
+}
+
+#pragma mark -
+- (void)invalidate {
+  se_built = NO;
+  se_tokens = nil;
+  se_query = nil;
+  se_matches = nil;
+  [se_records removeAllObjects];
+  [se_postings removeAllObjects];
+}
+
+- (void)removeEntry:(SparkEntry *)anEntry {
+  SESearchRecord *record = [se_records objectForKey:anEntry];
+  if (!record)
+    return;
+  for (NSString *token in record->se_tokens) {
+    NSHashTable *entries = se_postings[token];
+    [entries removeObject:anEntry];
+    if (![entries count]) {
+      [se_postings removeObjectForKey:token];
+      se_tokens = nil;
+    }
+  }
+  [se_records removeObjectForKey:anEntry];
+}
+
+- (SESearchRecord *)indexEntry:(SparkEntry *)anEntry {
+  [self removeEntry:anEntry];
+
+  SESearchRecord *record = [[SESearchRecord alloc] init];
+  record->se_name = [anEntry name];
+  NSMutableSet *tokens = [[NSMutableSet alloc] init];
+  [tokens addObjectsFromArray:SESearchIndexTokenize(record->se_name)];
+  [tokens addObjectsFromArray:SESearchIndexTokenize(anEntry.category)];
+  /* computed by the plugin, so only once per change */
+  [tokens addObjectsFromArray:SESearchIndexTokenize([anEntry actionDescription])];
+  record->se_tokens = tokens;
+
+  for (NSString *token in tokens) {
+    NSHashTable *entries = se_postings[token];
+    if (!entries) {
+      entries = [NSHashTable hashTableWithOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality];
+      se_postings[token] = entries;
+      se_tokens = nil;
+    }
+    [entries addObject:anEntry];
+  }
+  [se_records setObject:record forKey:anEntry];
+  return record;
+}
+
+- (void)build {
+  if (se_built)
+    return;
+  se_built = YES;
+  [_library.entryManager enumerateEntriesUsingBlock:^(SparkEntry *entry, BOOL *stop) {
+    [self indexEntry:entry];
+  }];
+}
+
+- (NSArray *)sortedTokens {
+  if (!se_tokens)
+    se_tokens = [[se_postings allKeys] sortedArrayUsingSelector:@selector(compare:)];
+  return se_tokens;
+}
+
+/* entries containing a token starting with prefix */
+- (NSMutableSet *)entriesWithPrefix:(NSString *)prefix {
+  NSArray *tokens = [self sortedTokens];
+  NSMutableSet *result = [[NSMutableSet alloc] init];
+  NSUInteger idx = [tokens indexOfObject:prefix
+                           inSortedRange:NSMakeRange(0, [tokens count])
+                                 options:NSBinarySearchingFirstEqual | NSBinarySearchingInsertionIndex
+                         usingComparator:^NSComparisonResult(NSString *t1, NSString *t2) { return [t1 compare:t2]; }];
+  for (; idx < [tokens count]; idx++) {
+    NSString *token = tokens[idx];
+    if (![token hasPrefix:prefix])
+      break;
+    for (SparkEntry *entry in se_postings[token])
+      [result addObject:entry];
+  }
+  return result;
+}
+
+- (BOOL)record:(SESearchRecord *)record matchesTokens:(NSArray *)search {
+  for (NSString *prefix in search) {
+    BOOL found = NO;
+    for (NSString *token in record->se_tokens) {
+      if ([token hasPrefix:prefix]) {
+        found = YES;
+        break;
+      }
+    }
+    if (!found)
+      return NO;
+  }
+  return YES;
+}
+
+- (NSSet *)entriesMatchingSearch:(NSString *)search {
+  NSArray *tokens = SESearchIndexTokenize(search);
+  if (![tokens count])
+    return nil;
+
+  if (se_matches && [search isEqualToString:se_query])
+    return se_matches;
+
+  [self build];
+  NSMutableSet *matches = nil;
+  for (NSString *prefix in tokens) {
+    NSMutableSet *entries = [self entriesWithPrefix:prefix];
+    if (matches)
+      [matches intersectSet:entries];
+    else
+      matches = entries;
+    if (![matches count])
+      break;
+  }
+  se_query = [search copy];
+  se_matches = matches;
+  return matches;
+}
+
+- (BOOL)entry:(SparkEntry *)anEntry matchesSearch:(NSString *)search {
+  NSSet *matches = [self entriesMatchingSearch:search];
+  if (!matches)
+    return YES;
+
+  /* renaming does not send entry notification */
+  SESearchRecord *record = [se_records objectForKey:anEntry];
+  if (record && record->se_name != [anEntry name] && ![record->se_name isEqualToString:[anEntry name]]) {
+    record = [self indexEntry:anEntry];
+    /* update the cached result */
+    NSMutableSet *updated = [matches mutableCopy];
+    if ([self record:record matchesTokens:SESearchIndexTokenize(search)])
+      [updated addObject:anEntry];
+    else
+      [updated removeObject:anEntry];
+    se_matches = updated;
+    return [updated containsObject:anEntry];
+  }
+  return [matches containsObject:anEntry];
+}
+
+#pragma mark Library Observer
+/* changes made in a transaction are indexed once, on commit */
+- (void)library:(SparkLibrary *)library didAddEntry:(SparkEntry *)anEntry {
+  if (!se_built || [library isInTransaction]) return;
+  [self indexEntry:anEntry];
+  se_matches = nil;
+}
+
+- (void)library:(SparkLibrary *)library didUpdateEntry:(SparkEntry *)anEntry previous:(SparkEntry *)previous {
+  if (!se_built || [library isInTransaction]) return;
+  [self indexEntry:anEntry];
+  se_matches = nil;
+}
+
+- (void)library:(SparkLibrary *)library didRemoveEntry:(SparkEntry *)anEntry {
+  if (!se_built || [library isInTransaction]) return;
+  [self removeEntry:anEntry];
+  se_matches = nil;
+}
+
+- (void)library:(SparkLibrary *)library didCommitChanges:(SparkLibraryChanges *)changes {
+  if (!se_built || [changes isEmpty]) return;
+  for (SparkEntry *entry in [changes removedEntries])
+    [self removeEntry:entry];
+  for (SparkEntry *entry in [changes addedEntries])
+    [self indexEntry:entry];
+  for (SparkEntry *entry in [changes updatedEntries])
+    [self indexEntry:entry];
+  se_matches = nil;
+}
+
+@end
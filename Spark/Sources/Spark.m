@@ -207,12 +207,7 @@ NSString * const SESparkEditorDidChangePlugInStatusNotification = @"SESparkEdito
        }];
 #endif
     
-    /* Check active library sanity */
-//    @try {
-    SparkActiveLibrary();
-//    } @catch (NSException *exception) {
-//      SPXLogException(exception);
-//    }
+    /* The active library is loaded in background when the main window opens */
     
     /* Register defaults */
     [SEPreferences setup];
@@ -421,7 +416,8 @@ bool SparkDebugEnabled = false;
     doc = [[NSDocumentController sharedDocumentController] makeUntitledDocumentOfType:@"SparkLibraryFile" error:NULL];
   if (doc) {
     [[NSDocumentController sharedDocumentController] addDocument:doc];
-    [doc setLibrary:SparkActiveLibrary()];
+    /* display the window while the library is loading */
+    [doc loadActiveLibrary];
     [doc makeWindowControllers];
     [doc showWindows];
   }
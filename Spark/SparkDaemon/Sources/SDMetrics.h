@@ -0,0 +1,28 @@
+/*
+ *  SDMetrics.h
+ *  SparkServer
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+@class SparkAction, SparkLibrary;
+
+/* Execution statistics. Thread safe, events are executed on background queues. */
+@interface SDMetrics : NSObject
+
+- (void)recordExecutionOfAction:(SparkAction *)action plugIn:(NSString *)identifier duration:(uint64_t)nanoseconds failed:(BOOL)failed;
+/* time between event reception and action execution */
+- (void)recordDispatchDuration:(uint64_t)nanoseconds;
+/* action still running after its deadline */
+- (void)recordOverrunOfAction:(SparkAction *)action;
+
+@property(atomic) NSTimeInterval libraryLoadTime;
+
+/* collect execution statistics and library state. MUST be called on main thread */
+- (NSDictionary *)metricsForLibrary:(SparkLibrary *)library;
+
+@end
+
+SPARK_PRIVATE
+uint64_t SDAbsoluteTimeToNanoseconds(uint64_t abstime);
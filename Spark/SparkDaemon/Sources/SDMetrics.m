@@ -0,0 +1,169 @@
+/*
+ *  SDMetrics.m
+ *  SparkServer
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+#import "SDMetrics.h"
+
+#import <SparkKit/SparkServerProtocol.h>
+
+#import <SparkKit/SparkEntry.h>
+#import <SparkKit/SparkAction.h>
+#import <SparkKit/SparkTrigger.h>
+#import <SparkKit/SparkLibrary.h>
+#import <SparkKit/SparkObjectSet.h>
+#import <SparkKit/SparkEntryManager.h>
+
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+
+/* latency samples kept to compute percentiles */
+#define kSDMetricsSampleCount 1024
+
+uint64_t SDAbsoluteTimeToNanoseconds(uint64_t abstime) {
+  static mach_timebase_info_data_t sTimebase;
+  if (!sTimebase.denom)
+    mach_timebase_info(&sTimebase);
+  return abstime * sTimebase.numer / sTimebase.denom;
+}
+
+static
+uint64_t SDResidentSize(void) {
+  mach_task_basic_info_data_t info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (KERN_SUCCESS != task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count))
+    return 0;
+  return info.resident_size;
+}
+
+static
+int SDCompareSamples(const void *a, const void *b) {
+  uint64_t v1 = *(const uint64_t *)a, v2 = *(const uint64_t *)b;
+  return v1 < v2 ? -1 : (v1 > v2 ? 1 : 0);
+}
+
+/* ring buffer */
+typedef struct _SDSamples {
+  uint64_t values[kSDMetricsSampleCount];
+  NSUInteger count;
+  NSUInteger index;
+} SDSamples;
+
+static
+void SDSamplesAdd(SDSamples *samples, uint64_t value) {
+  samples->values[samples->index] = value;
+  samples->index = (samples->index + 1) % kSDMetricsSampleCount;
+  if (samples->count < kSDMetricsSampleCount)
+    samples->count++;
+}
+
+/* samples is sorted in place */
+static
+void SDSamplesSetPercentiles(SDSamples *samples, NSMutableDictionary *metrics, NSString *p50, NSString *p99) {
+  NSUInteger count = samples->count;
+  if (count > 0) {
+    qsort(samples->values, count, sizeof(*samples->values), SDCompareSamples);
+    metrics[p50] = @(samples->values[(count - 1) / 2] / 1e9);
+    metrics[p99] = @(samples->values[(count - 1) * 99 / 100] / 1e9);
+  }
+}
+
+@implementation SDMetrics {
+@private
+  NSCountedSet *sd_executions;
+  NSCountedSet *sd_failures;
+  NSCountedSet *sd_overruns;
+
+  SDSamples sd_durations;
+  SDSamples sd_dispatch;
+}
+
+- (id)init {
+  if (self = [super init]) {
+    sd_executions = [[NSCountedSet alloc] init];
+    sd_failures = [[NSCountedSet alloc] init];
+    sd_overruns = [[NSCountedSet alloc] init];
+  }
+  return self;
+}
+
+- (void)recordExecutionOfAction:(SparkAction *)action plugIn:(NSString *)identifier duration:(uint64_t)nanoseconds failed:(BOOL)failed {
+  @synchronized(self) {
+    if (identifier)
+      [sd_executions addObject:identifier];
+    if (failed)
+      [sd_failures addObject:[NSString stringWithFormat:@"%u", (unsigned)action.uid]];
+
+    SDSamplesAdd(&sd_durations, nanoseconds);
+  }
+}
+
+- (void)recordOverrunOfAction:(SparkAction *)action {
+  @synchronized(self) {
+    [sd_overruns addObject:[NSString stringWithFormat:@"%u", (unsigned)action.uid]];
+  }
+}
+
+- (void)recordDispatchDuration:(uint64_t)nanoseconds {
+  @synchronized(self) {
+    SDSamplesAdd(&sd_dispatch, nanoseconds);
+  }
+}
+
+static
+NSDictionary *SDCountedSetDictionary(NSCountedSet *set) {
+  NSMutableDictionary *dict = [NSMutableDictionary dictionaryWithCapacity:[set count]];
+  for (id object in set)
+    dict[object] = @([set countForObject:object]);
+  return dict;
+}
+
+- (NSDictionary *)metricsForLibrary:(SparkLibrary *)library {
+  NSMutableDictionary *metrics = [[NSMutableDictionary alloc] init];
+
+  /* Library state */
+  __block NSUInteger enabled = 0, disabled = 0, unplugged = 0, registred = 0;
+  [library.entryManager enumerateEntriesUsingBlock:^(SparkEntry *entry, BOOL *stop) {
+    if (entry.enabled) enabled++; else disabled++;
+    if (!entry.plugged) unplugged++;
+    if (entry.registred) registred++;
+  }];
+  metrics[kSparkMetricsEntriesKey] = @{
+    kSparkMetricsEntryEnabled: @(enabled),
+    kSparkMetricsEntryDisabled: @(disabled),
+    kSparkMetricsEntryUnplugged: @(unplugged),
+    kSparkMetricsEntryRegistred: @(registred),
+  };
+  __block NSUInteger hotkeys = 0;
+  [library.triggerSet enumerateObjectsUsingBlock:^(SparkTrigger *trigger, BOOL *stop) {
+    if ([trigger isRegistred]) hotkeys++;
+  }];
+  metrics[kSparkMetricsRegistredHotKeysKey] = @(hotkeys);
+  metrics[kSparkMetricsDispatchTableSizeKey] = @(library.triggerSet.count);
+
+  /* Execution */
+  SDSamples *durations = malloc(sizeof(SDSamples));
+  SDSamples *dispatch = malloc(sizeof(SDSamples));
+  @synchronized(self) {
+    metrics[kSparkMetricsExecutionsKey] = SDCountedSetDictionary(sd_executions);
+    metrics[kSparkMetricsFailuresKey] = SDCountedSetDictionary(sd_failures);
+    metrics[kSparkMetricsOverrunsKey] = SDCountedSetDictionary(sd_overruns);
+    *durations = sd_durations;
+    *dispatch = sd_dispatch;
+  }
+  SDSamplesSetPercentiles(durations, metrics, kSparkMetricsLatencyP50Key, kSparkMetricsLatencyP99Key);
+  SDSamplesSetPercentiles(dispatch, metrics, kSparkMetricsDispatchP50Key, kSparkMetricsDispatchP99Key);
+  free(dispatch);
+  free(durations);
+
+  /* Process */
+  metrics[kSparkMetricsLibraryLoadTimeKey] = @(self.libraryLoadTime);
+  metrics[kSparkMetricsResidentSizeKey] = @(SDResidentSize());
+
+  return metrics;
+}
+
+@end
@@ -8,6 +8,9 @@
 
 #import "SparkDaemon.h"
 #import "SDVersion.h"
+#import "SDMetrics.h"
+#import "SDScheduler.h"
+#import "SDRepeatEngine.h"
 
 #import <SparkKit/SparkEntry.h>
 #import <SparkKit/SparkTrigger.h>
@@ -36,19 +39,25 @@
   return [sd_rlibrary distantLibrary];
 }
 
+- (NSDictionary *)metrics {
+  SPXTrace();
+  NSMutableDictionary *metrics = [[sd_metrics metricsForLibrary:sd_library] mutableCopy];
+  metrics[kSparkMetricsQueueDepthKey] = [sd_scheduler queueDepths];
+  metrics[kSparkMetricsDroppedEventsKey] = @(sd_scheduler.droppedEvents);
+  metrics[kSparkMetricsCoalescedRepeatsKey] = @(sd_repeat.coalescedRepeats);
+  return metrics;
+}
+
 #pragma mark Entries Management
-- (void)didAddEntry:(NSNotification *)aNotification {
+- (void)library:(SparkLibrary *)library didAddEntry:(SparkEntry *)entry {
   SPXTrace();
-  SparkEntry *entry = SparkNotificationObject(aNotification);
   /* Trigger can have a new active action */
   if ([self isEnabled] || [entry isPersistent])
     [self setEntryStatus:entry];
 }
 
-- (void)didUpdateEntry:(NSNotification *)aNotification {
+- (void)library:(SparkLibrary *)library didUpdateEntry:(SparkEntry *)new previous:(SparkEntry *)previous {
   SPXTrace();
-  SparkEntry *new = SparkNotificationObject(aNotification);
-  SparkEntry *previous = SparkNotificationUpdatedObject(aNotification);
   if ([self isEnabled] || [new isPersistent] || [previous isPersistent]) {
     [self setEntryStatus:previous];
     
@@ -57,17 +66,15 @@
   }
 }
 
-- (void)didRemoveEntry:(NSNotification *)aNotification {
+- (void)library:(SparkLibrary *)library didRemoveEntry:(SparkEntry *)entry {
   SPXTrace();
-  SparkEntry *entry = SparkNotificationObject(aNotification);
   /* If trigger was not removed, we should check it */
   if ([self isEnabled] || [entry isPersistent])
     [self setEntryStatus:entry];
 }
 
-- (void)didChangeEntryStatus:(NSNotification *)aNotification {
+- (void)library:(SparkLibrary *)library didChangeEntryStatus:(SparkEntry *)entry {
   SPXTrace();
-  SparkEntry *entry = SparkNotificationObject(aNotification);
   if ([self isEnabled] || [entry isPersistent]) {
     /* Should check triggers */
     [self setEntryStatus:entry];
@@ -75,11 +82,17 @@
 }
 
 #pragma mark -
-#pragma mark Notifications
-- (void)willRemoveTrigger:(NSNotification *)aNotification {
+#pragma mark Objects
+- (void)library:(SparkLibrary *)library willRemoveObject:(SparkObject *)anObject fromSet:(SparkObjectSet *)aSet {
+  if (aSet == [library triggerSet])
+    [self willRemoveTrigger:(SparkTrigger *)anObject];
+  else if (aSet == [library applicationSet])
+    [self willRemoveApplication:(SparkApplication *)anObject];
+}
+
+- (void)willRemoveTrigger:(SparkTrigger *)trigger {
   SPXTrace();
   if ([self isEnabled]) {
-    SparkTrigger *trigger = SparkNotificationObject(aNotification);
     if ([trigger isRegistred])
       [trigger setRegistred:NO];
   }
@@ -102,19 +115,17 @@
 //}
 
 #pragma mark Application
-- (void)willRemoveApplication:(NSNotification *)aNotification {
+- (void)willRemoveApplication:(SparkApplication *)app {
   SPXTrace();
   /* handle special case: remove the front application and application is disabled */
-  SparkApplication *app = SparkNotificationObject(aNotification);
   if ([app isEqual:sd_front] && !app.enabled) {
     /* restore triggers status */
     [self registerEntries];
     sd_front = nil;
   }
 }
-- (void)didChangeApplicationStatus:(NSNotification *)aNotification {
+- (void)library:(SparkLibrary *)library didChangeApplicationStatus:(SparkApplication *)app {
   SPXTrace();
-  SparkApplication *app = [aNotification object];
   if ([app isEqual:sd_front]) {
     if ([app isEnabled])
       [self registerEntries];
@@ -0,0 +1,32 @@
+/*
+ *  SDRepeatEngine.h
+ *  SparkServer
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+@class SparkHotKey, SparkEntry, SparkEvent;
+
+/*
+ Key repeat engine.
+ Owns the held keys state and sends repeat events using a single timer,
+ according to -[SparkAction initialRepeatInterval] and -[SparkAction repeatInterval].
+ A repeat is skipped while the previous one has not been executed,
+ and pending repeats are discarded as soon as the key is released.
+ */
+@interface SDRepeatEngine : NSObject
+
+/* MUST be called on main thread */
+- (void)keyPressed:(SparkHotKey *)hotkey entry:(SparkEntry *)entry;
+- (void)keyReleased:(SparkHotKey *)hotkey;
+- (void)releaseAllKeys;
+
+/* Thread safe. Returns NO for repeat events whose key has been released */
+- (BOOL)shouldExecuteEvent:(SparkEvent *)anEvent;
+/* Thread safe. MUST be called when a repeat event has been executed or dropped */
+- (void)didExecuteEvent:(SparkEvent *)anEvent;
+
+@property(nonatomic, readonly) NSUInteger coalescedRepeats;
+
+@end
@@ -0,0 +1,170 @@
+/*
+ *  SDRepeatEngine.m
+ *  SparkServer
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+#import "SDRepeatEngine.h"
+#import "SDMetrics.h"
+
+#import <SparkKit/SparkEvent.h>
+#import <SparkKit/SparkEntry.h>
+#import <SparkKit/SparkAction.h>
+#import <SparkKit/SparkHotKey.h>
+
+#include <mach/mach_time.h>
+
+/* timer tolerance */
+#define kSDRepeatLeeway (500 * NSEC_PER_USEC)
+
+@interface SDHeldKey : NSObject {
+@public
+  SparkEntry *sd_entry;
+  uint64_t sd_interval; // ns
+  uint64_t sd_deadline; // ns
+  BOOL sd_pending;
+}
+@end
+
+@implementation SDHeldKey
+@end
+
+SPARK_INLINE
+uint64_t __SDNow(void) {
+  return SDAbsoluteTimeToNanoseconds(mach_absolute_time());
+}
+
+@implementation SDRepeatEngine {
+@private
+  /* hotkey => held key */
+  NSMapTable *sd_keys;
+  dispatch_source_t sd_timer;
+}
+
+- (instancetype)init {
+  if (self = [super init]) {
+    sd_keys = [NSMapTable strongToStrongObjectsMapTable];
+    sd_timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, DISPATCH_TIMER_STRICT, dispatch_get_main_queue());
+    __weak SDRepeatEngine *engine = self;
+    dispatch_source_set_event_handler(sd_timer, ^{
+      [engine fire];
+    });
+    dispatch_source_set_timer(sd_timer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, kSDRepeatLeeway);
+    dispatch_resume(sd_timer);
+  }
+  return self;
+}
+
+- (void)dealloc {
+  dispatch_source_cancel(sd_timer);
+}
+
+#pragma mark -
+/* MUST be called with lock held */
+- (void)rearm {
+  uint64_t deadline = UINT64_MAX;
+  for (SparkHotKey *hotkey in sd_keys) {
+    SDHeldKey *key = [sd_keys objectForKey:hotkey];
+    deadline = MIN(deadline, key->sd_deadline);
+  }
+  if (UINT64_MAX == deadline) {
+    dispatch_source_set_timer(sd_timer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, kSDRepeatLeeway);
+  } else {
+    uint64_t now = __SDNow();
+    int64_t delta = deadline > now ? (int64_t)(deadline - now) : 0;
+    dispatch_source_set_timer(sd_timer, dispatch_time(DISPATCH_TIME_NOW, delta), DISPATCH_TIME_FOREVER, kSDRepeatLeeway);
+  }
+}
+
+- (void)fire {
+  NSMutableArray *hotkeys = [[NSMutableArray alloc] init];
+  NSMutableArray *entries = [[NSMutableArray alloc] init];
+  @synchronized(self) {
+    uint64_t now = __SDNow();
+    for (SparkHotKey *hotkey in sd_keys) {
+      SDHeldKey *key = [sd_keys objectForKey:hotkey];
+      if (key->sd_deadline > now)
+        continue;
+
+      if (key->sd_pending) {
+        /* previous repeat still running: skip this one */
+        _coalescedRepeats++;
+      } else {
+        key->sd_pending = YES;
+        [hotkeys addObject:hotkey];
+        [entries addObject:key->sd_entry];
+      }
+      /* do not try to catch up missed repeats */
+      key->sd_deadline += key->sd_interval;
+      if (key->sd_deadline <= now)
+        key->sd_deadline = now + key->sd_interval;
+    }
+    [self rearm];
+  }
+  /* send outside of the lock, the handler may execute the action synchronously */
+  CFAbsoluteTime time = CFAbsoluteTimeGetCurrent();
+  [hotkeys enumerateObjectsUsingBlock:^(SparkHotKey *hotkey, NSUInteger idx, BOOL *stop) {
+    [hotkey sendEventWithEntry:entries[idx] time:time isARepeat:YES];
+  }];
+}
+
+#pragma mark -
+- (void)keyPressed:(SparkHotKey *)hotkey entry:(SparkEntry *)entry {
+  SparkAction *action = entry.action;
+  NSTimeInterval interval = action.repeatInterval;
+  if (interval <= 0)
+    return;
+
+  NSTimeInterval delay = action.initialRepeatInterval;
+  if (delay <= 0)
+    delay = [NSEvent keyRepeatDelay];
+
+  SDHeldKey *key = [[SDHeldKey alloc] init];
+  key->sd_entry = entry;
+  key->sd_interval = (uint64_t)(interval * NSEC_PER_SEC);
+  key->sd_deadline = __SDNow() + (uint64_t)(delay * NSEC_PER_SEC);
+  @synchronized(self) {
+    [sd_keys setObject:key forKey:hotkey];
+    [self rearm];
+  }
+}
+
+- (void)keyReleased:(SparkHotKey *)hotkey {
+  @synchronized(self) {
+    if ([sd_keys objectForKey:hotkey]) {
+      [sd_keys removeObjectForKey:hotkey];
+      [self rearm];
+    }
+  }
+}
+
+- (void)releaseAllKeys {
+  @synchronized(self) {
+    [sd_keys removeAllObjects];
+    [self rearm];
+  }
+}
+
+#pragma mark -
+- (BOOL)shouldExecuteEvent:(SparkEvent *)anEvent {
+  if (!anEvent.isARepeat)
+    return YES;
+  @synchronized(self) {
+    SDHeldKey *key = [sd_keys objectForKey:anEvent.trigger];
+    return key && key->sd_entry == anEvent.entry;
+  }
+}
+
+- (void)didExecuteEvent:(SparkEvent *)anEvent {
+  if (!anEvent.isARepeat)
+    return;
+  @synchronized(self) {
+    SDHeldKey *key = [sd_keys objectForKey:anEvent.trigger];
+    if (key)
+      key->sd_pending = NO;
+  }
+}
+
+@end
@@ -0,0 +1,41 @@
+/*
+ *  SDScheduler.h
+ *  SparkServer
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+@class SparkEvent;
+
+/* dispatched is the value passed to -scheduleEvent:dispatchTime:function:context: */
+typedef void (*SDSchedulerFunction)(void *context, SparkEvent *event, uint64_t dispatched);
+typedef void (*SDSchedulerDiscardFunction)(void *context, SparkEvent *event);
+
+/*
+ Execution scheduler.
+ Events are queued per serialization key (-[SparkAction lock]), events with the same key
+ are executed one after the other. Queues are served by a bounded pool of workers,
+ key events first, then repeat events.
+ Tasks and queues are reused, so scheduling does not allocate in steady state.
+ */
+@interface SDScheduler : NSObject
+
+- (instancetype)initWithMaximumWorkers:(NSUInteger)workers maximumDepth:(NSUInteger)depth;
+
+@property(nonatomic, readonly) NSUInteger maximumWorkers;
+@property(nonatomic, readonly) NSUInteger maximumDepth; // per queue
+
+/* returns NO if the event was dropped. function is called on the main thread if the action requires it, else on a worker thread */
+- (BOOL)scheduleEvent:(SparkEvent *)anEvent dispatchTime:(uint64_t)dispatched
+             function:(SDSchedulerFunction)function context:(void *)context;
+
+/* function is called for pending events replaced by a newer event of the same entry (coalescing).
+ The replaced event is not used by the scheduler anymore. */
+- (void)setDiscardFunction:(SDSchedulerDiscardFunction)function context:(void *)context;
+
+/* queue description => pending events */
+- (NSDictionary *)queueDepths;
+@property(nonatomic, readonly) NSUInteger droppedEvents;
+
+@end
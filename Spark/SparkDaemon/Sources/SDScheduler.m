@@ -0,0 +1,310 @@
+/*
+ *  SDScheduler.m
+ *  SparkServer
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+#import "SDScheduler.h"
+
+#import <SparkKit/SparkEvent.h>
+#import <SparkKit/SparkEntry.h>
+#import <SparkKit/SparkAction.h>
+
+/* unused tasks and queues kept for reuse */
+#define kSDSchedulerPoolSize 32
+
+@class SDScheduler, SDSchedulerQueue;
+
+@interface SDSchedulerTask : NSObject {
+@public
+  SparkEvent *sd_event;
+  SDSchedulerFunction sd_function;
+  void *sd_context;
+  uint64_t sd_dispatched;
+  BOOL sd_main;
+  /* set while the task is running */
+  SDSchedulerQueue *sd_parent;
+  /* tasks are owned by their scheduler */
+  __unsafe_unretained SDScheduler *sd_scheduler;
+}
+@end
+
+@implementation SDSchedulerTask
+@end
+
+/* Events sharing a serialization key */
+@interface SDSchedulerQueue : NSObject {
+@public
+  id sd_key;
+  NSMutableArray *sd_events;  // key events (priority)
+  NSMutableArray *sd_repeats; // repeat events
+  BOOL sd_running;
+  BOOL sd_ready;
+}
+@end
+
+@implementation SDSchedulerQueue
+
+- (instancetype)init {
+  if (self = [super init]) {
+    sd_events = [[NSMutableArray alloc] init];
+    sd_repeats = [[NSMutableArray alloc] init];
+  }
+  return self;
+}
+
+- (NSUInteger)count {
+  return [sd_events count] + [sd_repeats count];
+}
+
+- (SDSchedulerTask *)pendingTaskForEntry:(SparkEntry *)entry {
+  for (SDSchedulerTask *task in sd_repeats)
+    if (task->sd_event.entry == entry) return task;
+  for (SDSchedulerTask *task in sd_events)
+    if (task->sd_event.entry == entry) return task;
+  return nil;
+}
+
+- (SDSchedulerTask *)dequeue {
+  NSMutableArray *tasks = [sd_events count] ? sd_events : sd_repeats;
+  SDSchedulerTask *task = [tasks firstObject];
+  if (task)
+    [tasks removeObjectAtIndex:0];
+  return task;
+}
+
+@end
+
+#pragma mark -
+@implementation SDScheduler {
+@private
+  dispatch_queue_t sd_queue;
+  /* serialization key => queue */
+  NSMapTable *sd_queues;
+  /* queues waiting for a worker */
+  NSMutableArray *sd_ready;
+  NSUInteger sd_active;
+  /* unused tasks and queues */
+  NSMutableArray *sd_tasks;
+  NSMutableArray *sd_pool;
+
+  SDSchedulerDiscardFunction sd_discard;
+  void *sd_discardContext;
+}
+
+- (instancetype)init {
+  return [self initWithMaximumWorkers:[[NSProcessInfo processInfo] activeProcessorCount] maximumDepth:16];
+}
+
+- (instancetype)initWithMaximumWorkers:(NSUInteger)workers maximumDepth:(NSUInteger)depth {
+  NSParameterAssert(workers > 0 && depth > 0);
+  if (self = [super init]) {
+    _maximumWorkers = workers;
+    _maximumDepth = depth;
+    sd_queue = dispatch_queue_create("org.shadowlab.spark.scheduler", DISPATCH_QUEUE_SERIAL);
+    sd_queues = [NSMapTable strongToStrongObjectsMapTable];
+    sd_ready = [[NSMutableArray alloc] init];
+    sd_tasks = [[NSMutableArray alloc] init];
+    sd_pool = [[NSMutableArray alloc] init];
+  }
+  return self;
+}
+
+- (void)setDiscardFunction:(SDSchedulerDiscardFunction)function context:(void *)context {
+  sd_discard = function;
+  sd_discardContext = context;
+}
+
+#pragma mark -
+/* MUST be called on sd_queue */
+- (SDSchedulerTask *)dequeueTask {
+  SDSchedulerTask *task = [sd_tasks lastObject];
+  if (task) {
+    [sd_tasks removeLastObject];
+  } else {
+    task = [[SDSchedulerTask alloc] init];
+    task->sd_scheduler = self;
+  }
+  return task;
+}
+
+- (void)recycleTask:(SDSchedulerTask *)task {
+  task->sd_event = nil;
+  task->sd_parent = nil;
+  if ([sd_tasks count] < kSDSchedulerPoolSize)
+    [sd_tasks addObject:task];
+}
+
+- (SDSchedulerQueue *)dequeueQueueWithKey:(id)key {
+  SDSchedulerQueue *queue = [sd_pool lastObject];
+  if (queue)
+    [sd_pool removeLastObject];
+  else
+    queue = [[SDSchedulerQueue alloc] init];
+  queue->sd_key = key;
+  return queue;
+}
+
+- (void)recycleQueue:(SDSchedulerQueue *)queue {
+  queue->sd_key = nil;
+  if ([sd_pool count] < kSDSchedulerPoolSize)
+    [sd_pool addObject:queue];
+}
+
+static
+void _SDSchedulerDidExecute(void *ctxt) {
+  SDSchedulerTask *task = (__bridge_transfer SDSchedulerTask *)ctxt;
+  [task->sd_scheduler didExecuteTask:task];
+}
+
+static
+void _SDSchedulerExecute(void *ctxt) {
+  SDSchedulerTask *task = (__bridge SDSchedulerTask *)ctxt;
+  @autoreleasepool {
+    task->sd_function(task->sd_context, task->sd_event, task->sd_dispatched);
+  }
+  /* still owns the task reference */
+  dispatch_async_f(task->sd_scheduler->sd_queue, ctxt, _SDSchedulerDidExecute);
+}
+
+/* MUST be called on sd_queue */
+- (void)setReady:(SDSchedulerQueue *)queue {
+  if (!queue->sd_running && !queue->sd_ready && [queue count] > 0) {
+    queue->sd_ready = YES;
+    [sd_ready addObject:queue];
+  }
+}
+
+- (SDSchedulerQueue *)nextReadyQueue {
+  /* key events first */
+  NSUInteger idx = [sd_ready indexOfObjectPassingTest:^BOOL(SDSchedulerQueue *queue, NSUInteger i, BOOL *stop) {
+    return [queue->sd_events count] > 0;
+  }];
+  if (NSNotFound == idx)
+    idx = 0;
+  SDSchedulerQueue *queue = sd_ready[idx];
+  [sd_ready removeObjectAtIndex:idx];
+  queue->sd_ready = NO;
+  return queue;
+}
+
+- (void)pump {
+  while ([sd_ready count] > 0) {
+    SDSchedulerQueue *queue = nil;
+    if (sd_active < _maximumWorkers) {
+      queue = [self nextReadyQueue];
+    } else {
+      /* the pool is full, main thread tasks do not use a worker */
+      NSUInteger idx = [sd_ready indexOfObjectPassingTest:^BOOL(SDSchedulerQueue *q, NSUInteger i, BOOL *stop) {
+        SDSchedulerTask *task = [q->sd_events firstObject] ? : [q->sd_repeats firstObject];
+        return task->sd_main;
+      }];
+      if (NSNotFound == idx)
+        return;
+      queue = sd_ready[idx];
+      [sd_ready removeObjectAtIndex:idx];
+      queue->sd_ready = NO;
+    }
+
+    BOOL priority = [queue->sd_events count] > 0;
+    SDSchedulerTask *task = [queue dequeue];
+    task->sd_parent = queue;
+    queue->sd_running = YES;
+
+    dispatch_queue_t target;
+    if (task->sd_main) {
+      target = dispatch_get_main_queue();
+    } else {
+      sd_active++;
+      target = dispatch_get_global_queue(priority ? QOS_CLASS_USER_INTERACTIVE : QOS_CLASS_USER_INITIATED, 0);
+    }
+    /* function based dispatch, so no block is copied. released by _SDSchedulerDidExecute() */
+    dispatch_async_f(target, (__bridge_retained void *)task, _SDSchedulerExecute);
+  }
+}
+
+/* MUST be called on sd_queue */
+- (void)didExecuteTask:(SDSchedulerTask *)task {
+  SDSchedulerQueue *queue = task->sd_parent;
+  if (!task->sd_main)
+    sd_active--;
+  [self recycleTask:task];
+  queue->sd_running = NO;
+  if ([queue count] > 0) {
+    [self setReady:queue];
+  } else {
+    if (queue->sd_key && [sd_queues objectForKey:queue->sd_key] == queue)
+      [sd_queues removeObjectForKey:queue->sd_key];
+    [self recycleQueue:queue];
+  }
+  [self pump];
+}
+
+#pragma mark -
+- (BOOL)scheduleEvent:(SparkEvent *)anEvent dispatchTime:(uint64_t)dispatched
+             function:(SDSchedulerFunction)function context:(void *)context {
+  NSParameterAssert(anEvent && function);
+  SparkAction *action = anEvent.entry.action;
+  BOOL main = action.needsToBeRunOnMainThread;
+  id key = action.supportsConcurrentRequests ? nil : action.lock;
+  SparkActionQueuePolicy policy = action.queuePolicy;
+
+  __block BOOL scheduled = YES;
+  __block SparkEvent *replaced = nil;
+  dispatch_sync(sd_queue, ^{
+    SDSchedulerQueue *queue = key ? [self->sd_queues objectForKey:key] : nil;
+    if (!queue) {
+      queue = [self dequeueQueueWithKey:key];
+      if (key)
+        [self->sd_queues setObject:queue forKey:key];
+    }
+
+    /* repeat events are always coalesced, key down events only when the queue is full */
+    BOOL full = [queue count] >= self->_maximumDepth;
+    if (anEvent.isARepeat || full) {
+      SDSchedulerTask *pending = [queue pendingTaskForEntry:anEvent.entry];
+      if (pending && (anEvent.isARepeat || kSparkActionQueuePolicyCoalesce == policy)) {
+        replaced = pending->sd_event;
+        pending->sd_event = anEvent;
+        pending->sd_function = function;
+        pending->sd_context = context;
+        pending->sd_dispatched = dispatched;
+        return;
+      }
+      if (full) {
+        SPXDebug(@"Queue %@ full, drop event: %@", key, anEvent);
+        self->_droppedEvents++;
+        scheduled = NO;
+        return;
+      }
+    }
+
+    SDSchedulerTask *task = [self dequeueTask];
+    task->sd_event = anEvent;
+    task->sd_function = function;
+    task->sd_context = context;
+    task->sd_dispatched = dispatched;
+    task->sd_main = main;
+    [anEvent.isARepeat ? queue->sd_repeats : queue->sd_events addObject:task];
+    [self setReady:queue];
+    [self pump];
+  });
+  if (replaced && sd_discard)
+    sd_discard(sd_discardContext, replaced);
+  return scheduled;
+}
+
+- (NSDictionary *)queueDepths {
+  NSMutableDictionary *depths = [[NSMutableDictionary alloc] init];
+  dispatch_sync(sd_queue, ^{
+    for (id key in self->sd_queues) {
+      SDSchedulerQueue *queue = [self->sd_queues objectForKey:key];
+      depths[[key description]] = @([queue count]);
+    }
+  });
+  return depths;
+}
+
+@end
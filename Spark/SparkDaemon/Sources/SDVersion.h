@@ -6,6 +6,6 @@
  *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
  */
 
-/* 3.0.0 */
-#define kSparkServerVersion		0x030100
-#define kSparkEditorVersion		kSparkServerVersion
+/* 3.1.2: metrics */
+#define kSparkServerVersion		0x030102
+#define kSparkEditorVersion		0x030100
@@ -0,0 +1,24 @@
+/*
+ *  SDWatchdog.h
+ *  SparkServer
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+@class SDMetrics, SparkAction, SparkExecutionContext;
+
+/*
+ Execution watchdog.
+ Cancels the contexts of the actions running past their deadline and reports them in the metrics.
+ Thread safe, and runs on its own queue, so it works even if the main thread is blocked.
+ A context is not used anymore once -endExecution: returns, so it can be recycled.
+ */
+@interface SDWatchdog : NSObject
+
+- (instancetype)initWithMetrics:(SDMetrics *)metrics;
+
+- (void)beginExecution:(SparkExecutionContext *)aContext action:(SparkAction *)action;
+- (void)endExecution:(SparkExecutionContext *)aContext;
+
+@end
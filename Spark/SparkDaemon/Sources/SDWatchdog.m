@@ -0,0 +1,137 @@
+/*
+ *  SDWatchdog.m
+ *  SparkServer
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+#import "SDWatchdog.h"
+#import "SDMetrics.h"
+
+#import <SparkKit/SparkAction.h>
+#import <SparkKit/SparkExecutionContext.h>
+
+#include <os/lock.h>
+
+/* check interval */
+#define kSDWatchdogInterval (250 * NSEC_PER_MSEC)
+/* unused records kept for reuse */
+#define kSDWatchdogPoolSize 16
+
+@interface SDWatchdogRecord : NSObject {
+@public
+  SparkAction *sd_action;
+  BOOL sd_main;
+  BOOL sd_reported;
+}
+@end
+
+@implementation SDWatchdogRecord
+@end
+
+@implementation SDWatchdog {
+@private
+  SDMetrics *sd_metrics;
+  dispatch_queue_t sd_queue;
+  dispatch_source_t sd_timer;
+  /* protects sd_running, sd_executions and sd_records */
+  os_unfair_lock sd_lock;
+  BOOL sd_running;
+  /* context => record */
+  NSMapTable *sd_executions;
+  /* unused records */
+  NSMutableArray *sd_records;
+}
+
+- (instancetype)initWithMetrics:(SDMetrics *)metrics {
+  if (self = [super init]) {
+    sd_metrics = metrics;
+    sd_lock = OS_UNFAIR_LOCK_INIT;
+    sd_queue = dispatch_queue_create("org.shadowlab.spark.watchdog", DISPATCH_QUEUE_SERIAL);
+    sd_executions = [NSMapTable strongToStrongObjectsMapTable];
+    sd_records = [[NSMutableArray alloc] init];
+    sd_timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, sd_queue);
+    dispatch_source_set_timer(sd_timer, dispatch_time(DISPATCH_TIME_NOW, kSDWatchdogInterval), kSDWatchdogInterval, kSDWatchdogInterval / 4);
+    __weak SDWatchdog *watchdog = self;
+    dispatch_source_set_event_handler(sd_timer, ^{
+      [watchdog check];
+    });
+  }
+  return self;
+}
+
+- (void)dealloc {
+  /* a suspended source can not be cancelled */
+  if (!sd_running)
+    dispatch_resume(sd_timer);
+  dispatch_source_cancel(sd_timer);
+}
+
+#pragma mark -
+/* MUST be called on sd_queue */
+- (void)check {
+  NSMutableArray *overruns = nil;
+  os_unfair_lock_lock(&sd_lock);
+  for (SparkExecutionContext *ctxt in sd_executions) {
+    SDWatchdogRecord *record = [sd_executions objectForKey:ctxt];
+    if (!record->sd_reported && ctxt.remainingTime <= 0) {
+      record->sd_reported = YES;
+      /* under the lock, so the context can not be recycled meanwhile */
+      [ctxt cancel];
+      if (!overruns)
+        overruns = [[NSMutableArray alloc] init];
+      [overruns addObject:@[record->sd_action, @(record->sd_main)]];
+    }
+  }
+  os_unfair_lock_unlock(&sd_lock);
+
+  for (NSArray *overrun in overruns) {
+    SparkAction *action = overrun[0];
+    SPXLogWarning(@"Action %@ exceeded its deadline%@", action.name,
+                  [overrun[1] boolValue] ? @" (main thread blocked)" : @"");
+    [sd_metrics recordOverrunOfAction:action];
+  }
+}
+
+/* Records are reused and the registration is done in place, so watching an execution does not allocate */
+- (void)beginExecution:(SparkExecutionContext *)aContext action:(SparkAction *)action {
+  if (aContext.deadline <= 0)
+    return;
+  os_unfair_lock_lock(&sd_lock);
+  SDWatchdogRecord *record = [sd_records lastObject];
+  if (record)
+    [sd_records removeLastObject];
+  else
+    record = [[SDWatchdogRecord alloc] init];
+  record->sd_action = action;
+  record->sd_main = [NSThread isMainThread];
+  record->sd_reported = NO;
+  [sd_executions setObject:record forKey:aContext];
+  if (!sd_running) {
+    sd_running = YES;
+    dispatch_resume(sd_timer);
+  }
+  os_unfair_lock_unlock(&sd_lock);
+}
+
+- (void)endExecution:(SparkExecutionContext *)aContext {
+  if (aContext.deadline <= 0)
+    return;
+  os_unfair_lock_lock(&sd_lock);
+  SDWatchdogRecord *record = [sd_executions objectForKey:aContext];
+  if (record) {
+    record->sd_action = nil;
+    if ([sd_records count] < kSDWatchdogPoolSize)
+      [sd_records addObject:record];
+    [sd_executions removeObjectForKey:aContext];
+  }
+  /* no execution to watch */
+  if (sd_running && 0 == [sd_executions count]) {
+    sd_running = NO;
+    dispatch_suspend(sd_timer);
+  }
+  os_unfair_lock_unlock(&sd_lock);
+}
+
+@end
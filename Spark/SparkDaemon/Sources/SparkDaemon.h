@@ -8,14 +8,20 @@
 
 #import <SparkKit/SparkServerProtocol.h>
 #import <SparkKit/SparkAppleScriptSuite.h>
+#import <SparkKit/SparkLibraryObserver.h>
 
 @class SparkApplication, SparkEntry;
 @class SparkLibrary, SparkDistantLibrary;
+@class SDMetrics, SDScheduler, SDRepeatEngine, SDWatchdog;
 
 @interface SparkDaemon : NSObject<NSApplicationDelegate> {
   SparkLibrary *sd_library;
   SparkApplication *sd_front;
   SparkDistantLibrary *sd_rlibrary;
+  SDMetrics *sd_metrics;
+  SDScheduler *sd_scheduler;
+  SDRepeatEngine *sd_repeat;
+  SDWatchdog *sd_watchdog;
 }
 
 - (BOOL)openConnection;
@@ -37,24 +43,27 @@
 
 @end
 
-@interface SparkDaemon (SparkServerProtocol) <SparkServer>
+@interface SparkDaemon (SparkServerProtocol) <SparkServer, SparkLibraryObserver>
 
 - (UInt32)version;
 - (void)shutdown;
 
 - (id<SparkLibrary>)library;
 
-#pragma mark Notifications
-- (void)didAddEntry:(NSNotification *)aNotification;
-- (void)didUpdateEntry:(NSNotification *)aNotification;
-- (void)didRemoveEntry:(NSNotification *)aNotification;
-- (void)didChangeEntryStatus:(NSNotification *)aNotification;
+- (NSDictionary *)metrics;
 
-- (void)didChangePlugInStatus:(NSNotification *)aNotification;
+#pragma mark Library Observer
+- (void)library:(SparkLibrary *)library didAddEntry:(SparkEntry *)anEntry;
+- (void)library:(SparkLibrary *)library didUpdateEntry:(SparkEntry *)anEntry previous:(SparkEntry *)previous;
+- (void)library:(SparkLibrary *)library didRemoveEntry:(SparkEntry *)anEntry;
+- (void)library:(SparkLibrary *)library didChangeEntryStatus:(SparkEntry *)anEntry;
+
+/* triggers and applications */
+- (void)library:(SparkLibrary *)library willRemoveObject:(SparkObject *)anObject fromSet:(SparkObjectSet *)aSet;
+- (void)library:(SparkLibrary *)library didChangeApplicationStatus:(SparkApplication *)anApplication;
 
-- (void)willRemoveTrigger:(NSNotification *)aNotification;
-- (void)willRemoveApplication:(NSNotification *)aNotification;
-- (void)didChangeApplicationStatus:(NSNotification *)aNotification;
+#pragma mark Notifications
+- (void)didChangePlugInStatus:(NSNotification *)aNotification;
 
 @end
 
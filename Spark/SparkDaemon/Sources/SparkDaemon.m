@@ -8,6 +8,10 @@
 
 #import "SparkDaemon.h"
 #import "SDAEHandlers.h"
+#import "SDMetrics.h"
+#import "SDScheduler.h"
+#import "SDRepeatEngine.h"
+#import "SDWatchdog.h"
 
 #import <SparkKit/SparkEvent.h>
 #import <SparkKit/SparkPrivate.h>
@@ -23,11 +27,15 @@
 #import <SparkKit/SparkEntry.h>
 #import <SparkKit/SparkAction.h>
 #import <SparkKit/SparkTrigger.h>
+#import <SparkKit/SparkHotKey.h>
+#import <SparkKit/SparkExecutionContext.h>
 #import <SparkKit/SparkApplication.h>
 #import <SparkKit/SparkActionLoader.h>
 
 #import <WonderBox/WBProcessFunctions.h>
 
+#include <mach/mach_time.h>
+
 #if defined (DEBUG)
 #import <WonderBox/WBAEFunctions.h>
 #import <HotKeyToolKit/HotKeyToolKit.h>
@@ -60,10 +68,15 @@ int main(int argc, const char *argv[]) {
 
 static int SparkDaemonContext = 0;
 
+static
+void _SDDiscardEvent(void *context, SparkEvent *anEvent) {
+  [(__bridge SDRepeatEngine *)context didExecuteEvent:anEvent];
+  [SparkEvent recycleEvent:anEvent];
+}
+
 @implementation SparkDaemon {
   BOOL sd_disabled;
   NSConnection *sd_connection;
-  NSMutableDictionary *sd_plugin_queues;
 }
 
 - (BOOL)application:(NSApplication *)sender delegateHandlesKey:(NSString *)key {
@@ -76,46 +89,15 @@ static int SparkDaemonContext = 0;
     sd_rlibrary = nil;
     if (sd_library) {
       /* Unregister triggers */
-      [[sd_library notificationCenter] removeObserver:self];
+      [sd_library removeLibraryObserver:self];
       [self unregisterEntries];
       [sd_library unload];
       sd_front = nil;
     }
     sd_library = aLibrary;
     if (sd_library) {
-      NSNotificationCenter *center = sd_library.notificationCenter;
-      [center addObserver:self
-                 selector:@selector(willRemoveTrigger:)
-                     name:SparkObjectSetWillRemoveObjectNotification
-                   object:[sd_library triggerSet]];
-      
-      /* Application observer */
-      [center addObserver:self
-                 selector:@selector(didChangeApplicationStatus:)
-                     name:SparkApplicationDidChangeEnabledNotification
-                   object:nil];
-      [center addObserver:self
-                 selector:@selector(willRemoveApplication:)
-                     name:SparkObjectSetWillRemoveObjectNotification
-                   object:[sd_library applicationSet]];
-      
-      /* Entries observer */
-      [center addObserver:self
-                 selector:@selector(didAddEntry:)
-                     name:SparkEntryManagerDidAddEntryNotification 
-                   object:[sd_library entryManager]];
-      [center addObserver:self
-                 selector:@selector(didUpdateEntry:)
-                     name:SparkEntryManagerDidUpdateEntryNotification 
-                   object:[sd_library entryManager]];
-      [center addObserver:self
-                 selector:@selector(didRemoveEntry:)
-                     name:SparkEntryManagerDidRemoveEntryNotification 
-                   object:[sd_library entryManager]];
-      [center addObserver:self
-                 selector:@selector(didChangeEntryStatus:)
-                     name:SparkEntryManagerDidChangeEntryStatusNotification 
-                   object:[sd_library entryManager]];
+      /* triggers, applications and entries observer */
+      [sd_library addLibraryObserver:self];
       
       /* If library not loaded, load library */
       if (![sd_library isLoaded])
@@ -135,7 +117,12 @@ static int SparkDaemonContext = 0;
     if (![self openConnection]) {
       return nil;
     } else {
-      sd_plugin_queues = [[NSMutableDictionary alloc] init];
+      sd_scheduler = [[SDScheduler alloc] init];
+      sd_metrics = [[SDMetrics alloc] init];
+      sd_watchdog = [[SDWatchdog alloc] initWithMetrics:sd_metrics];
+      sd_repeat = [[SDRepeatEngine alloc] init];
+      /* coalesced events are not executed, the repeat engine must not wait for them */
+      [sd_scheduler setDiscardFunction:_SDDiscardEvent context:(__bridge void *)sd_repeat];
 #if defined (DEBUG)
       [[NSUserDefaults standardUserDefaults] registerDefaults:
   @{
@@ -153,6 +140,14 @@ static int SparkDaemonContext = 0;
           [self handleSparkEvent:event];
         }
       }];
+      /* hotkeys repeat is driven by the repeat engine */
+      SDRepeatEngine *repeat = sd_repeat;
+      SparkHotKeySetRepeatHandler(^(SparkHotKey *hotkey, SparkEntry *entry, BOOL pressed, NSTimeInterval eventTime) {
+        if (pressed)
+          [repeat keyPressed:hotkey entry:entry];
+        else
+          [repeat keyReleased:hotkey];
+      });
       /* Init core Apple Event handlers */
       [NSScriptSuiteRegistry sharedScriptSuiteRegistry];
       
@@ -182,7 +177,11 @@ static int SparkDaemonContext = 0;
 }
 
 - (void)finishStartup:(id)sender {
-  [self setActiveLibrary:SparkActiveLibrary()];
+  /* the active library is loaded when it is looked up */
+  uint64_t start = mach_absolute_time();
+  SparkLibrary *library = SparkActiveLibrary();
+  sd_metrics.libraryLoadTime = SDAbsoluteTimeToNanoseconds(mach_absolute_time() - start) / 1e9;
+  [self setActiveLibrary:library];
   [[NSNotificationCenter defaultCenter] addObserver:self
                                            selector:@selector(didChangePlugInStatus:)
                                                name:SparkPlugInDidChangeStatusNotification
@@ -293,6 +292,7 @@ static int SparkDaemonContext = 0;
 }
 
 - (void)unregisterEntries {
+  [sd_repeat releaseAllKeys];
   [sd_library.entryManager enumerateEntriesUsingBlock:^(SparkEntry *entry, BOOL *stop) {
     @try {
       entry.registred = NO;
@@ -321,60 +321,84 @@ static int SparkDaemonContext = 0;
     SparkDisplayAlert(anAlert);
 }
 
-- (SparkAlert *)_executeEvent:(SparkEvent *)anEvent {
+- (SparkAlert *)_executeEvent:(SparkEvent *)anEvent dispatchTime:(uint64_t)dispatched {
   SparkAlert *alert = nil;
   SparkEntry *entry = [anEvent entry];
+  SparkAction *action = entry.action;
+  BOOL failed = NO;
   /* Warning: trigger can be release during [action performAction] */
   SPXDebug(@"Start handle event (%@): %@", [NSThread currentThread], anEvent);
+  uint64_t start = mach_absolute_time();
+  [sd_metrics recordDispatchDuration:SDAbsoluteTimeToNanoseconds(start - dispatched)];
+  SparkExecutionContext *ctxt = [SparkExecutionContext contextWithTimeout:action.timeout];
   [SparkEvent setCurrentEvent:anEvent];
+  [SparkExecutionContext setCurrentContext:ctxt];
+  [sd_watchdog beginExecution:ctxt action:action];
   @try {
     /* Action exists and is enabled */
-    alert = [entry.action performAction];
+    alert = [action performAction];
+    failed = alert != nil;
   } @catch (id exception) {
     // TODO: alert = [SparkAlert alertFromException:exception context:plugin, action, ...];
     SPXLogException(exception);
     NSBeep();
+    failed = YES;
   }
+  [sd_watchdog endExecution:ctxt];
+  [SparkExecutionContext setCurrentContext:nil];
+  [SparkExecutionContext recycleContext:ctxt];
   [SparkEvent setCurrentEvent:nil];
+  [sd_metrics recordExecutionOfAction:action
+                               plugIn:[[SparkActionLoader sharedLoader] plugInForAction:action].identifier
+                             duration:SDAbsoluteTimeToNanoseconds(mach_absolute_time() - start)
+                               failed:failed];
   SPXDebug(@"End handle event (%@): %@", [NSThread currentThread], anEvent);
   
   return alert;
 }
 
-- (void)_executeEventAsync:(SparkEvent *)anEvent {
-  SparkAction *action = anEvent.entry.action;
-
-  dispatch_queue_t queue;
-  if (action.supportsConcurrentRequests) {
-    queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
-  } else {
-    SparkPlugIn *plugin = [[SparkActionLoader sharedLoader] plugInForAction:action];
-    NSAssert(plugin, @"invalid action triggered");
-    queue = sd_plugin_queues[plugin.identifier];
-    if (!queue) {
-      queue = dispatch_queue_create(plugin.identifier.UTF8String, DISPATCH_QUEUE_SERIAL);
-      sd_plugin_queues[plugin.identifier] = queue;
+- (void)_executeScheduledEvent:(SparkEvent *)anEvent dispatchTime:(uint64_t)dispatched {
+  /* the key may have been released while the repeat was queued */
+  if (![sd_repeat shouldExecuteEvent:anEvent]) {
+    [sd_repeat didExecuteEvent:anEvent];
+    [SparkEvent recycleEvent:anEvent];
+    return;
+  }
+  SparkAlert *alert = [self _executeEvent:anEvent dispatchTime:dispatched];
+  [sd_repeat didExecuteEvent:anEvent];
+  [SparkEvent recycleEvent:anEvent];
+  if (alert) {
+    if ([NSThread isMainThread]) {
+      [self _displayError:alert];
+    } else {
+      dispatch_async(dispatch_get_main_queue(), ^{
+        [self _displayError:alert];
+      });
     }
   }
+}
 
-  dispatch_async(queue, ^{
-    @autoreleasepool {
-      SparkAlert *alert = [self _executeEvent:anEvent];
-      if (alert) {
-        dispatch_async(dispatch_get_main_queue(), ^{
-          [self _displayError:alert];
-        });
-      }
-    }
-  });
+static
+void _SDExecuteEvent(void *context, SparkEvent *anEvent, uint64_t dispatched) {
+  [(__bridge SparkDaemon *)context _executeScheduledEvent:anEvent dispatchTime:dispatched];
+}
+
+- (void)_scheduleEvent:(SparkEvent *)anEvent dispatchTime:(uint64_t)dispatched {
+  /* the daemon lives as long as the process, no need to retain it */
+  if (![sd_scheduler scheduleEvent:anEvent dispatchTime:dispatched function:_SDExecuteEvent context:(__bridge void *)self]) {
+    [sd_repeat didExecuteEvent:anEvent];
+    [SparkEvent recycleEvent:anEvent];
+  }
 }
 
 - (void)handleSparkEvent:(SparkEvent *)anEvent {
+  uint64_t dispatched = mach_absolute_time();
   Boolean trapping;
   /* If Spark Editor is trapping, forward keystroke */
   if ([anEvent type] == kSparkEventTypeBypass || ((noErr == SDGetEditorIsTrapping(&trapping)) && trapping)) {
     SPXDebug(@"Bypass event or Spark Editor is trapping => bypass");
     [[anEvent trigger] bypass];
+    [SparkEvent recycleEvent:anEvent];
     return;
   }
 
@@ -384,20 +408,19 @@ static int SparkDaemonContext = 0;
   /* If daemon is disabled, only persistent action are performed */
   if ([self isEnabled] || [[anEvent entry] isPersistent]) {
     bypass = false;
-    SparkAction *action = [[anEvent entry] action];
-    /* if does not support concurrency => check if already running for safety */
-    if ([action needsToBeRunOnMainThread]) {
-      SparkAlert *alert = [self _executeEvent:anEvent];
-      if (alert)
-        [self _displayError:alert];
-    } else {
-      [self _executeEventAsync:anEvent];
-    }
+    /* main thread actions are deferred too, so the event loop is not blocked */
+    [self _scheduleEvent:anEvent dispatchTime:dispatched];
   }
 
-  if (bypass) [[anEvent trigger] bypass];
-
-  SPXDebug(@"End dispatch event: %@", anEvent);
+  if (bypass) {
+    SPXDebug(@"End dispatch event: %@", anEvent);
+    [sd_repeat didExecuteEvent:anEvent];
+    [[anEvent trigger] bypass];
+    [SparkEvent recycleEvent:anEvent];
+  } else {
+    /* the event is owned by the scheduler now */
+    SPXDebug(@"End dispatch event");
+  }
 }
 
 - (void)run {
@@ -14,6 +14,8 @@
 #import <WonderBox/WBLSFunctions.h>
 #import <WonderBox/NSImage+WonderBox.h>
 
+#import "SparkLibraryPrivate.h"
+
 static
 NSString * const kSparkApplicationKey = @"SparkApplication";
 
@@ -213,6 +215,7 @@ NSString * const SparkApplicationDidChangeEnabledNotification = @"SparkApplicati
   if (disabled != sp_appFlags.disabled) {
     [[self.library.undoManager prepareWithInvocationTarget:self] setEnabled:sp_appFlags.disabled];
     /* post notification */
+    [[[self library] notifiedObservers] didChangeApplicationStatus:self];
     SparkLibraryPostNotification([self library], SparkApplicationDidChangeEnabledNotification, self, nil);
   }
 }
@@ -20,6 +20,7 @@
 
 #import "SparkEntryPrivate.h"
 #import "SparkLibraryPrivate.h"
+#import "SparkUndoJournal.h"
 #import "SparkEntryManagerPrivate.h"
 
 static
@@ -135,8 +136,9 @@ NSString * const SparkEntryWillRemoveChildNotification = @"SparkEntryWillRemoveC
   if (enabled != _seFlags.enabled && _manager) {
 		SparkLibrary *library = [_manager library];
 		/* Undo management */
-		[[library.undoManager prepareWithInvocationTarget:self] setEnabled:!flag];
+		[[library undoJournal] recordEntry:self enabled:!flag];
 		/* notification */
+		[[library notifiedObservers] didChangeEntryStatus:self];
 		SparkLibraryPostNotification(library, SparkEntryManagerDidChangeEntryStatusNotification, _manager, self);
   }
 }
@@ -180,9 +182,7 @@ NSString * const SparkEntryWillRemoveChildNotification = @"SparkEntryWillRemoveC
 - (void)setRepresentation:(NSString *)name {
   if (name && [name length]) {
 		/* register the undo here (instead of into action) to trigger observer notification when undoing */
-		[_action.library.undoManager registerUndoWithTarget:self
-                                               selector:@selector(setRepresentation:)
-                                                 object:_action.name];
+		[_action.library.undoJournal recordEntry:self name:_action.name];
     _action.name = name;
   } else {
     NSBeep();
@@ -11,6 +11,8 @@
 #import "SparkEntryManagerPrivate.h"
 #import "SparkEntryPrivate.h"
 #import "SparkLibraryPrivate.h"
+#import "SparkUndoJournal.h"
+#import "SparkUIDTable.h"
 
 #import <objc/objc-runtime.h>
 #import <SparkKit/SparkPrivate.h>
@@ -21,6 +23,7 @@
 #import <SparkKit/SparkTrigger.h>
 #import <SparkKit/SparkObjectSet.h>
 #import <SparkKit/SparkApplication.h>
+#import <SparkKit/SparkLibraryObserver.h>
 
 /* PlugIn status */
 #import <SparkKit/SparkPlugIn.h>
@@ -37,9 +40,18 @@ NSString * const SparkEntryManagerDidRemoveEntryNotification = @"SparkEntryManag
 
 NSString * const SparkEntryManagerDidChangeEntryStatusNotification = @"SparkEntryManagerDidChangeEntryStatus";
 
+@interface SparkEntryManager () <SparkLibraryObserver>
+
+@end
+
 @implementation SparkEntryManager {
 @private
-  NSMutableDictionary *_objects;
+  /* entry uid => entry */
+  SparkUIDTable *_objects;
+  /* trigger uid => entries, used to detect conflicts */
+  SparkUIDTable *_triggers;
+  /* last entry uid */
+  SparkUID _uid;
 
   /* editing context */
   SparkEntry *_entry;
@@ -59,7 +71,8 @@ NSString * const SparkEntryManagerDidChangeEntryStatusNotification = @"SparkEntr
   NSParameterAssert(aLibrary);
   if (self = [super init]) {
     self.library = aLibrary;
-    _objects = [[NSMutableDictionary alloc] init];
+    _objects = [[SparkUIDTable alloc] init];
+    _triggers = [[SparkUIDTable alloc] init];
     [[NSNotificationCenter defaultCenter] addObserver:self
                                              selector:@selector(didChangePlugInStatus:) 
                                                  name:SparkPlugInDidChangeStatusNotification
@@ -74,14 +87,11 @@ NSString * const SparkEntryManagerDidChangeEntryStatusNotification = @"SparkEntr
 
 - (void)setLibrary:(SparkLibrary *)library {
 	if (_library) {
-		[_library.notificationCenter removeObserver:self];
+		[_library removeLibraryObserver:self];
 	}
   _library = library;
 	if (_library) {
-		[_library.notificationCenter addObserver:self
-                                    selector:@selector(didRemoveApplication:)
-                                        name:SparkObjectSetDidRemoveObjectNotification
-                                      object:_library.applicationSet];
+		[_library addLibraryObserver:self];
 	}
 }
 
@@ -92,13 +102,34 @@ NSString * const SparkEntryManagerDidChangeEntryStatusNotification = @"SparkEntr
 #pragma mark -
 #pragma mark Query
 - (void)enumerateEntriesUsingBlock:(void (^)(SparkEntry *entry, BOOL *stop))block {
-  [_objects enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL *stop) {
-    block(obj, stop);
-  }];
+  [_objects enumerateObjectsUsingBlock:block];
 }
 
 - (SparkEntry *)entryWithUID:(SparkUID)uid {
-  return _objects[@(uid)];
+  return [_objects objectForUID:uid];
+}
+
+/* entries using a trigger (usually one or two) */
+- (NSArray *)sp_entriesForTrigger:(SparkUID)uid {
+  return [_triggers objectForUID:uid];
+}
+
+- (void)sp_indexEntry:(SparkEntry *)anEntry {
+  SparkUID trigger = anEntry.triggerUID;
+  NSMutableArray *entries = [_triggers objectForUID:trigger];
+  if (!entries) {
+    entries = [[NSMutableArray alloc] initWithCapacity:1];
+    [_triggers setObject:entries forUID:trigger];
+  }
+  [entries addObject:anEntry];
+}
+
+- (void)sp_unindexEntry:(SparkEntry *)anEntry {
+  SparkUID trigger = anEntry.triggerUID;
+  NSMutableArray *entries = [_triggers objectForUID:trigger];
+  [entries removeObjectIdenticalTo:anEntry];
+  if (entries && ![entries count])
+    [_triggers removeObjectForUID:trigger];
 }
 
 typedef SparkUID (*SparkEntryAccessor)(SparkEntry *, SEL);
@@ -128,14 +159,11 @@ typedef SparkUID (*SparkEntryAccessor)(SparkEntry *, SEL);
 }
 
 - (BOOL)containsEntryForTrigger:(SparkUID)aTrigger application:(SparkUID)anApplication {
-  __block BOOL found = NO;
-  [self enumerateEntriesUsingBlock:^(SparkEntry *entry, BOOL *stop) {
-    if ([entry triggerUID] == aTrigger && [entry applicationUID] == anApplication) {
-      found = YES;
-      *stop = YES;
-    }
-  }];
-  return found;
+  for (SparkEntry *entry in [self sp_entriesForTrigger:aTrigger]) {
+    if ([entry applicationUID] == anApplication)
+      return YES;
+  }
+  return NO;
 }
 
 #pragma mark -
@@ -153,14 +181,16 @@ typedef SparkUID (*SparkEntryAccessor)(SparkEntry *, SEL);
   NSParameterAssert([anEntry manager] == self);
 	
   /* Undo management */
-  [[self.undoManager prepareWithInvocationTarget:self] addEntry:anEntry parent:[anEntry parent]];
+  [[[self library] undoJournal] recordRemoveEntry:anEntry parent:[anEntry parent]];
   
   // Will remove
+  [[[self library] notifiedObservers] willRemoveEntry:anEntry];
   SparkLibraryPostNotification([self library], SparkEntryManagerWillRemoveEntryNotification, self, anEntry);
   
   [self sp_removeEntry:anEntry];
 	
   // Did remove
+  [[[self library] notifiedObservers] didRemoveEntry:anEntry];
   SparkLibraryPostNotification([self library], SparkEntryManagerDidRemoveEntryNotification, self, anEntry);
 }
 
@@ -176,7 +206,7 @@ typedef SparkUID (*SparkEntryAccessor)(SparkEntry *, SEL);
   return [self entriesForField:@selector(actionUID) uid:[anAction uid]];
 }
 - (NSArray *)entriesForTrigger:(SparkTrigger *)aTrigger {
-  return [self entriesForField:@selector(triggerUID) uid:[aTrigger uid]];
+  return [[self sp_entriesForTrigger:[aTrigger uid]] copy] ? : @[];
 }
 - (NSArray *)entriesForApplication:(SparkApplication *)anApplication {
   return [self entriesForField:@selector(applicationUID) uid:[anApplication uid]];
@@ -189,59 +219,48 @@ typedef SparkUID (*SparkEntryAccessor)(SparkEntry *, SEL);
   return [self containsEntryForField:@selector(actionUID) uid:[anAction uid]];
 }
 - (BOOL)containsEntryForTrigger:(SparkTrigger *)aTrigger {
-  return [self containsEntryForField:@selector(triggerUID) uid:[aTrigger uid]];
+  return [[self sp_entriesForTrigger:[aTrigger uid]] count] > 0;
 }
 - (BOOL)containsEntryForApplication:(SparkApplication *)anApplication {
   return [self containsEntryForField:@selector(applicationUID) uid:[anApplication uid]];
 }
 
 - (BOOL)containsRegistredEntryForTrigger:(SparkTrigger *)aTrigger {
-  __block BOOL found = NO;
-  SparkUID uid = [aTrigger uid];
-  [_objects enumerateKeysAndObjectsUsingBlock:^(id key, SparkEntry *entry, BOOL *stop) {
-    if ((entry.triggerUID == uid) && entry.registred) {
-      found = YES;
-      *stop = YES;
-    }
-  }];
-  return found;
+  for (SparkEntry *entry in [self sp_entriesForTrigger:[aTrigger uid]]) {
+    if (entry.registred)
+      return YES;
+  }
+  return NO;
 }
 
 #pragma mark -
 - (SparkEntry *)activeEntryForTrigger:(SparkTrigger *)aTrigger application:(SparkApplication *)anApplication {
-  __block SparkEntry *result = nil;
-  SparkUID trigger = [aTrigger uid];
   SparkUID application = [anApplication uid];
-  [_objects enumerateKeysAndObjectsUsingBlock:^(id key, SparkEntry *entry, BOOL *stop) {
-    if ([entry triggerUID] == trigger && [entry isActive]) {
-      if ([entry applicationUID] == application) {
-        /* an active entry match */
-        result = entry;
-        *stop = YES;
-      }
-    }
-  }];
-	return result;
+  for (SparkEntry *entry in [self sp_entriesForTrigger:[aTrigger uid]]) {
+    /* an active entry match */
+    if ([entry applicationUID] == application && [entry isActive])
+      return entry;
+  }
+	return nil;
 }
 
 - (SparkEntry *)resolveEntryForTrigger:(SparkTrigger *)aTrigger application:(SparkApplication *)anApplication {
-  __block SparkEntry *def = nil;
-  __block SparkEntry *result = nil;
+  SparkEntry *def = nil;
+  SparkEntry *result = nil;
 
-  SparkUID trigger = [aTrigger uid];
   SparkUID application = [anApplication uid];
   /* special case: anApplication is "All Application" (0) => def will always be null after the loop, so we don't have to do something special */
-  [_objects enumerateKeysAndObjectsUsingBlock:^(id key, SparkEntry *entry, BOOL *stop) {
-    if ([entry triggerUID] == trigger && [entry isActive] && [entry isRegistred]) {
+  for (SparkEntry *entry in [self sp_entriesForTrigger:[aTrigger uid]]) {
+    if ([entry isActive] && [entry isRegistred]) {
       if ([entry applicationUID] == application) {
         /* an active entry match */
         result = entry;
-        *stop = YES;
+        break;
       } else if (entry.isSystem) {
         def = entry;
       }
     }
-  }];
+  }
 
   if (result)
     return result;
@@ -258,18 +277,6 @@ typedef SparkUID (*SparkEntryAccessor)(SparkEntry *, SEL);
 @end
 
 
-@interface SparkEntry (SparkEntryInternal)
-/* direct object access */
-@property(nonatomic, readonly) NSArray *children;
-
-/* children */
-- (void)addChild:(SparkEntry *)aChild;
-- (void)addChildrenFromArray:(NSArray *)children;
-
-- (void)removeChild:(SparkEntry *)aChild;
-- (void)removeAllChildren;
-@end
-
 @implementation SparkEntryManager (SparkEntryEditor)
 
 - (void)beginEditing:(SparkEntry *)anEntry {
@@ -336,22 +343,23 @@ typedef SparkUID (*SparkEntryAccessor)(SparkEntry *, SEL);
   /* sanity check, avoid entry conflict */
   NSParameterAssert(![anEntry isEnabled] || ![self activeEntryForTrigger:[anEntry trigger] application:[anEntry application]]);
 
-  /* Undo management */
-  [[self undoManager] registerUndoWithTarget:self selector:@selector(removeEntry:) object:anEntry];
-
   // Will add
   SparkLibraryPostNotification([self library], SparkEntryManagerWillAddEntryNotification, self, anEntry);
 
   [self sp_addEntry:anEntry parent:parent];
 
+  /* Undo management (once the entry has an uid) */
+  [[[self library] undoJournal] recordAddEntry:anEntry];
+
   // Did add
+  [[[self library] notifiedObservers] didAddEntry:anEntry];
   SparkLibraryPostNotification([self library], SparkEntryManagerDidAddEntryNotification, self, anEntry);
 }
 
 - (void)updateEntry:(SparkEntry *)anEntry setAction:(SparkAction *)newAction
             trigger:(SparkTrigger *)newTrigger application:(SparkApplication *)newApplication {
   NSParameterAssert([anEntry manager] == self);
-  NSParameterAssert(_objects[@(anEntry.uid)]);
+  NSParameterAssert([_objects objectForUID:anEntry.uid]);
 
   /* check conflict before undo and notify to avoid inconsistency */
   if (anEntry.enabled && (newTrigger || newApplication)) {
@@ -365,33 +373,49 @@ typedef SparkUID (*SparkEntryAccessor)(SparkEntry *, SEL);
   SparkEntry *ghost = [anEntry copy];
 
   /* undo manager */
-  [[self.undoManager prepareWithInvocationTarget:self] updateEntry:anEntry
-                                                         setAction:newAction ? anEntry.action : nil
-                                                           trigger:newTrigger ? anEntry.trigger : nil
-                                                       application:newApplication ? anEntry.application : nil];
+  [self.library.undoJournal recordUpdateEntry:anEntry
+                                       action:newAction ? anEntry.action : nil
+                                      trigger:newTrigger ? anEntry.trigger : nil
+                                  application:newApplication ? anEntry.application : nil];
   // will update
   SparkLibraryPostNotification(self.library, SparkEntryManagerWillUpdateEntryNotification, self, anEntry);
 
+  /* variants sharing the parent action, and their previous state */
+  NSMutableArray *children = nil, *previous = nil;
   if (newAction) {
     anEntry.action = newAction;
 
     /* update weak entries */
     if (anEntry.isSystem && anEntry.hasVariant) {
+      children = [[NSMutableArray alloc] init];
+      previous = [[NSMutableArray alloc] init];
       SparkEntry *child = anEntry.firstChild;
       do {
-        if ([child.action isEqual:ghost.action])
+        if ([child.action isEqual:ghost.action]) {
+          SparkLibraryPostNotification(self.library, SparkEntryManagerWillUpdateEntryNotification, self, child);
+          [previous addObject:[child copy]];
+          [children addObject:child];
           child.action = newAction;
+        }
       } while ((child = child.sibling));
     }
   }
 
-  if (newTrigger)
+  if (newTrigger) {
+    [self sp_unindexEntry:anEntry];
     anEntry.trigger = newTrigger;
+    [self sp_indexEntry:anEntry];
+  }
   if (newApplication)
     anEntry.application = newApplication;
 
   // did update
+  [self.library.notifiedObservers didUpdateEntry:anEntry previous:ghost];
   SparkLibraryPostUpdateNotification(self.library, SparkEntryManagerDidUpdateEntryNotification, self, ghost, anEntry);
+  for (NSUInteger idx = 0; idx < [children count]; idx++) {
+    [self.library.notifiedObservers didUpdateEntry:children[idx] previous:previous[idx]];
+    SparkLibraryPostUpdateNotification(self.library, SparkEntryManagerDidUpdateEntryNotification, self, previous[idx], children[idx]);
+  }
 
   /* Remove orphan action */
   if (newAction && ![self containsEntryForAction:ghost.action])
@@ -402,16 +426,17 @@ typedef SparkUID (*SparkEntryAccessor)(SparkEntry *, SEL);
     [self updateTriggerStatus:ghost.trigger];
 }
 
-static SparkUID sUID = 0;
-
 - (void)sp_addEntry:(SparkEntry *)anEntry parent:(SparkEntry *)aParent {
   /* add entry */
   if (![anEntry uid]) {
-    [anEntry setUID:++sUID];
+    [anEntry setUID:++_uid];
   } else {
     SPXDebug(@"Insert entry with UID: %lu", (long)[anEntry uid]);
+    /* redo, synchronization: next uid must not collide */
+    _uid = MAX(_uid, [anEntry uid]);
   }
-  _objects[@(anEntry.uid)] = anEntry;
+  [_objects setObject:anEntry forUID:anEntry.uid];
+  [self sp_indexEntry:anEntry];
 
   /* Update trigger flag */
   if (!anEntry.isSystem)
@@ -428,7 +453,7 @@ static SparkUID sUID = 0;
 
 - (void)sp_removeEntry:(SparkEntry *)anEntry {
   NSParameterAssert(anEntry.manager == self);
-  NSParameterAssert(_objects[@(anEntry.uid)]);
+  NSParameterAssert([_objects objectForUID:anEntry.uid]);
 
   SparkAction *action = anEntry.action;
   SparkTrigger *trigger = anEntry.trigger;
@@ -439,18 +464,13 @@ static SparkUID sUID = 0;
     [anEntry.parent removeChild:anEntry];
   } else if ([anEntry isSystem] && [anEntry hasVariant]) {
     /* here undo will call addEntry:anEntry parent:nil and we have to restore the relationship */
-    [self.undoManager registerUndoWithTarget:anEntry selector:@selector(addChildrenFromArray:) object:anEntry.children];
+    [self.library.undoJournal recordRemoveChildren:anEntry.children ofEntry:anEntry];
     [anEntry removeAllChildren];
   }
   anEntry.manager = nil;
 
-  [_objects removeObjectForKey:@(anEntry.uid)];
-
-  /* when undoing, we decrement sUID */
-  if (self.undoManager.undoing) {
-    NSAssert(anEntry.uid == sUID, @"'next UID' does not match [entry uid]");
-    sUID--;
-  }
+  [_objects removeObjectForUID:anEntry.uid];
+  [self sp_unindexEntry:anEntry];
 
   /* Remove orphan action */
   if (![self containsEntryForAction:action]) {
@@ -462,23 +482,19 @@ static SparkUID sUID = 0;
 
 /* Check if contains, and update 'has many' status */
 - (void)updateTriggerStatus:(SparkTrigger *)trigger {
-  __block BOOL contains = NO;
-  __block SparkEntry *specificEntry = nil;
+  BOOL contains = NO;
+  SparkEntry *specificEntry = nil;
 
-  SparkUID tuid = trigger.uid;
-  [self enumerateEntriesUsingBlock:^(SparkEntry *entry, BOOL *stop) {
-    if (entry.triggerUID == tuid) {
-      if (!entry.isSystem) {
-        specificEntry = entry;
-        *stop = YES;
-        return;
-      } else {
-        /* it contains at least one entry, but we have to continue the loop
-         to check if it contains a system entry */
-        contains = YES;
-      }
+  for (SparkEntry *entry in [self sp_entriesForTrigger:trigger.uid]) {
+    if (!entry.isSystem) {
+      specificEntry = entry;
+      break;
+    } else {
+      /* it contains at least one entry, but we have to continue the loop
+       to check if it contains a system entry */
+      contains = YES;
     }
-  }];
+  }
   if (specificEntry) {
     [specificEntry.trigger setHasSpecificAction:YES];
   } else {
@@ -490,14 +506,18 @@ static SparkUID sUID = 0;
   }
 }
 
-#pragma mark Notification
-- (void)didRemoveApplication:(NSNotification *)aNotification {
-  [self removeEntriesInArray:[self entriesForApplication:SparkNotificationObject(aNotification)]];
+#pragma mark Library Observer
+- (void)library:(SparkLibrary *)library didRemoveObject:(SparkObject *)anObject fromSet:(SparkObjectSet *)aSet {
+  if (aSet == [library applicationSet])
+    [self removeEntriesInArray:[self entriesForApplication:(SparkApplication *)anObject]];
 }
 
 #pragma mark Entry Management - Plugged
 - (void)didChangePlugInStatus:(NSNotification *)aNotification {
   SparkPlugIn *plugin = [aNotification object];
+  /* library actions load their plugin, so there is nothing to update */
+  if (!plugin.loaded)
+    return;
 
   BOOL flag = plugin.enabled;
   Class cls = [plugin actionClass];
@@ -521,7 +541,7 @@ static SparkUID sUID = 0;
 
 - (void)cleanup {
   /* Check all triggers and actions */
-  for (SparkEntry *entry in _objects.allValues) {
+  for (SparkEntry *entry in [_objects allObjects]) {
     /* Invalid entry if:
      - action does not exists.
      - trigger does not exists.
@@ -534,7 +554,7 @@ static SparkUID sUID = 0;
       if (![entry isSystem])
         [[entry trigger] setHasSpecificAction:YES];
       /* restore UID counter */
-      sUID = MAX(sUID, [entry uid]);
+      _uid = MAX(_uid, [entry uid]);
     }
   }
 }
@@ -546,7 +566,8 @@ static SparkUID sUID = 0;
   if (self = [self initWithLibrary:[(SparkLibraryUnarchiver *)coder library]]) {
     NSArray *entries = [coder decodeObjectForKey:@"entries"];
     for (SparkEntry *entry in entries) {
-      _objects[@(entry.uid)] = entry;
+      [_objects setObject:entry forUID:entry.uid];
+      [self sp_indexEntry:entry];
       entry.manager = self;
     }
     [self cleanup];
@@ -556,7 +577,7 @@ static SparkUID sUID = 0;
 
 - (void)encodeWithCoder:(NSCoder *)coder {
   NSParameterAssert([coder isKindOfClass:[SparkLibraryArchiver class]]);
-  [coder encodeObject:_objects.allValues forKey:@"entries"];
+  [coder encodeObject:[_objects allObjects] forKey:@"entries"];
 }
 
 @end
@@ -566,15 +587,12 @@ static SparkUID sUID = 0;
 
 /* returns the firt entry that match the criterias */
 - (SparkEntry *)entryForTrigger:(SparkTrigger *)aTrigger application:(SparkApplication *)anApplication {
-  __block SparkEntry *result = nil;
-  SparkUID trigger = [aTrigger uid], application = [anApplication uid];
-  [self enumerateEntriesUsingBlock:^(SparkEntry *entry, BOOL *stop) {
-    if (entry.triggerUID == trigger && entry.applicationUID == application) {
-      result = entry;
-      *stop = YES;
-    }
-  }];
-  return result;
+  SparkUID application = [anApplication uid];
+  for (SparkEntry *entry in [self sp_entriesForTrigger:[aTrigger uid]]) {
+    if (entry.applicationUID == application)
+      return entry;
+  }
+  return nil;
 }
 
 - (void)resolveParents {
@@ -632,6 +650,8 @@ typedef struct {
 - (BOOL)readFromFileWrapper:(NSFileWrapper *)fileWrapper error:(__autoreleasing NSError **)outError {
   /* Cleanup */
   [_objects removeAllObjects];
+  [_triggers removeAllObjects];
+  _uid = 0;
 
   NSData *data = [fileWrapper regularFileContents];
 
@@ -39,3 +39,15 @@
 @property(nonatomic, readonly) SparkEntry *parent;
 
 @end
+
+@interface SparkEntry (SparkEntryInternal)
+/* direct object access */
+@property(nonatomic, readonly) NSArray *children;
+
+/* children */
+- (void)addChild:(SparkEntry *)aChild;
+- (void)addChildrenFromArray:(NSArray *)children;
+
+- (void)removeChild:(SparkEntry *)aChild;
+- (void)removeAllChildren;
+@end
@@ -39,10 +39,14 @@ SPARK_OBJC_EXPORT
 
 @property(nonatomic, readonly) CFAbsoluteTime eventTime;
 
-/* Current event */
+/* Current event (per thread). The event is not retained, the caller must reset it when done */
 + (nullable SparkEvent *)currentEvent;
 + (void)setCurrentEvent:(nullable SparkEvent *)anEvent;
 
+/* Give the event back to the pool used by the factory methods.
+ MUST only be called by the last owner of the event, once it is not used anymore. */
++ (void)recycleEvent:(SparkEvent *)anEvent;
+
 /* event dispatcher */
 + (void)sendEvent:(SparkEvent *)anEvent;
 
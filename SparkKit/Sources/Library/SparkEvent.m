@@ -9,6 +9,11 @@
 #import <SparkKit/SparkEvent.h>
 #import <SparkKit/SparkEntry.h>
 
+#include <os/lock.h>
+
+/* recycled events kept for reuse */
+#define kSparkEventPoolSize 32
+
 @implementation SparkEvent {
   id sp_data;
 
@@ -20,29 +25,61 @@
   NSTimeInterval sp_time;
 }
 
-static NSString * const SparkCurrentEventKey = @"SparkCurrentEventKey";
+static __thread __unsafe_unretained SparkEvent *sCurrentEvent = nil;
 
 + (SparkEvent *)currentEvent {
-  NSMutableDictionary *dict = [[NSThread currentThread] threadDictionary];
-  return dict[SparkCurrentEventKey];
+  return sCurrentEvent;
 }
 
 + (void)setCurrentEvent:(SparkEvent *)anEvent {
-  NSMutableDictionary *dict = [[NSThread currentThread] threadDictionary];
-  if (anEvent)
-    [dict setObject:anEvent forKey:SparkCurrentEventKey];
-  else
-    [dict removeObjectForKey:SparkCurrentEventKey];
+  sCurrentEvent = anEvent;
+}
+
+#pragma mark Pool
+static os_unfair_lock sPoolLock = OS_UNFAIR_LOCK_INIT;
+static __strong SparkEvent *sPool[kSparkEventPoolSize];
+static NSUInteger sPoolCount = 0;
+
++ (void)recycleEvent:(SparkEvent *)anEvent {
+  if ([anEvent class] != [SparkEvent class])
+    return;
+  anEvent->sp_data = nil;
+  os_unfair_lock_lock(&sPoolLock);
+  if (sPoolCount < kSparkEventPoolSize)
+    sPool[sPoolCount++] = anEvent;
+  os_unfair_lock_unlock(&sPoolLock);
+}
+
+static
+SparkEvent *SparkEventDequeue(Class cls, id data, SparkEventType type, NSTimeInterval eventTime, BOOL isRepeat) {
+  SparkEvent *event = nil;
+  if (cls == [SparkEvent class]) {
+    os_unfair_lock_lock(&sPoolLock);
+    if (sPoolCount > 0) {
+      event = sPool[--sPoolCount];
+      sPool[sPoolCount] = nil;
+    }
+    os_unfair_lock_unlock(&sPoolLock);
+  }
+  if (!event)
+    return nil;
+  event->sp_data = data;
+  event->sp_time = eventTime;
+  event->sp_evFlags.type = type;
+  event->sp_evFlags.repeat = isRepeat;
+  return event;
 }
 
 + (instancetype)eventWithEntry:(SparkEntry *)anEntry
                      eventTime:(NSTimeInterval)theEventTime isARepeat:(BOOL)isRepeat {
-  return [[self alloc] initWithEntry:anEntry eventTime:theEventTime isARepeat:isRepeat];
+  return SparkEventDequeue(self, anEntry, kSparkEventTypeEntry, theEventTime, isRepeat) ? :
+    [[self alloc] initWithEntry:anEntry eventTime:theEventTime isARepeat:isRepeat];
 }
 
 + (instancetype)eventWithTrigger:(SparkTrigger *)aTrigger
                        eventTime:(NSTimeInterval)theEventTime isARepeat:(BOOL)isRepeat {
-  return [[self alloc] initWithTrigger:aTrigger eventTime:theEventTime isARepeat:isRepeat];
+  return SparkEventDequeue(self, aTrigger, kSparkEventTypeBypass, theEventTime, isRepeat) ? :
+    [[self alloc] initWithTrigger:aTrigger eventTime:theEventTime isARepeat:isRepeat];
 }
 
 - (instancetype)initWithData:(id)anObject
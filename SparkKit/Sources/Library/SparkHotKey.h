@@ -31,6 +31,14 @@ void SparkSetFilterMode(SparkFilterMode mode);
 SPARK_EXPORT
 bool SparkHotKeyFilter(HKKeycode code, HKModifier modifier);
 
+@class SparkHotKey, SparkEntry;
+/* Key repeat: when a handler is set, hotkeys no longer repeat by themselves.
+ The handler is called on key down and key up of repeating entries and sends the repeat events. */
+typedef void(^SparkHotKeyRepeatHandler)(SparkHotKey *hotkey, SparkEntry *entry, BOOL pressed, NSTimeInterval eventTime);
+
+SPARK_EXPORT
+void SparkHotKeySetRepeatHandler(SparkHotKeyRepeatHandler handler);
+
 #pragma mark -
 /*!
 @abstract   SparkHotKey is the class that represent hotKeys used in Spark.
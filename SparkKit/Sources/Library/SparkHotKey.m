@@ -23,6 +23,13 @@ SparkFilterMode sSparkKeyStrokeFilterMode = kSparkEnableSingleFunctionKey;
 SparkFilterMode SparkGetFilterMode(void) { return sSparkKeyStrokeFilterMode; }
 void SparkSetFilterMode(SparkFilterMode mode) { sSparkKeyStrokeFilterMode = mode; }
 
+static
+SparkHotKeyRepeatHandler sSparkHotKeyRepeatHandler = nil;
+
+void SparkHotKeySetRepeatHandler(SparkHotKeyRepeatHandler handler) {
+  sSparkHotKeyRepeatHandler = [handler copy];
+}
+
 /*
  Fonction qui permet de définir la validité d'un raccouci. Depuis 10.3, les raccourcis sans "modifier" sont acceptés.
  Jugés trop génant, seul les touches Fx peuvent être utilisées sans "modifier"
@@ -91,11 +98,18 @@ bool SparkHotKeyFilter(HKKeycode code, HKModifier modifier) {
 
 @end
 
+@interface SparkHotKey ()
+- (void)prepareHotKey;
+- (void)keyStateDidChange:(BOOL)pressed eventTime:(NSTimeInterval)eventTime;
+@end
+
 #pragma mark -
 @implementation SparkHotKey {
 @private
   SparkEntry *sp_entry; // event generation helper
   SparkHKHotKey *sp_hotkey;
+  /* key repeat is handled by the repeat handler */
+  BOOL sp_repeats;
 }
 
 #pragma mark -
@@ -205,6 +219,9 @@ bool SparkHotKeyFilter(HKKeycode code, HKModifier modifier) {
 - (BOOL)isEqualToTrigger:(SparkTrigger *)aTrigger {
   return [aTrigger isKindOfClass:[SparkHotKey class]] && sp_hotkey.rawkey == ((SparkHotKey *)aTrigger)->sp_hotkey.rawkey;
 }
+- (NSUInteger)triggerHash {
+  return (NSUInteger)sp_hotkey.rawkey;
+}
 
 #pragma mark -
 - (void)trigger {
@@ -216,8 +233,13 @@ bool SparkHotKeyFilter(HKKeycode code, HKModifier modifier) {
   if (sp_entry) {
     SparkAction *action = [sp_entry action];
     NSAssert(action, @"Invalid entry. Does not contains action!");
+    sp_repeats = NO;
     if ([action performOnKeyUp]) {
       [sp_hotkey setInvokeOnKeyUp:YES];
+    } else if (sSparkHotKeyRepeatHandler) {
+      [sp_hotkey setInvokeOnKeyUp:NO];
+      [sp_hotkey setRepeatInterval:0];
+      sp_repeats = [action repeatInterval] > 0;
     } else {
       [sp_hotkey setInvokeOnKeyUp:NO];
       [sp_hotkey setRepeatInterval:[action repeatInterval]];
@@ -226,6 +248,12 @@ bool SparkHotKeyFilter(HKKeycode code, HKModifier modifier) {
   }
 }
 
+- (void)keyStateDidChange:(BOOL)pressed eventTime:(NSTimeInterval)eventTime {
+  SparkHotKeyRepeatHandler handler = sSparkHotKeyRepeatHandler;
+  if (sp_repeats && sp_entry && handler)
+    handler(self, sp_entry, pressed, eventTime);
+}
+
 //- (void)didInvoke {
 //  [sp_hotkey setInvokeOnKeyUp:NO];
 //}
@@ -311,6 +339,12 @@ NSTimeInterval SparkGetDefaultKeyRepeatInterval(void) {
   /* configure hotkey to match the attached action */
   [sp_owner prepareHotKey];
   [super keyPressed:eventTime];
+  [sp_owner keyStateDidChange:YES eventTime:eventTime];
+}
+
+- (void)keyReleased:(NSTimeInterval)eventTime {
+  [super keyReleased:eventTime];
+  [sp_owner keyStateDidChange:NO eventTime:eventTime];
 }
 
 @end
@@ -19,6 +19,10 @@ SPARK_OBJC_EXPORT
 
 - (NSImage *)iconForObject:(SparkObject *)anObject;
 
+/* Read the cached icon file on a background queue, so the next call to iconForObject: does not hit the disk.
+ handler is called on the main thread, immediately if the icon is already loaded. Must be called on the main thread. */
+- (void)loadIconForObject:(SparkObject *)anObject completionHandler:(void (^)(NSImage *icon))handler;
+
 - (void)setIcon:(NSImage *)icon forObject:(SparkObject *)anObject;
 
 - (BOOL)synchronize;
@@ -70,25 +70,14 @@ uint8_t __SparkIconTypeForObject(SparkObject *object) {
       sp_cache[idx] = [[NSMutableDictionary alloc] init];
     
     _library = aLibrary;
-    /* Listen notifications */
-    [_library.notificationCenter addObserver:self
-                                    selector:@selector(didAddObject:)
-                                        name:SparkObjectSetDidAddObjectNotification
-                                      object:nil];
-    //    [_library.notificationCenter addObserver:self
-    //                                        selector:@selector(didUpdateObject:)
-    //                                            name:SparkObjectSetDidUpdateObjectNotification
-    //                                          object:nil];
-    [_library.notificationCenter addObserver:self
-                                    selector:@selector(willRemoveObject:)
-                                        name:SparkObjectSetWillRemoveObjectNotification
-                                      object:nil];
+    /* Listen changes */
+    [_library addLibraryObserver:self];
   }
   return self;
 }
 
 - (void)dealloc {
-  [_library.notificationCenter removeObserver:self];
+  [_library removeLibraryObserver:self];
   for (NSUInteger idx = 0; idx < kSparkSetCount; idx++)
     sp_cache[idx] = nil;
 }
@@ -152,6 +141,29 @@ uint8_t __SparkIconTypeForObject(SparkObject *object) {
   return entry.icon;
 }
 
+- (void)loadIconForObject:(SparkObject *)anObject completionHandler:(void (^)(NSImage *icon))handler {
+  NSParameterAssert(handler);
+  _SparkIconEntry *entry = [self entryForObject:anObject];
+  if (!entry || [entry loaded] || !_URL) {
+    handler(entry.icon);
+    return;
+  }
+  NSURL *url = [_URL URLByAppendingPathComponent:entry.path];
+  dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+    /* read and decode the file now, instead of referencing it */
+    NSImage *icon = [[NSImage alloc] initWithContentsOfURL:url];
+    dispatch_async(dispatch_get_main_queue(), ^{
+      /* may have been loaded synchronously meanwhile */
+      if (![entry loaded]) {
+        if (!icon)
+          SPXDebug(@"Icon not found in cache for object: %@", anObject);
+        [entry setCachedIcon:icon];
+      }
+      handler(entry.icon);
+    });
+  });
+}
+
 - (void)setIcon:(NSImage *)icon forObject:(SparkObject *)anObject {
   _SparkIconEntry *entry = [self entryForObject:anObject];
   if (entry) {
@@ -202,9 +214,8 @@ uint8_t __SparkIconTypeForObject(SparkObject *object) {
   }];
 }
 
-#pragma mark Notifications
-- (void)didAddObject:(NSNotification *)aNotification {
-  SparkObject *object = SparkNotificationObject(aNotification);
+#pragma mark Library Observer
+- (void)library:(SparkLibrary *)library didAddObject:(SparkObject *)object toSet:(SparkObjectSet *)aSet {
   if ([object shouldSaveIcon] && [object hasIcon])
     [self setIcon:[object icon] forObject:object];
 }
@@ -222,8 +233,7 @@ uint8_t __SparkIconTypeForObject(SparkObject *object) {
 //  }
 //}
 
-- (void)willRemoveObject:(NSNotification *)aNotification {
-  SparkObject *object = SparkNotificationObject(aNotification);
+- (void)library:(SparkLibrary *)library willRemoveObject:(SparkObject *)object fromSet:(SparkObjectSet *)aSet {
   if ([object shouldSaveIcon])
     [self setIcon:nil forObject:object];
 }
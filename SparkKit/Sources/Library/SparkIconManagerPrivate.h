@@ -9,6 +9,7 @@
 
 #import <SparkKit/SparkKit.h>
 #import <SparkKit/SparkIconManager.h>
+#import <SparkKit/SparkLibraryObserver.h>
 
 @interface _SparkIconEntry : NSObject
 
@@ -27,7 +28,7 @@
 
 @end
 
-@interface SparkIconManager ()
+@interface SparkIconManager () <SparkLibraryObserver>
 
 - (_SparkIconEntry *)entryForObject:(SparkObject *)anObject;
 - (_SparkIconEntry *)entryForObjectType:(UInt8)type uid:(SparkUID)anUID;
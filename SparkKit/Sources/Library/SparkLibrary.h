@@ -37,6 +37,10 @@ const NSUInteger kSparkLibraryCurrentVersion;
 
 SPARK_EXPORT
 SparkLibrary *SparkActiveLibrary(void);
+/* Load the active library in background. handler is called on the main thread, with a nil library on failure.
+ Returns nil if the active library is already loaded. SparkActiveLibrary() waits for a pending load. */
+SPARK_EXPORT
+NSProgress *SparkLoadActiveLibrary(void (^handler)(SparkLibrary *library, NSError *error));
 SPARK_EXPORT
 bool SparkSetActiveLibrary(SparkLibrary *library);
 
@@ -77,10 +81,22 @@ SPARK_OBJC_EXPORT
 - (void)disableNotifications;
 
 - (NSNotificationCenter *)notificationCenter;
+/* The library notifications (SparkLibraryPostNotification) are only posted when set. Default is NO. */
+@property(nonatomic) BOOL postsLegacyNotifications;
+
+/* Transactions: group a batch of changes so observers can process them at once.
+ Transactions can be nested, only the outermost one is notified. */
+- (void)beginTransaction;
+- (void)commitTransaction;
+@property(nonatomic, readonly, getter=isInTransaction) BOOL inTransaction;
 
 - (BOOL)isLoaded;
 
 - (BOOL)load:(__autoreleasing NSError **)error;
+/* Load the library on a background queue. MUST be called on the main thread, as the plugins used by the library are loaded first.
+ The library must not be used until handler is called (on the main thread).
+ The returned progress can be used to cancel loading (handler receives a NSUserCancelledError). */
+- (NSProgress *)loadWithCompletionHandler:(void (^)(BOOL loaded, NSError *error))handler;
 - (void)unload;
 
 - (SparkObjectSet *)listSet;
@@ -101,6 +117,11 @@ SPARK_OBJC_EXPORT
 @end
 
 /* Notifications support */
+SPARK_EXPORT
+NSString * const SparkLibraryWillBeginTransactionNotification;
+SPARK_EXPORT
+NSString * const SparkLibraryDidCommitTransactionNotification;
+
 SPARK_EXPORT
 NSString * const SparkNotificationObjectKey;
 SPARK_EXPORT
@@ -116,21 +137,13 @@ id SparkNotificationUpdatedObject(NSNotification *aNotification) {
   return [[aNotification userInfo] objectForKey:SparkNotificationUpdatedObjectKey];
 }
 
-SPARK_INLINE
-void SparkLibraryPostNotification(SparkLibrary *library, NSString *name, id sender, id object) {
-  [[library notificationCenter] postNotificationName:name
-                                              object:sender
-                                            userInfo:object ? [NSDictionary dictionaryWithObject:object
-                                                                                          forKey:SparkNotificationObjectKey] : nil];
-}
-SPARK_INLINE
-void SparkLibraryPostUpdateNotification(SparkLibrary *library, NSString *name, id sender, id replaced, id object) {
-  [[library notificationCenter] postNotificationName:name
-                                              object:sender
-                                            userInfo:[NSDictionary dictionaryWithObjectsAndKeys:
-                                                      object, SparkNotificationObjectKey,
-                                                      replaced, SparkNotificationUpdatedObjectKey, nil]];
-}
+/* Nothing is posted (and no userInfo is created) unless the library postsLegacyNotifications
+ and somebody uses the library notification center.
+ Prefer SparkLibraryObserver (SparkLibraryObserver.h) to observe the library content. */
+SPARK_EXPORT
+void SparkLibraryPostNotification(SparkLibrary *library, NSString *name, id sender, id object);
+SPARK_EXPORT
+void SparkLibraryPostUpdateNotification(SparkLibrary *library, NSString *name, id sender, id replaced, id object);
 
 // MARK: Debugger
 SPARK_EXPORT
@@ -8,6 +8,7 @@
 
 #import <SparkKit/SparkLibrary.h>
 #import <SparkKit/SparkActionLoader.h>
+#import <SparkKit/SparkPlugIn.h>
 #import <SparkKit/SparkObjectSet.h>
 #import <SparkKit/SparkEntryManager.h>
 
@@ -26,11 +27,16 @@
 
 #import "SparkLibraryPrivate.h"
 #import "SparkEntryManagerPrivate.h"
+#import "SparkListPrivate.h"
+#import "SparkUndoJournal.h"
 
 NSString * const kSparkLibraryFileExtension = @"splib";
 
 NSPropertyListFormat SparkLibraryFileFormat = NSPropertyListBinaryFormat_v1_0;
 
+/* files, actions, triggers, applications, entries, cleanup */
+static const int64_t kSparkLibraryLoadSteps = 6;
+
 static NSString * const kSparkActionsFile = @"SparkActions";
 static NSString * const kSparkTriggersFile = @"SparkTriggers";
 static NSString * const kSparkApplicationsFile = @"SparkApplications";
@@ -52,6 +58,9 @@ NSURL *SparkLibraryIconFolder(SparkLibrary *library);
 NSString * const SparkWillSetActiveLibraryNotification = @"SparkWillSetActiveLibrary";
 NSString * const SparkDidSetActiveLibraryNotification = @"SparkDidSetActiveLibrary";
 
+NSString * const SparkLibraryWillBeginTransactionNotification = @"SparkLibraryWillBeginTransaction";
+NSString * const SparkLibraryDidCommitTransactionNotification = @"SparkLibraryDidCommitTransaction";
+
 NSString * const SparkNotificationObjectKey = @"SparkNotificationObject";
 NSString * const SparkNotificationUpdatedObjectKey = @"SparkNotificationUpdatedObject";
 
@@ -68,6 +77,11 @@ const NSUInteger kSparkLibraryCurrentVersion = kSparkLibraryVersion_2_1;
 - (BOOL)loadFromWrapper:(NSFileWrapper *)wrapper error:(NSError **)error;
 - (BOOL)readLibraryFromFileWrapper:(NSFileWrapper *)wrapper error:(NSError **)error;
 
+/* update the background loading progress. Returns NO if loading was cancelled */
+- (BOOL)loadStepDidComplete:(NSError **)error;
+
+- (NSProgress *)loadInGroup:(dispatch_group_t)group completionHandler:(void (^)(BOOL loaded, NSError *error))handler;
+
 @end
 
 @interface SparkLibrary (SparkLegacyReader)
@@ -78,6 +92,32 @@ const NSUInteger kSparkLibraryCurrentVersion = kSparkLibraryVersion_2_1;
 - (void)removeEntriesForAction:(SparkUID)action;
 @end
 
+@interface SparkLibrary ()
+- (NSNotificationCenter *)sp_postingCenter;
+@end
+
+#pragma mark Notifications
+void SparkLibraryPostNotification(SparkLibrary *library, NSString *name, id sender, id object) {
+  NSNotificationCenter *center = [library sp_postingCenter];
+  if (center) {
+    [center postNotificationName:name
+                          object:sender
+                        userInfo:object ? [NSDictionary dictionaryWithObject:object
+                                                                      forKey:SparkNotificationObjectKey] : nil];
+  }
+}
+
+void SparkLibraryPostUpdateNotification(SparkLibrary *library, NSString *name, id sender, id replaced, id object) {
+  NSNotificationCenter *center = [library sp_postingCenter];
+  if (center) {
+    [center postNotificationName:name
+                          object:sender
+                        userInfo:[NSDictionary dictionaryWithObjectsAndKeys:
+                                  object, SparkNotificationObjectKey,
+                                  replaced, SparkNotificationUpdatedObjectKey, nil]];
+  }
+}
+
 @implementation SparkLibrary {
 @private
   NSUUID *_uuid;
@@ -90,11 +130,23 @@ const NSUInteger kSparkLibraryCurrentVersion = kSparkLibraryVersion_2_1;
     unsigned int loaded:1;
     unsigned int unnotify:8;
     unsigned int syncPrefs:1;
-    unsigned int reserved:22;
+    unsigned int transaction:8;
+    unsigned int legacy:1;
+    unsigned int reserved:13;
   } _slFlags;
 
   /* Model synchronization */
   NSNotificationCenter *_center;
+  /* dispatch entry changes to lists */
+  SparkListRouter *_lists;
+  /* typed observers */
+  SparkLibraryObservers *_observers;
+  /* compact undo records */
+  SparkUndoJournal *_journal;
+  /* background loading */
+  NSProgress *_progress;
+  /* action classes of the saved library (Info.plist) */
+  NSArray *_actionClasses;
 
   /* Preferences */
   NSMutableDictionary *_prefs;
@@ -107,7 +159,7 @@ const NSUInteger kSparkLibraryCurrentVersion = kSparkLibraryVersion_2_1;
 
 + (void)initialize {
   if ([SparkLibrary class] == self) {
-    /* Register Built-In PlugIn (and make sure other plugins are loaded) */
+    /* Register Built-In PlugIn (and make sure other plugins are registered, their code is loaded on demand) */
     [[SparkActionLoader sharedLoader] loadPlugIns];
     [[SparkActionLoader sharedLoader] registerPlugInClass:[SparkBuiltInActionPlugIn class]];
   }
@@ -205,6 +257,62 @@ const NSUInteger kSparkLibraryCurrentVersion = kSparkLibraryVersion_2_1;
   return _center;
 }
 
+- (SparkListRouter *)listRouter {
+  if (!_lists)
+    _lists = [[SparkListRouter alloc] initWithLibrary:self];
+  return _lists;
+}
+
+- (SparkLibraryObservers *)observers {
+  if (!_observers)
+    _observers = [[SparkLibraryObservers alloc] initWithLibrary:self];
+  return _observers;
+}
+
+- (SparkLibraryObservers *)notifiedObservers {
+  return _slFlags.unnotify > 0 ? nil : _observers;
+}
+
+- (BOOL)postsLegacyNotifications {
+  return _slFlags.legacy;
+}
+- (void)setPostsLegacyNotifications:(BOOL)flag {
+  SPXFlagSet(_slFlags.legacy, flag);
+}
+
+/* does not create the notification center */
+- (NSNotificationCenter *)sp_postingCenter {
+  return (_slFlags.unnotify > 0 || !_slFlags.legacy) ? nil : _center;
+}
+
+- (SparkUndoJournal *)undoJournal {
+  if (!_journal)
+    _journal = [[SparkUndoJournal alloc] initWithLibrary:self];
+  return _journal;
+}
+
+#pragma mark Transactions
+- (BOOL)isInTransaction {
+  return _slFlags.transaction > 0;
+}
+
+- (void)beginTransaction {
+  NSParameterAssert(_slFlags.transaction < 255);
+  if (0 == _slFlags.transaction++) {
+    [_observers beginTransaction];
+    SparkLibraryPostNotification(self, SparkLibraryWillBeginTransactionNotification, self, nil);
+  }
+}
+
+- (void)commitTransaction {
+  NSParameterAssert(_slFlags.transaction > 0);
+  if (0 == --_slFlags.transaction) {
+    /* delivers the changes recorded since the transaction began */
+    [_observers commitTransaction];
+    SparkLibraryPostNotification(self, SparkLibraryDidCommitTransactionNotification, self, nil);
+  }
+}
+
 #pragma mark FileSystem Methods
 - (void)setURL:(NSURL *)url {
   if (url != _url) {
@@ -251,7 +359,7 @@ const NSUInteger kSparkLibraryCurrentVersion = kSparkLibraryVersion_2_1;
   [_undoManager disableUndoRegistration];
   
   NSFileWrapper *wrapper = [[NSFileWrapper alloc] initWithURL:self.URL options:0 error:error];
-  if (wrapper) {
+  if (wrapper && [self loadStepDidComplete:error]) {
     @try {
       result = [self loadFromWrapper:wrapper error:error];
     } @catch (id exception) {
@@ -267,6 +375,10 @@ const NSUInteger kSparkLibraryCurrentVersion = kSparkLibraryVersion_2_1;
   return result;
 }
 
+- (NSProgress *)loadWithCompletionHandler:(void (^)(BOOL loaded, NSError *error))handler {
+  return [self loadInGroup:dispatch_group_create() completionHandler:handler];
+}
+
 - (void)unload {
   if (![self isLoaded])
     SPXThrowException(NSInternalInconsistencyException, @"<%@ %p> is not loaded.", [self class], self);
@@ -382,9 +494,18 @@ const NSUInteger kSparkLibraryCurrentVersion = kSparkLibraryVersion_2_1;
     if (data)
       [library addRegularFileWithContents:data preferredFilename:kSparkLibraryPreferencesFile];
 
-    /* Library infos */
+    /* Library infos. Action classes tell which plugins must be loaded before reading the library */
+    NSMutableSet *classes = [[NSMutableSet alloc] init];
+    [self.actionSet enumerateObjectsUsingBlock:^(SparkObject *action, BOOL *stop) {
+      /* the plugin of a place holder may be installed later */
+      NSString *name = [action isKindOfClass:[SparkPlaceHolder class]] ?
+        [(SparkPlaceHolder *)action values][kWBSerializationClassKey] : NSStringFromClass([action class]);
+      if (name)
+        [classes addObject:name];
+    }];
     NSDictionary *info = @{ @"Version": @(kSparkLibraryCurrentVersion),
-                            @"UUID": [_uuid UUIDString] };
+                            @"UUID": [_uuid UUIDString],
+                            @"ActionClasses": [classes allObjects] };
     data = [NSPropertyListSerialization dataWithPropertyList:info
                                                       format:NSPropertyListXMLFormat_v1_0
                                                      options:0 error:NULL];
@@ -435,6 +556,63 @@ const NSUInteger kSparkLibraryCurrentVersion = kSparkLibraryVersion_2_1;
 #pragma mark -
 @implementation SparkLibrary (SparkLibraryLoader)
 
+- (BOOL)loadStepDidComplete:(__autoreleasing NSError **)error {
+  if (!_progress)
+    return YES;
+  if ([_progress isCancelled]) {
+    if (error)
+      *error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSUserCancelledError userInfo:nil];
+    return NO;
+  }
+  _progress.completedUnitCount++;
+  return YES;
+}
+
+/* Plugin code can only be loaded on the main thread (see -[SparkPlugIn load]) */
+- (void)loadPlugInsForActions {
+  SparkActionLoader *loader = [SparkActionLoader sharedLoader];
+  if (!_actionClasses) {
+    /* library saved by a previous version */
+    for (SparkPlugIn *plugin in [loader plugIns])
+      [plugin load];
+    return;
+  }
+  for (NSString *name in _actionClasses) {
+    if ([name isKindOfClass:[NSString class]])
+      [[loader plugInForActionClassName:name] load];
+  }
+}
+
+- (NSProgress *)loadInGroup:(dispatch_group_t)group completionHandler:(void (^)(BOOL loaded, NSError *error))handler {
+  NSAssert([NSThread isMainThread], @"MUST be called on the main thread");
+  if ([self isLoaded])
+    SPXThrowException(NSInternalInconsistencyException, @"<%@ %p> is already loaded.", [self class], self);
+
+  /* so the actions can be read in background */
+  [self loadPlugInsForActions];
+
+  NSProgress *progress = [[NSProgress alloc] initWithParent:nil userInfo:nil];
+  progress.totalUnitCount = kSparkLibraryLoadSteps;
+  progress.cancellable = YES;
+  progress.pausable = NO;
+
+  __block BOOL loaded = NO;
+  __block NSError *error = nil;
+  dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+    /* the library is not shared until the handler is called */
+    self->_progress = progress;
+    NSError *err = nil;
+    loaded = [self load:&err];
+    error = err;
+    self->_progress = nil;
+  });
+  dispatch_group_notify(group, dispatch_get_main_queue(), ^{
+    if (handler)
+      handler(loaded, error);
+  });
+  return progress;
+}
+
 - (void)setInfo:(NSDictionary *)plist {
   if (plist) {
     /* Load uuid */
@@ -447,7 +625,9 @@ const NSUInteger kSparkLibraryCurrentVersion = kSparkLibraryVersion_2_1;
     }
     /* Library version */
     _version = [plist[@"Version"] integerValue];
+    _actionClasses = plist[@"ActionClasses"];
   } else {
+    _actionClasses = nil;
     _version = kSparkLibraryCurrentVersion;
     _uuid = [NSUUID UUID];
   }
@@ -481,7 +661,7 @@ const NSUInteger kSparkLibraryCurrentVersion = kSparkLibraryVersion_2_1;
         return NO;
       case kSparkLibraryVersion_2_0:
       case kSparkLibraryVersion_2_1:
-        result = [self readLibraryFromFileWrapper:wrapper error:error];
+        result = [self readLibraryFromFileWrapper:wrapper error:error] && [self loadStepDidComplete:error];
         break;
     }
   } else {
@@ -524,7 +704,10 @@ const NSUInteger kSparkLibraryCurrentVersion = kSparkLibraryVersion_2_1;
     }
     
     [self restoreReservedObjects];
+    _progress.completedUnitCount = kSparkLibraryLoadSteps;
   } else {
+    /* release the partially loaded content */
+    SPXFlagSet(_slFlags.loaded, YES);
     [self unload];
   }
   
@@ -546,15 +729,15 @@ const NSUInteger kSparkLibraryCurrentVersion = kSparkLibraryVersion_2_1;
   }
   
   SparkObjectSet *set = self.actionSet;
-  ok = [set readFromFileWrapper:files[kSparkActionsFile] error:error];
+  ok = [set readFromFileWrapper:files[kSparkActionsFile] error:error] && [self loadStepDidComplete:error];
   spx_require(ok, bail);
   
   set = self.triggerSet;
-  ok = [set readFromFileWrapper:files[kSparkTriggersFile] error:error];
+  ok = [set readFromFileWrapper:files[kSparkTriggersFile] error:error] && [self loadStepDidComplete:error];
   spx_require(ok, bail);
   
   set = self.applicationSet;
-  ok = [set readFromFileWrapper:files[kSparkApplicationsFile] error:error];
+  ok = [set readFromFileWrapper:files[kSparkApplicationsFile] error:error] && [self loadStepDidComplete:error];
   spx_require(ok, bail);
 
   switch (_version) {
@@ -736,8 +919,80 @@ void SparkLibraryUnregisterLibrary(SparkLibrary *library) {
 }
 
 static SparkLibrary *sActiveLibrary = nil;
+
+/* active library being loaded in background */
+static SparkLibrary *sPendingLibrary = nil;
+static dispatch_group_t sPendingGroup = NULL;
+static NSProgress *sPendingProgress = nil;
+static BOOL sPendingResync = NO;
+
+/* returns the default library (not loaded) */
+static
+SparkLibrary *SparkFindActiveLibrary(BOOL *resync) {
+  *resync = NO;
+  /* Get default library path */
+  NSURL *path = SparkDefaultLibraryPath();
+  SparkLibrary *active = SparkLibraryGetLibraryAtURL(path, NO);
+  if (!active) {
+    /* First, try to find library in old location */
+    NSURL *old = SparkLibraryPreviousLibraryPath();
+    if (![old checkResourceIsReachableAndReturnError:NULL]) {
+      /* Try to find an old version library */
+      old = SparkLibraryVersion1LibraryPath();
+      if ([old checkResourceIsReachableAndReturnError:NULL]) {
+        *resync = YES;
+        active = [[SparkLibrary alloc] initWithURL:old];
+      } else {
+        *resync = YES;
+        active = [[SparkLibrary alloc] init];
+      }
+    } else {
+      /* Version 3 library exists in old location */
+      if ([[NSFileManager defaultManager] moveItemAtURL:old toURL:path error:NULL]) {
+        active = [[SparkLibrary alloc] initWithURL:path];
+      } else {
+        *resync = YES;
+        active = [[SparkLibrary alloc] initWithURL:old];
+      }
+    }
+  }
+  return active;
+}
+
+static
+void SparkActivateLibrary(SparkLibrary *active, BOOL resync) {
+  if (resync) {
+    active.URL = SparkDefaultLibraryPath();
+    [active synchronize];
+  }
+  SparkSetActiveLibrary(active);
+}
+
+/* Must be called once the pending load is done */
+static
+void SparkCompletePendingLibrary(void) {
+  SparkLibrary *active = sPendingLibrary;
+  sPendingLibrary = nil;
+  sPendingProgress = nil;
+  if ([active isLoaded])
+    SparkActivateLibrary(active, sPendingResync);
+}
+
 SparkLibrary *SparkActiveLibrary(void) {
   static bool loading = false;
+  if (!sActiveLibrary && sPendingLibrary) {
+    /* the loading thread must not wait for itself.
+     Code running while loading must use the library it belongs to instead of the active one */
+    if (![NSThread isMainThread]) {
+      SPXLogWarning(@"%s() called while loading the library", __func__);
+      return nil;
+    }
+    /* do not load the library twice. Loading never waits for the main thread, so it is safe to block it */
+    dispatch_group_wait(sPendingGroup, DISPATCH_TIME_FOREVER);
+    SparkCompletePendingLibrary();
+    if (!sActiveLibrary)
+      SPXThrowException(NSInternalInconsistencyException, @"An error prevent default library loading");
+  }
   if (!sActiveLibrary) {
     if (loading) {
       SPXThrowException(NSInternalInconsistencyException, @"%s() is not reentrant", __func__);
@@ -745,49 +1000,55 @@ SparkLibrary *SparkActiveLibrary(void) {
     
     loading = true;
     BOOL resync = NO;
-    /* Get default library path */
-    NSURL *path = SparkDefaultLibraryPath();
-    SparkLibrary *active = SparkLibraryGetLibraryAtURL(path, NO);
-    if (!active) {
-      /* First, try to find library in old location */
-      NSURL *old = SparkLibraryPreviousLibraryPath();
-      if (![old checkResourceIsReachableAndReturnError:NULL]) {
-        /* Try to find an old version library */
-        old = SparkLibraryVersion1LibraryPath();
-        if ([old checkResourceIsReachableAndReturnError:NULL]) {
-          resync = YES;
-          active = [[SparkLibrary alloc] initWithURL:old];
-        } else {
-          resync = YES;
-          active = [[SparkLibrary alloc] init];
-        }
-      } else {
-        /* Version 3 library exists in old location */
-        if ([[NSFileManager defaultManager] moveItemAtURL:old toURL:path error:NULL]) {
-          active = [[SparkLibrary alloc] initWithURL:path];
-        } else {
-          resync = YES;
-          active = [[SparkLibrary alloc] initWithURL:old];
-        }
-      }
-    }
+    SparkLibrary *active = SparkFindActiveLibrary(&resync);
     
     /* Read library */
     if (![active isLoaded] && ![active load:nil]) {
       loading = false;
       active = nil;
       SPXThrowException(NSInternalInconsistencyException, @"An error prevent default library loading");
-    } else if (resync) {
-      active.URL = path;
-      [active synchronize];
     }
     if (active)
-      SparkSetActiveLibrary(active);
+      SparkActivateLibrary(active, resync);
     loading = false;
   }
   return sActiveLibrary;
 }
 
+NSProgress *SparkLoadActiveLibrary(void (^handler)(SparkLibrary *library, NSError *error)) {
+  NSCParameterAssert([NSThread isMainThread]);
+  void (^complete)(NSError *) = ^(NSError *error) {
+    /* SparkActiveLibrary() may have completed the load */
+    if (sPendingLibrary)
+      SparkCompletePendingLibrary();
+    if (handler)
+      handler(sActiveLibrary, sActiveLibrary ? nil : error);
+  };
+
+  if (sPendingLibrary) {
+    dispatch_group_notify(sPendingGroup, dispatch_get_main_queue(), ^{ complete(nil); });
+    return sPendingProgress;
+  }
+
+  SparkLibrary *active = sActiveLibrary;
+  if (!active) {
+    active = SparkFindActiveLibrary(&sPendingResync);
+    if ([active isLoaded]) {
+      SparkActivateLibrary(active, sPendingResync);
+    } else {
+      sPendingLibrary = active;
+      if (!sPendingGroup)
+        sPendingGroup = dispatch_group_create();
+      sPendingProgress = [active loadInGroup:sPendingGroup completionHandler:^(BOOL loaded, NSError *error) {
+        complete(error);
+      }];
+      return sPendingProgress;
+    }
+  }
+  dispatch_async(dispatch_get_main_queue(), ^{ complete(nil); });
+  return nil;
+}
+
 bool SparkSetActiveLibrary(SparkLibrary *library) {
   NSCParameterAssert(!library || [library isLoaded]);
   if (sActiveLibrary != library) {
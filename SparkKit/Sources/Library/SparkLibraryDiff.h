@@ -0,0 +1,51 @@
+/*
+ *  SparkLibraryDiff.h
+ *  SparkKit
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+#import <SparkKit/SparkKit.h>
+
+@class SparkLibrary, SparkObject, SparkEntry;
+
+/* Content hash, independent of the object uid and library.
+ Triggers are identified by their raw hotkey, and applications by their bundle identifier. */
+SPARK_EXPORT
+uint64_t SparkObjectContentHash(SparkObject *anObject);
+
+/* Entries are identified by their trigger and application. The content is the action and status. */
+SPARK_EXPORT
+uint64_t SparkEntryKeyHash(SparkEntry *anEntry);
+SPARK_EXPORT
+uint64_t SparkEntryContentHash(SparkEntry *anEntry);
+
+/*
+ Minimal set of entry changes required to turn a library into an other one.
+ Computed in linear time using content hashes, so it does not depend on the
+ uids used by each library.
+ */
+SPARK_OBJC_EXPORT
+@interface SparkLibraryDiff : NSObject
+
+- (instancetype)initWithLibrary:(SparkLibrary *)aLibrary target:(SparkLibrary *)target;
+
+@property(nonatomic, readonly) SparkLibrary *library;
+@property(nonatomic, readonly) SparkLibrary *target;
+
+/* entries of target */
+@property(nonatomic, readonly) NSArray *addedEntries;
+/* entries of library */
+@property(nonatomic, readonly) NSArray *removedEntries;
+/* entries of library => entries of target */
+@property(nonatomic, readonly) NSMapTable *updatedEntries;
+
+@property(nonatomic, readonly, getter=isEmpty) BOOL empty;
+
+/* Apply the changes to library in a single transaction. Missing objects are copied from target.
+ If merge is YES, entries that do not exist in target are kept (import), else they are removed, and
+ preferences and applications are reverted to the target ones (revert). */
+- (void)applyMerging:(BOOL)merge;
+
+@end
@@ -0,0 +1,394 @@
+/*
+ *  SparkLibraryDiff.m
+ *  SparkKit
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+#import <SparkKit/SparkLibraryDiff.h>
+
+#import <SparkKit/SparkEntry.h>
+#import <SparkKit/SparkAction.h>
+#import <SparkKit/SparkHotKey.h>
+#import <SparkKit/SparkLibrary.h>
+#import <SparkKit/SparkObjectSet.h>
+#import <SparkKit/SparkApplication.h>
+#import <SparkKit/SparkEntryManager.h>
+#import <SparkKit/SparkPreferences.h>
+#import <SparkKit/SparkPrivate.h>
+
+#import "SparkEntryManagerPrivate.h"
+
+#import <objc/runtime.h>
+
+extern NSString * const kSparkObjectUIDKey;
+extern NSString * const kSparkObjectIconKey;
+
+/* FNV-1a */
+static const uint64_t kSparkHashSeed = 0xcbf29ce484222325ULL;
+
+SPARK_INLINE
+uint64_t __SparkHashBytes(uint64_t hash, const void *bytes, size_t length) {
+  const uint8_t *ptr = bytes;
+  for (size_t idx = 0; idx < length; idx++) {
+    hash ^= ptr[idx];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+SPARK_INLINE
+uint64_t __SparkHashValue(uint64_t hash, uint64_t value) {
+  return __SparkHashBytes(hash, &value, sizeof(value));
+}
+
+static
+uint64_t __SparkHashString(uint64_t hash, NSString *str) {
+  NSData *data = [str dataUsingEncoding:NSUTF8StringEncoding];
+  return __SparkHashBytes(hash, [data bytes], [data length]);
+}
+
+uint64_t SparkObjectContentHash(SparkObject *anObject) {
+  if (!anObject)
+    return 0;
+  const char *cls = class_getName([anObject class]);
+  uint64_t hash = __SparkHashBytes(kSparkHashSeed, cls, strlen(cls));
+
+  /* built-in objects are the same in all libraries */
+  if ([anObject uid] <= kSparkLibraryReserved)
+    return __SparkHashValue(hash, [anObject uid]);
+
+  if ([anObject isKindOfClass:[SparkHotKey class]]) {
+    SparkHotKey *hotkey = (SparkHotKey *)anObject;
+    return __SparkHashValue(hash, (uint64_t)[hotkey keycode] << 32 | [hotkey nativeModifier]);
+  }
+  if ([anObject isKindOfClass:[SparkApplication class]]) {
+    NSString *identifier = [(SparkApplication *)anObject bundleIdentifier];
+    if (identifier)
+      return __SparkHashString(hash, [identifier lowercaseString]);
+  }
+
+  /* serialized values, without uid and icon */
+  NSMutableDictionary *plist = [[NSMutableDictionary alloc] init];
+  if (![anObject serialize:plist])
+    return __SparkHashString(hash, [anObject name]);
+  [plist removeObjectForKey:kSparkObjectUIDKey];
+  [plist removeObjectForKey:kSparkObjectIconKey];
+  /* XML property list keys are sorted, so the output is stable */
+  NSData *data = [NSPropertyListSerialization dataWithPropertyList:plist format:NSPropertyListXMLFormat_v1_0 options:0 error:NULL];
+  return __SparkHashBytes(hash, [data bytes], [data length]);
+}
+
+SPARK_INLINE
+uint64_t __SparkEntryKeyHash(uint64_t trigger, uint64_t application) {
+  return __SparkHashValue(__SparkHashValue(kSparkHashSeed, trigger), application);
+}
+
+SPARK_INLINE
+uint64_t __SparkEntryContentHash(uint64_t action, SparkEntry *anEntry) {
+  uint64_t hash = __SparkHashValue(kSparkHashSeed, action);
+  hash = __SparkHashValue(hash, [anEntry isEnabled] ? 1 : 0);
+  /* weak variants follow their parent action */
+  return __SparkHashValue(hash, kSparkEntryTypeWeakOverWrite == [anEntry type] ? 1 : 0);
+}
+
+uint64_t SparkEntryKeyHash(SparkEntry *anEntry) {
+  return __SparkEntryKeyHash(SparkObjectContentHash([anEntry trigger]), SparkObjectContentHash([anEntry application]));
+}
+
+uint64_t SparkEntryContentHash(SparkEntry *anEntry) {
+  return __SparkEntryContentHash(SparkObjectContentHash([anEntry action]), anEntry);
+}
+
+#pragma mark -
+@implementation SparkLibraryDiff {
+@private
+  /* object => hash, objects are shared by entries */
+  NSMapTable *sp_hashes;
+  /* hash => object of library, built when applying */
+  NSMutableDictionary *sp_actions;
+  NSMutableDictionary *sp_triggers;
+  NSMutableDictionary *sp_applications;
+  /* preferences or applications properties differ (revert only) */
+  BOOL sp_properties;
+}
+
+- (instancetype)initWithLibrary:(SparkLibrary *)aLibrary target:(SparkLibrary *)target {
+  NSParameterAssert(aLibrary && target);
+  if (self = [super init]) {
+    _library = aLibrary;
+    _target = target;
+    sp_hashes = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality
+                                      valueOptions:NSPointerFunctionsStrongMemory];
+    [self compare];
+  }
+  return self;
+}
+
+- (uint64_t)hashForObject:(SparkObject *)anObject {
+  NSNumber *hash = [sp_hashes objectForKey:anObject];
+  if (!hash) {
+    hash = @(SparkObjectContentHash(anObject));
+    [sp_hashes setObject:hash forKey:anObject];
+  }
+  return [hash unsignedLongLongValue];
+}
+
+- (uint64_t)keyForEntry:(SparkEntry *)anEntry {
+  return __SparkEntryKeyHash([self hashForObject:[anEntry trigger]], [self hashForObject:[anEntry application]]);
+}
+
+- (uint64_t)contentForEntry:(SparkEntry *)anEntry {
+  return __SparkEntryContentHash([self hashForObject:[anEntry action]], anEntry);
+}
+
+- (void)compare {
+  /* key => entries of library (disabled entries may share a trigger and an application) */
+  NSMutableDictionary *entries = [[NSMutableDictionary alloc] init];
+  [[_library entryManager] enumerateEntriesUsingBlock:^(SparkEntry *entry, BOOL *stop) {
+    NSNumber *key = @([self keyForEntry:entry]);
+    NSMutableArray *candidates = entries[key];
+    if (!candidates) {
+      candidates = [[NSMutableArray alloc] initWithCapacity:1];
+      entries[key] = candidates;
+    }
+    [candidates addObject:entry];
+  }];
+
+  NSMutableArray *added = [[NSMutableArray alloc] init];
+  NSMapTable *updated = [NSMapTable strongToStrongObjectsMapTable];
+  [[_target entryManager] enumerateEntriesUsingBlock:^(SparkEntry *entry, BOOL *stop) {
+    NSMutableArray *candidates = entries[@([self keyForEntry:entry])];
+    if (![candidates count]) {
+      [added addObject:entry];
+    } else {
+      /* prefer an entry with the same content */
+      uint64_t content = [self contentForEntry:entry];
+      NSUInteger idx = [candidates indexOfObjectPassingTest:^BOOL(SparkEntry *current, NSUInteger i, BOOL *end) {
+        return [self contentForEntry:current] == content;
+      }];
+      if (NSNotFound == idx) {
+        idx = 0;
+        [updated setObject:entry forKey:candidates[idx]];
+      }
+      [candidates removeObjectAtIndex:idx];
+    }
+  }];
+  _addedEntries = added;
+  _updatedEntries = updated;
+  NSMutableArray *removed = [[NSMutableArray alloc] init];
+  for (NSArray *candidates in [entries objectEnumerator])
+    [removed addObjectsFromArray:candidates];
+  _removedEntries = removed;
+
+  NSDictionary *prefs = [_library preferences], *tprefs = [_target preferences];
+  sp_properties = (prefs || tprefs) && ![prefs isEqualToDictionary:tprefs];
+  if (!sp_properties)
+    sp_properties = ![[self applicationsStateOfLibrary:_library] isEqualToSet:[self applicationsStateOfLibrary:_target]];
+}
+
+/* content, status and name of each application */
+- (NSSet *)applicationsStateOfLibrary:(SparkLibrary *)aLibrary {
+  NSMutableSet *state = [[NSMutableSet alloc] init];
+  [[aLibrary applicationSet] enumerateObjectsUsingBlock:^(SparkApplication *application, BOOL *stop) {
+    [state addObject:@[@([self hashForObject:application]), @([application isEnabled]), [application name] ? : @""]];
+  }];
+  return state;
+}
+
+- (BOOL)isEmpty {
+  return ![_addedEntries count] && ![_removedEntries count] && ![_updatedEntries count] && !sp_properties;
+}
+
+#pragma mark Apply
+- (NSMutableDictionary *)indexForSet:(SparkObjectSet *)aSet {
+  NSMutableDictionary *index = [[NSMutableDictionary alloc] initWithCapacity:[aSet count]];
+  [aSet enumerateObjectsUsingBlock:^(SparkObject *object, BOOL *stop) {
+    if ([object uid] > kSparkLibraryReserved)
+      index[@([self hashForObject:object])] = object;
+  }];
+  return index;
+}
+
+/* find the object with the same content in library, or add a copy */
+- (id)resolveObject:(SparkObject *)anObject set:(SparkObjectSet *)aSet source:(SparkObjectSet *)source index:(NSMutableDictionary *)index {
+  if ([anObject uid] <= kSparkLibraryReserved)
+    return [aSet objectWithUID:[anObject uid]];
+
+  NSNumber *key = @([self hashForObject:anObject]);
+  SparkObject *object = index[key];
+  if (!object) {
+    OSStatus err = noErr;
+    NSMutableDictionary *plist = [[source serialize:anObject error:&err] mutableCopy];
+    /* let the set assign a new uid */
+    [plist removeObjectForKey:kSparkObjectUIDKey];
+    object = plist ? [aSet deserialize:plist error:&err] : nil;
+    if (!object) {
+      SPXLogWarning(@"Failed to copy object %@: %d", anObject, (int)err);
+      return nil;
+    }
+    /* icon is stored in the target icon cache */
+    NSImage *icon = [anObject icon];
+    if (icon && ![object hasIcon])
+      [object setIcon:icon];
+    if (![aSet addObject:object])
+      return nil;
+    index[key] = object;
+  }
+  return object;
+}
+
+- (SparkAction *)resolveAction:(SparkAction *)anAction {
+  if (!sp_actions)
+    sp_actions = [self indexForSet:[_library actionSet]];
+  return [self resolveObject:anAction set:[_library actionSet] source:[_target actionSet] index:sp_actions];
+}
+
+- (SparkTrigger *)resolveTrigger:(SparkTrigger *)aTrigger {
+  if (!sp_triggers)
+    sp_triggers = [self indexForSet:[_library triggerSet]];
+  return [self resolveObject:aTrigger set:[_library triggerSet] source:[_target triggerSet] index:sp_triggers];
+}
+
+- (SparkApplication *)resolveApplication:(SparkApplication *)anApplication {
+  if (!sp_applications)
+    sp_applications = [self indexForSet:[_library applicationSet]];
+  return [self resolveObject:anApplication set:[_library applicationSet] source:[_target applicationSet] index:sp_applications];
+}
+
+- (void)addEntry:(SparkEntry *)anEntry {
+  SparkEntryManager *manager = [_library entryManager];
+  SparkTrigger *trigger = [self resolveTrigger:[anEntry trigger]];
+  SparkApplication *application = [self resolveApplication:[anEntry application]];
+  if (!trigger || !application)
+    return;
+
+  SparkEntry *entry = nil;
+  SparkEntry *root = [anEntry isRoot] ? nil : [manager entryForTrigger:trigger application:[_library systemApplication]];
+  if (root && kSparkEntryTypeWeakOverWrite == [anEntry type]) {
+    entry = [root createWeakVariantWithApplication:application];
+  } else {
+    SparkAction *action = [self resolveAction:[anEntry action]];
+    if (!action)
+      return;
+    if (root)
+      entry = [root createVariantWithAction:action trigger:trigger application:application];
+    else
+      entry = [manager addEntryWithAction:action trigger:trigger application:application];
+  }
+  if ([entry isEnabled] != [anEntry isEnabled])
+    [entry setEnabled:[anEntry isEnabled]];
+}
+
+- (void)applyMerging:(BOOL)merge {
+  SparkEntryManager *manager = [_library entryManager];
+  /* objects that may no longer be used */
+  NSHashTable *orphans = [NSHashTable hashTableWithOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality];
+
+  [_library beginTransaction];
+
+  if (!merge && [_removedEntries count]) {
+    /* variants first, so roots do not remove them */
+    NSMutableArray *entries = [[NSMutableArray alloc] initWithCapacity:[_removedEntries count]];
+    for (SparkEntry *entry in _removedEntries) {
+      if (![entry isRoot])
+        [entries addObject:entry];
+      [orphans addObject:[entry action]];
+      [orphans addObject:[entry trigger]];
+    }
+    for (SparkEntry *entry in _removedEntries) {
+      if ([entry isRoot])
+        [entries addObject:entry];
+    }
+    [manager removeEntriesInArray:entries];
+  }
+
+  for (SparkEntry *entry in _updatedEntries) {
+    SparkEntry *source = [_updatedEntries objectForKey:entry];
+    if ([self hashForObject:[entry action]] != [self hashForObject:[source action]]) {
+      SparkAction *action = [self resolveAction:[source action]];
+      if (action) {
+        [orphans addObject:[entry action]];
+        [entry beginEditing];
+        [entry replaceAction:action];
+        [entry endEditing];
+      }
+    }
+    if ([entry isEnabled] != [source isEnabled])
+      [entry setEnabled:[source isEnabled]];
+  }
+
+  /* roots first, so variants can be attached */
+  for (SparkEntry *entry in _addedEntries) {
+    if ([entry isRoot])
+      [self addEntry:entry];
+  }
+  for (SparkEntry *entry in _addedEntries) {
+    if (![entry isRoot])
+      [self addEntry:entry];
+  }
+
+  if ([orphans count]) {
+    [manager enumerateEntriesUsingBlock:^(SparkEntry *entry, BOOL *stop) {
+      [orphans removeObject:[entry action]];
+      [orphans removeObject:[entry trigger]];
+    }];
+    for (SparkObject *object in orphans) {
+      if ([object uid] <= kSparkLibraryReserved)
+        continue;
+      if ([object isKindOfClass:[SparkAction class]])
+        [[_library actionSet] removeObject:object];
+      else
+        [[_library triggerSet] removeObject:object];
+    }
+  }
+
+  if (!merge && sp_properties) {
+    [self revertApplications];
+    [self revertPreferences];
+  }
+
+  [_library commitTransaction];
+}
+
+/* applications of target with their status and name. Others are not used anymore, see -applyMerging: */
+- (void)revertApplications {
+  SparkObjectSet *applications = [_library applicationSet];
+  NSMutableDictionary *unused = [self indexForSet:applications];
+  [[_target applicationSet] enumerateObjectsUsingBlock:^(SparkApplication *application, BOOL *stop) {
+    [unused removeObjectForKey:@([self hashForObject:application])];
+    SparkApplication *current = [self resolveApplication:application];
+    if (!current)
+      return;
+    if ([application name] && ![[current name] isEqualToString:[application name]])
+      [current setName:[application name]];
+    if ([current isEnabled] != [application isEnabled])
+      [current setEnabled:[application isEnabled]];
+  }];
+  if ([unused count]) {
+    [[_library entryManager] enumerateEntriesUsingBlock:^(SparkEntry *entry, BOOL *stop) {
+      [unused removeObjectForKey:@([self hashForObject:[entry application]])];
+    }];
+    [applications removeObjectsInArray:[unused allValues]];
+  }
+}
+
+- (void)revertPreferences {
+  NSDictionary *prefs = [[_library preferences] copy], *tprefs = [_target preferences];
+  if (_library != SparkActiveLibrary()) {
+    [_library setPreferences:tprefs];
+    return;
+  }
+  /* notify observers and send the values to the daemon */
+  for (NSString *key in prefs) {
+    if (!tprefs[key])
+      SparkPreferencesSetValue(key, nil, SparkPreferencesLibrary);
+  }
+  for (NSString *key in tprefs) {
+    if (![prefs[key] isEqual:tprefs[key]])
+      SparkPreferencesSetValue(key, tprefs[key], SparkPreferencesLibrary);
+  }
+}
+
+@end
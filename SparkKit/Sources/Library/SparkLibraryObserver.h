@@ -0,0 +1,71 @@
+/*
+ *  SparkLibraryObserver.h
+ *  SparkKit
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+#import <SparkKit/SparkLibrary.h>
+
+@class SparkObject, SparkObjectSet, SparkEntry, SparkApplication;
+
+/*
+ Changes made in a transaction.
+ Changes are coalesced: an entry added and removed in the same transaction is not reported,
+ an entry added then updated is only reported as added, and an entry enabled then disabled is not reported.
+ */
+SPARK_OBJC_EXPORT
+@interface SparkLibraryChanges : NSObject
+
+@property(nonatomic, readonly) NSSet *addedEntries;
+@property(nonatomic, readonly) NSSet *updatedEntries;
+@property(nonatomic, readonly) NSSet *removedEntries;
+/* entries whose status changed (not added or removed) */
+@property(nonatomic, readonly) NSSet *toggledEntries;
+
+- (NSSet *)addedObjectsInSet:(SparkObjectSet *)aSet;
+- (NSSet *)removedObjectsInSet:(SparkObjectSet *)aSet;
+
+/* applications whose status changed */
+@property(nonatomic, readonly) NSSet *toggledApplications;
+
+@property(nonatomic, readonly, getter=isEmpty) BOOL empty;
+
+@end
+
+/*
+ Library observers receive direct callbacks, only for the events they implement.
+ Observers are not retained. Callbacks are not sent while library notifications are disabled.
+ */
+@protocol SparkLibraryObserver <NSObject>
+@optional
+
+/* Object sets */
+- (void)library:(SparkLibrary *)library didAddObject:(SparkObject *)anObject toSet:(SparkObjectSet *)aSet;
+- (void)library:(SparkLibrary *)library willRemoveObject:(SparkObject *)anObject fromSet:(SparkObjectSet *)aSet;
+- (void)library:(SparkLibrary *)library didRemoveObject:(SparkObject *)anObject fromSet:(SparkObjectSet *)aSet;
+
+/* Entries */
+- (void)library:(SparkLibrary *)library didAddEntry:(SparkEntry *)anEntry;
+/* previous is a copy of the entry before the update */
+- (void)library:(SparkLibrary *)library didUpdateEntry:(SparkEntry *)anEntry previous:(SparkEntry *)previous;
+- (void)library:(SparkLibrary *)library willRemoveEntry:(SparkEntry *)anEntry;
+- (void)library:(SparkLibrary *)library didRemoveEntry:(SparkEntry *)anEntry;
+- (void)library:(SparkLibrary *)library didChangeEntryStatus:(SparkEntry *)anEntry;
+
+/* Applications */
+- (void)library:(SparkLibrary *)library didChangeApplicationStatus:(SparkApplication *)anApplication;
+
+/* Transactions: called once when the outermost transaction is committed, with all the changes it contains.
+ Observers implementing this method may ignore the other callbacks while the library is in transaction. */
+- (void)library:(SparkLibrary *)library didCommitChanges:(SparkLibraryChanges *)changes;
+
+@end
+
+@interface SparkLibrary (SparkLibraryObserver)
+
+- (void)addLibraryObserver:(id<SparkLibraryObserver>)observer;
+- (void)removeLibraryObserver:(id<SparkLibraryObserver>)observer;
+
+@end
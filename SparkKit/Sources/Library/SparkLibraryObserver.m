@@ -0,0 +1,360 @@
+/*
+ *  SparkLibraryObserver.m
+ *  SparkKit
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+#import <SparkKit/SparkLibraryObserver.h>
+
+#import <SparkKit/SparkEntry.h>
+#import <SparkKit/SparkObjectSet.h>
+#import <SparkKit/SparkApplication.h>
+
+#import "SparkLibraryPrivate.h"
+
+@interface SparkLibraryChanges ()
+
+- (void)didAddObject:(SparkObject *)anObject toSet:(SparkObjectSet *)aSet;
+- (void)didRemoveObject:(SparkObject *)anObject fromSet:(SparkObjectSet *)aSet;
+
+- (void)didAddEntry:(SparkEntry *)anEntry;
+- (void)didUpdateEntry:(SparkEntry *)anEntry;
+- (void)didRemoveEntry:(SparkEntry *)anEntry;
+- (void)didChangeEntryStatus:(SparkEntry *)anEntry;
+
+- (void)didChangeApplicationStatus:(SparkApplication *)anApplication;
+
+@end
+
+@implementation SparkLibraryChanges {
+@private
+  NSMutableSet *sp_added;
+  NSMutableSet *sp_updated;
+  NSMutableSet *sp_removed;
+  NSMutableSet *sp_toggled;
+  /* object set => objects */
+  NSMapTable *sp_addedObjects;
+  NSMapTable *sp_removedObjects;
+  NSMutableSet *sp_applications;
+}
+
+- (instancetype)init {
+  if (self = [super init]) {
+    sp_added = [[NSMutableSet alloc] init];
+    sp_updated = [[NSMutableSet alloc] init];
+    sp_removed = [[NSMutableSet alloc] init];
+    sp_toggled = [[NSMutableSet alloc] init];
+    sp_addedObjects = [NSMapTable strongToStrongObjectsMapTable];
+    sp_removedObjects = [NSMapTable strongToStrongObjectsMapTable];
+    sp_applications = [[NSMutableSet alloc] init];
+  }
+  return self;
+}
+
+- (NSString *)description {
+  return [NSString stringWithFormat:@"<%@ %p> {added: %lu, updated: %lu, removed: %lu, toggled: %lu}",
+          [self class], self, (unsigned long)[sp_added count], (unsigned long)[sp_updated count],
+          (unsigned long)[sp_removed count], (unsigned long)[sp_toggled count]];
+}
+
+#pragma mark Accessors
+- (NSSet *)addedEntries {
+  return [sp_added copy];
+}
+- (NSSet *)updatedEntries {
+  return [sp_updated copy];
+}
+- (NSSet *)removedEntries {
+  return [sp_removed copy];
+}
+- (NSSet *)toggledEntries {
+  return [sp_toggled copy];
+}
+
+- (NSSet *)addedObjectsInSet:(SparkObjectSet *)aSet {
+  return [[sp_addedObjects objectForKey:aSet] copy] ? : [NSSet set];
+}
+- (NSSet *)removedObjectsInSet:(SparkObjectSet *)aSet {
+  return [[sp_removedObjects objectForKey:aSet] copy] ? : [NSSet set];
+}
+
+- (NSSet *)toggledApplications {
+  return [sp_applications copy];
+}
+
+- (BOOL)isEmpty {
+  if ([sp_added count] || [sp_updated count] || [sp_removed count] || [sp_toggled count] || [sp_applications count])
+    return NO;
+  for (NSSet *objects in [sp_addedObjects objectEnumerator])
+    if ([objects count]) return NO;
+  for (NSSet *objects in [sp_removedObjects objectEnumerator])
+    if ([objects count]) return NO;
+  return YES;
+}
+
+#pragma mark Coalescing
+static
+NSMutableSet *_SparkChangesObjects(NSMapTable *table, SparkObjectSet *aSet) {
+  NSMutableSet *objects = [table objectForKey:aSet];
+  if (!objects) {
+    objects = [[NSMutableSet alloc] init];
+    [table setObject:objects forKey:aSet];
+  }
+  return objects;
+}
+
+/* an object removed and added back is reported in both sets */
+- (void)didAddObject:(SparkObject *)anObject toSet:(SparkObjectSet *)aSet {
+  [_SparkChangesObjects(sp_addedObjects, aSet) addObject:anObject];
+}
+
+- (void)didRemoveObject:(SparkObject *)anObject fromSet:(SparkObjectSet *)aSet {
+  NSMutableSet *added = [sp_addedObjects objectForKey:aSet];
+  if ([added containsObject:anObject]) {
+    [added removeObject:anObject];
+    /* unless it was removed before */
+    if (![[sp_removedObjects objectForKey:aSet] containsObject:anObject])
+      return;
+  }
+  [_SparkChangesObjects(sp_removedObjects, aSet) addObject:anObject];
+}
+
+/* entries are equal if they have the same uid, keep the last instance */
+static
+void _SparkChangesSetEntry(NSMutableSet *entries, SparkEntry *anEntry) {
+  [entries removeObject:anEntry];
+  [entries addObject:anEntry];
+}
+
+- (void)didAddEntry:(SparkEntry *)anEntry {
+  if ([sp_removed containsObject:anEntry]) {
+    /* removed and added back (undo, revert) */
+    [sp_removed removeObject:anEntry];
+    _SparkChangesSetEntry(sp_updated, anEntry);
+  } else {
+    _SparkChangesSetEntry(sp_added, anEntry);
+  }
+}
+
+- (void)didUpdateEntry:(SparkEntry *)anEntry {
+  if (![sp_added containsObject:anEntry])
+    _SparkChangesSetEntry(sp_updated, anEntry);
+}
+
+- (void)didRemoveEntry:(SparkEntry *)anEntry {
+  [sp_toggled removeObject:anEntry];
+  if ([sp_added containsObject:anEntry]) {
+    [sp_added removeObject:anEntry];
+  } else {
+    [sp_updated removeObject:anEntry];
+    _SparkChangesSetEntry(sp_removed, anEntry);
+  }
+}
+
+- (void)didChangeEntryStatus:(SparkEntry *)anEntry {
+  if ([sp_added containsObject:anEntry])
+    return;
+  /* status is a boolean: two changes cancel each other */
+  if ([sp_toggled containsObject:anEntry])
+    [sp_toggled removeObject:anEntry];
+  else
+    [sp_toggled addObject:anEntry];
+}
+
+- (void)didChangeApplicationStatus:(SparkApplication *)anApplication {
+  if ([sp_applications containsObject:anApplication])
+    [sp_applications removeObject:anApplication];
+  else
+    [sp_applications addObject:anApplication];
+}
+
+@end
+
+#pragma mark -
+enum {
+  kSparkLibraryDidAddObject,
+  kSparkLibraryWillRemoveObject,
+  kSparkLibraryDidRemoveObject,
+  kSparkLibraryDidAddEntry,
+  kSparkLibraryDidUpdateEntry,
+  kSparkLibraryWillRemoveEntry,
+  kSparkLibraryDidRemoveEntry,
+  kSparkLibraryDidChangeEntryStatus,
+  kSparkLibraryDidChangeApplicationStatus,
+  kSparkLibraryDidCommitChanges,
+  /* MUST be last */
+  kSparkLibraryEventCount,
+};
+
+static SEL sSparkLibraryEvents[kSparkLibraryEventCount];
+
+@implementation SparkLibraryObservers {
+@private
+  /* owner */
+  __unsafe_unretained SparkLibrary *sp_library;
+  /* observers implementing each event */
+  NSHashTable *sp_observers[kSparkLibraryEventCount];
+  /* weak snapshots of sp_observers, rebuilt only after registration changes */
+  NSPointerArray *sp_snapshots[kSparkLibraryEventCount];
+  /* changes of the current transaction */
+  SparkLibraryChanges *sp_changes;
+}
+
++ (void)initialize {
+  if ([SparkLibraryObservers class] == self) {
+    sSparkLibraryEvents[kSparkLibraryDidAddObject] = @selector(library:didAddObject:toSet:);
+    sSparkLibraryEvents[kSparkLibraryWillRemoveObject] = @selector(library:willRemoveObject:fromSet:);
+    sSparkLibraryEvents[kSparkLibraryDidRemoveObject] = @selector(library:didRemoveObject:fromSet:);
+    sSparkLibraryEvents[kSparkLibraryDidAddEntry] = @selector(library:didAddEntry:);
+    sSparkLibraryEvents[kSparkLibraryDidUpdateEntry] = @selector(library:didUpdateEntry:previous:);
+    sSparkLibraryEvents[kSparkLibraryWillRemoveEntry] = @selector(library:willRemoveEntry:);
+    sSparkLibraryEvents[kSparkLibraryDidRemoveEntry] = @selector(library:didRemoveEntry:);
+    sSparkLibraryEvents[kSparkLibraryDidChangeEntryStatus] = @selector(library:didChangeEntryStatus:);
+    sSparkLibraryEvents[kSparkLibraryDidChangeApplicationStatus] = @selector(library:didChangeApplicationStatus:);
+    sSparkLibraryEvents[kSparkLibraryDidCommitChanges] = @selector(library:didCommitChanges:);
+  }
+}
+
+- (instancetype)initWithLibrary:(SparkLibrary *)aLibrary {
+  NSParameterAssert(aLibrary);
+  if (self = [super init]) {
+    sp_library = aLibrary;
+  }
+  return self;
+}
+
+- (void)dealloc {
+  for (NSUInteger idx = 0; idx < kSparkLibraryEventCount; idx++) {
+    sp_observers[idx] = nil;
+    sp_snapshots[idx] = nil;
+  }
+}
+
+#pragma mark Registration
+- (void)addObserver:(id<SparkLibraryObserver>)observer {
+  NSParameterAssert(observer);
+  for (NSUInteger idx = 0; idx < kSparkLibraryEventCount; idx++) {
+    if ([observer respondsToSelector:sSparkLibraryEvents[idx]]) {
+      if (!sp_observers[idx])
+        sp_observers[idx] = [NSHashTable weakObjectsHashTable];
+      [sp_observers[idx] addObject:observer];
+      sp_snapshots[idx] = nil;
+    }
+  }
+  /* registered while in transaction */
+  if (!sp_changes && [sp_library isInTransaction] && [sp_observers[kSparkLibraryDidCommitChanges] count])
+    sp_changes = [[SparkLibraryChanges alloc] init];
+}
+
+- (void)removeObserver:(id<SparkLibraryObserver>)observer {
+  for (NSUInteger idx = 0; idx < kSparkLibraryEventCount; idx++) {
+    if ([sp_observers[idx] member:observer]) {
+      [sp_observers[idx] removeObject:observer];
+      sp_snapshots[idx] = nil;
+    }
+  }
+}
+
+/* Snapshot, so observers can unregister while notified.
+ Entries are weak: an observer released since the last registration change is simply skipped (nil). */
+- (NSPointerArray *)observersForEvent:(NSUInteger)event {
+  NSPointerArray *snapshot = sp_snapshots[event];
+  if (!snapshot) {
+    NSHashTable *observers = sp_observers[event];
+    if (![observers count])
+      return nil;
+    snapshot = [NSPointerArray weakObjectsPointerArray];
+    for (id observer in observers)
+      [snapshot addPointer:(__bridge void *)observer];
+    sp_snapshots[event] = snapshot;
+  }
+  return snapshot;
+}
+
+#pragma mark Object Sets
+- (void)didAddObject:(SparkObject *)anObject toSet:(SparkObjectSet *)aSet {
+  [sp_changes didAddObject:anObject toSet:aSet];
+  for (id<SparkLibraryObserver> observer in [self observersForEvent:kSparkLibraryDidAddObject])
+    [observer library:sp_library didAddObject:anObject toSet:aSet];
+}
+
+- (void)willRemoveObject:(SparkObject *)anObject fromSet:(SparkObjectSet *)aSet {
+  for (id<SparkLibraryObserver> observer in [self observersForEvent:kSparkLibraryWillRemoveObject])
+    [observer library:sp_library willRemoveObject:anObject fromSet:aSet];
+}
+
+- (void)didRemoveObject:(SparkObject *)anObject fromSet:(SparkObjectSet *)aSet {
+  [sp_changes didRemoveObject:anObject fromSet:aSet];
+  for (id<SparkLibraryObserver> observer in [self observersForEvent:kSparkLibraryDidRemoveObject])
+    [observer library:sp_library didRemoveObject:anObject fromSet:aSet];
+}
+
+#pragma mark Entries
+- (void)didAddEntry:(SparkEntry *)anEntry {
+  [sp_changes didAddEntry:anEntry];
+  for (id<SparkLibraryObserver> observer in [self observersForEvent:kSparkLibraryDidAddEntry])
+    [observer library:sp_library didAddEntry:anEntry];
+}
+
+- (void)didUpdateEntry:(SparkEntry *)anEntry previous:(SparkEntry *)previous {
+  [sp_changes didUpdateEntry:anEntry];
+  for (id<SparkLibraryObserver> observer in [self observersForEvent:kSparkLibraryDidUpdateEntry])
+    [observer library:sp_library didUpdateEntry:anEntry previous:previous];
+}
+
+- (void)willRemoveEntry:(SparkEntry *)anEntry {
+  for (id<SparkLibraryObserver> observer in [self observersForEvent:kSparkLibraryWillRemoveEntry])
+    [observer library:sp_library willRemoveEntry:anEntry];
+}
+
+- (void)didRemoveEntry:(SparkEntry *)anEntry {
+  [sp_changes didRemoveEntry:anEntry];
+  for (id<SparkLibraryObserver> observer in [self observersForEvent:kSparkLibraryDidRemoveEntry])
+    [observer library:sp_library didRemoveEntry:anEntry];
+}
+
+- (void)didChangeEntryStatus:(SparkEntry *)anEntry {
+  [sp_changes didChangeEntryStatus:anEntry];
+  for (id<SparkLibraryObserver> observer in [self observersForEvent:kSparkLibraryDidChangeEntryStatus])
+    [observer library:sp_library didChangeEntryStatus:anEntry];
+}
+
+#pragma mark Applications
+- (void)didChangeApplicationStatus:(SparkApplication *)anApplication {
+  [sp_changes didChangeApplicationStatus:anApplication];
+  for (id<SparkLibraryObserver> observer in [self observersForEvent:kSparkLibraryDidChangeApplicationStatus])
+    [observer library:sp_library didChangeApplicationStatus:anApplication];
+}
+
+#pragma mark Transactions
+- (void)beginTransaction {
+  /* changes are only recorded if someone is interested */
+  if ([sp_observers[kSparkLibraryDidCommitChanges] count])
+    sp_changes = [[SparkLibraryChanges alloc] init];
+}
+
+- (void)commitTransaction {
+  SparkLibraryChanges *changes = sp_changes;
+  sp_changes = nil;
+  if (changes && [sp_library notifiedObservers]) {
+    for (id<SparkLibraryObserver> observer in [self observersForEvent:kSparkLibraryDidCommitChanges])
+      [observer library:sp_library didCommitChanges:changes];
+  }
+}
+
+@end
+
+#pragma mark -
+@implementation SparkLibrary (SparkLibraryObserver)
+
+- (void)addLibraryObserver:(id<SparkLibraryObserver>)observer {
+  [[self observers] addObserver:observer];
+}
+
+- (void)removeLibraryObserver:(id<SparkLibraryObserver>)observer {
+  [[self observers] removeObserver:observer];
+}
+
+@end
@@ -17,6 +17,26 @@ enum {
   kSparkSetCount = 4,
 };
 
+/* Object type tags (used by synchronization and snapshots) */
+typedef NS_ENUM(OSType, SparkObjectType) {
+  kSparkActionType      = 'acti',
+  kSparkTriggerType     = 'trig',
+  kSparkApplicationType = 'appl'
+};
+
+SPARK_INLINE
+SparkObjectSet *SparkObjectSetForType(SparkLibrary *library, SparkObjectType type) {
+  switch (type) {
+    case kSparkActionType:
+      return [library actionSet];
+    case kSparkTriggerType:
+      return [library triggerSet];
+    case kSparkApplicationType:
+      return [library applicationSet];
+  }
+  return nil;
+}
+
 @class SparkEntry;
 
 @interface SparkLibrary (SparkLibraryInternal)
@@ -30,6 +50,41 @@ enum {
 
 @end
 
+/* Dispatch the library changes to the library observers (see SparkLibraryObserver.h) */
+@protocol SparkLibraryObserver;
+@class SparkObject, SparkApplication;
+@interface SparkLibraryObservers : NSObject
+
+- (instancetype)initWithLibrary:(SparkLibrary *)aLibrary;
+
+/* observers are not retained */
+- (void)addObserver:(id<SparkLibraryObserver>)observer;
+- (void)removeObserver:(id<SparkLibraryObserver>)observer;
+
+- (void)didAddObject:(SparkObject *)anObject toSet:(SparkObjectSet *)aSet;
+- (void)willRemoveObject:(SparkObject *)anObject fromSet:(SparkObjectSet *)aSet;
+- (void)didRemoveObject:(SparkObject *)anObject fromSet:(SparkObjectSet *)aSet;
+
+- (void)didAddEntry:(SparkEntry *)anEntry;
+- (void)didUpdateEntry:(SparkEntry *)anEntry previous:(SparkEntry *)previous;
+- (void)willRemoveEntry:(SparkEntry *)anEntry;
+- (void)didRemoveEntry:(SparkEntry *)anEntry;
+- (void)didChangeEntryStatus:(SparkEntry *)anEntry;
+
+- (void)didChangeApplicationStatus:(SparkApplication *)anApplication;
+
+/* outermost transaction only */
+- (void)beginTransaction;
+- (void)commitTransaction;
+
+@end
+
+@interface SparkLibrary (SparkLibraryObservers)
+- (SparkLibraryObservers *)observers;
+/* nil while notifications are disabled, or if nobody ever observed the library */
+- (SparkLibraryObservers *)notifiedObservers;
+@end
+
 /* I/O */
 @interface SparkLibraryArchiver : NSKeyedArchiver
 
@@ -0,0 +1,93 @@
+/*
+ *  SparkLibrarySnapshot.h
+ *  SparkKit
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+#import <SparkKit/SparkLibrary.h>
+
+/*
+ A library snapshot is an immutable, position independent image of the library
+ (objects, entries and application mapping) written by the editor into a
+ POSIX shared memory segment and mapped read-only by the daemon.
+ Each published snapshot lives in its own segment and is never modified after publication.
+ */
+
+enum {
+  kSparkSnapshotEntryEnabled = 1 << 0,
+  kSparkSnapshotEntryPlugged = 1 << 1,
+};
+
+enum {
+  kSparkSnapshotApplicationEnabled = 1 << 0,
+};
+
+/* All offsets are relative to the start of the segment */
+typedef struct {
+  SparkUID uid;
+  OSType type;
+  uint32_t offset; /* binary property list */
+  uint32_t length;
+} SparkSnapshotObject;
+
+/* sorted by trigger, then application */
+typedef struct {
+  SparkUID uid;
+  SparkUID action;
+  SparkUID trigger;
+  SparkUID application;
+  SparkUID parent;
+  uint32_t flags;
+} SparkSnapshotEntry;
+
+/* sorted by bundle identifier */
+typedef struct {
+  SparkUID uid;
+  uint32_t flags;
+  uint32_t identifier; /* UTF-8, not null terminated */
+  uint32_t length;
+} SparkSnapshotApplication;
+
+SPARK_OBJC_EXPORT
+@interface SparkLibrarySnapshot : NSObject
+
+/* map an existing segment read-only. returns nil if the segment does not exist or is invalid */
+- (instancetype)initWithName:(NSString *)name;
+
+@property(nonatomic, readonly) NSString *name;
+@property(nonatomic, readonly) NSUUID *uuid;
+@property(nonatomic, readonly) uint64_t generation;
+
+@property(nonatomic, readonly) NSUInteger countOfObjects;
+@property(nonatomic, readonly) const SparkSnapshotObject *objects;
+
+@property(nonatomic, readonly) NSUInteger countOfEntries;
+@property(nonatomic, readonly) const SparkSnapshotEntry *entries;
+
+@property(nonatomic, readonly) NSUInteger countOfApplications;
+@property(nonatomic, readonly) const SparkSnapshotApplication *applications;
+
+- (NSDictionary *)propertyListForObject:(const SparkSnapshotObject *)object;
+
+/* binary search */
+- (const SparkSnapshotEntry *)entryWithUID:(SparkUID)uid;
+- (const SparkSnapshotEntry *)entryForTrigger:(SparkUID)trigger application:(SparkUID)application;
+- (const SparkSnapshotApplication *)applicationWithBundleIdentifier:(NSString *)identifier;
+
+@end
+
+/* Write a new snapshot of library. Returns the segment name, or nil on failure. */
+SPARK_EXPORT
+NSString *SparkLibraryPublishSnapshot(SparkLibrary *library, uint64_t generation);
+/* The reader unlinks the segment once mapped. The publisher unlinks segments that were never read. */
+SPARK_EXPORT
+void SparkLibraryUnlinkSnapshot(NSString *name);
+
+@interface SparkLibrary (SparkLibrarySnapshot)
+
+/* Reconcile the library content with snapshot (daemon side) */
+- (void)applySnapshot:(SparkLibrarySnapshot *)snapshot;
+
+@end
@@ -0,0 +1,522 @@
+/*
+ *  SparkLibrarySnapshot.m
+ *  SparkKit
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+#import <SparkKit/SparkLibrarySnapshot.h>
+
+#import <SparkKit/SparkEntry.h>
+#import <SparkKit/SparkAction.h>
+#import <SparkKit/SparkTrigger.h>
+#import <SparkKit/SparkApplication.h>
+#import <SparkKit/SparkObjectSet.h>
+#import <SparkKit/SparkEntryManager.h>
+
+#import "SparkEntryPrivate.h"
+#import "SparkLibraryPrivate.h"
+#import "SparkEntryManagerPrivate.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define kSparkSnapshotMagic     'SpSn'
+#define kSparkSnapshotVersion   1
+
+typedef struct {
+  OSType magic;
+  uint32_t version;
+  uint64_t generation;
+  uuid_t uuid;
+  uint32_t size;
+  /* sorted by type, then uid */
+  uint32_t objects;
+  uint32_t objectCount;
+  /* sorted by trigger, then application */
+  uint32_t entries;
+  uint32_t entryCount;
+  /* entry indices sorted by uid */
+  uint32_t index;
+  /* sorted by bundle identifier */
+  uint32_t applications;
+  uint32_t applicationCount;
+} SparkSnapshotHeader;
+
+WB_INLINE
+bool __SparkSnapshotCheckRange(const SparkSnapshotHeader *header, uint64_t offset, uint64_t length) {
+  return offset <= header->size && length <= header->size - offset;
+}
+
+WB_INLINE
+bool __SparkSnapshotCheckSection(const SparkSnapshotHeader *header, uint32_t offset, uint32_t count, size_t size) {
+  return (offset % 4) == 0 && __SparkSnapshotCheckRange(header, offset, (uint64_t)count * size);
+}
+
+static
+bool SparkSnapshotValidate(const void *base, size_t length) {
+  if (length < sizeof(SparkSnapshotHeader))
+    return false;
+
+  const SparkSnapshotHeader *header = base;
+  if (header->magic != kSparkSnapshotMagic || header->version != kSparkSnapshotVersion)
+    return false;
+  if (header->size < sizeof(SparkSnapshotHeader) || header->size > length)
+    return false;
+
+  if (!__SparkSnapshotCheckSection(header, header->objects, header->objectCount, sizeof(SparkSnapshotObject)) ||
+      !__SparkSnapshotCheckSection(header, header->entries, header->entryCount, sizeof(SparkSnapshotEntry)) ||
+      !__SparkSnapshotCheckSection(header, header->index, header->entryCount, sizeof(uint32_t)) ||
+      !__SparkSnapshotCheckSection(header, header->applications, header->applicationCount, sizeof(SparkSnapshotApplication)))
+    return false;
+
+  /* check references into the data pool */
+  const SparkSnapshotObject *objects = base + header->objects;
+  for (uint32_t idx = 0; idx < header->objectCount; idx++) {
+    if (!__SparkSnapshotCheckRange(header, objects[idx].offset, objects[idx].length))
+      return false;
+  }
+  const SparkSnapshotApplication *applications = base + header->applications;
+  for (uint32_t idx = 0; idx < header->applicationCount; idx++) {
+    if (!__SparkSnapshotCheckRange(header, applications[idx].identifier, applications[idx].length))
+      return false;
+  }
+  const uint32_t *index = base + header->index;
+  for (uint32_t idx = 0; idx < header->entryCount; idx++) {
+    if (index[idx] >= header->entryCount)
+      return false;
+  }
+  return true;
+}
+
+WB_INLINE
+int __SparkSnapshotCompareUID(SparkUID a, SparkUID b) {
+  return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+WB_INLINE
+int __SparkSnapshotCompareObjects(const SparkSnapshotObject *a, const SparkSnapshotObject *b) {
+  int result = __SparkSnapshotCompareUID(a->type, b->type);
+  return result ? : __SparkSnapshotCompareUID(a->uid, b->uid);
+}
+
+WB_INLINE
+int __SparkSnapshotCompareEntries(const SparkSnapshotEntry *a, const SparkSnapshotEntry *b) {
+  int result = __SparkSnapshotCompareUID(a->trigger, b->trigger);
+  return result ? : __SparkSnapshotCompareUID(a->application, b->application);
+}
+
+WB_INLINE
+int __SparkSnapshotCompareStrings(const void *s1, size_t l1, const void *s2, size_t l2) {
+  int result = memcmp(s1, s2, MIN(l1, l2));
+  return result ? : __SparkSnapshotCompareUID((SparkUID)l1, (SparkUID)l2);
+}
+
+#pragma mark -
+@implementation SparkLibrarySnapshot {
+@private
+  void *_base;
+  size_t _length;
+}
+
+- (id)init {
+  Class cls = [self class];
+	SPXThrowException(NSInvalidArgumentException, @"%@ does not recognized selector %@", NSStringFromClass(cls), NSStringFromSelector(_cmd));
+}
+
+- (instancetype)initWithName:(NSString *)name {
+  NSParameterAssert(name);
+  if (self = [super init]) {
+    int fd = shm_open([name UTF8String], O_RDONLY);
+    if (fd < 0) {
+      SPXDebug(@"shm_open(%@): %s", name, strerror(errno));
+      return nil;
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0 || info.st_size < (off_t)sizeof(SparkSnapshotHeader)) {
+      close(fd);
+      return nil;
+    }
+    _length = (size_t)info.st_size;
+    _base = mmap(NULL, _length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == _base) {
+      SPXDebug(@"mmap(%@): %s", name, strerror(errno));
+      _base = NULL;
+      return nil;
+    }
+    if (!SparkSnapshotValidate(_base, _length)) {
+      SPXLogWarning(@"Invalid library snapshot: %@", name);
+      return nil;
+    }
+    _name = [name copy];
+    _uuid = [[NSUUID alloc] initWithUUIDBytes:self.header->uuid];
+  }
+  return self;
+}
+
+- (void)dealloc {
+  if (_base)
+    munmap(_base, _length);
+}
+
+- (const SparkSnapshotHeader *)header {
+  return _base;
+}
+
+- (uint64_t)generation {
+  return self.header->generation;
+}
+
+- (NSUInteger)countOfObjects {
+  return self.header->objectCount;
+}
+- (const SparkSnapshotObject *)objects {
+  return _base + self.header->objects;
+}
+
+- (NSUInteger)countOfEntries {
+  return self.header->entryCount;
+}
+- (const SparkSnapshotEntry *)entries {
+  return _base + self.header->entries;
+}
+
+- (NSUInteger)countOfApplications {
+  return self.header->applicationCount;
+}
+- (const SparkSnapshotApplication *)applications {
+  return _base + self.header->applications;
+}
+
+- (NSDictionary *)propertyListForObject:(const SparkSnapshotObject *)object {
+  /* the data is only referenced, and must not outlive the snapshot */
+  NSData *data = [NSData dataWithBytesNoCopy:_base + object->offset length:object->length freeWhenDone:NO];
+  id plist = [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListImmutable format:NULL error:NULL];
+  return [plist isKindOfClass:[NSDictionary class]] ? plist : nil;
+}
+
+- (const SparkSnapshotObject *)objectWithUID:(SparkUID)uid type:(OSType)type {
+  const SparkSnapshotObject key = { .uid = uid, .type = type };
+  return bsearch_b(&key, self.objects, self.countOfObjects, sizeof(SparkSnapshotObject), ^int(const void *a, const void *b) {
+    return __SparkSnapshotCompareObjects(a, b);
+  });
+}
+
+- (const SparkSnapshotEntry *)entryWithUID:(SparkUID)uid {
+  const SparkSnapshotEntry *entries = self.entries;
+  const uint32_t *idx = bsearch_b(&uid, _base + self.header->index, self.countOfEntries, sizeof(uint32_t), ^int(const void *key, const void *value) {
+    return __SparkSnapshotCompareUID(*(const SparkUID *)key, entries[*(const uint32_t *)value].uid);
+  });
+  return idx ? &entries[*idx] : NULL;
+}
+
+- (const SparkSnapshotEntry *)entryForTrigger:(SparkUID)trigger application:(SparkUID)application {
+  const SparkSnapshotEntry key = { .trigger = trigger, .application = application };
+  return bsearch_b(&key, self.entries, self.countOfEntries, sizeof(SparkSnapshotEntry), ^int(const void *a, const void *b) {
+    return __SparkSnapshotCompareEntries(a, b);
+  });
+}
+
+- (const SparkSnapshotApplication *)applicationWithBundleIdentifier:(NSString *)identifier {
+  const char *str = [identifier UTF8String];
+  if (!str)
+    return NULL;
+  size_t length = strlen(str);
+  const void *base = _base;
+  return bsearch_b(str, self.applications, self.countOfApplications, sizeof(SparkSnapshotApplication), ^int(const void *key, const void *value) {
+    const SparkSnapshotApplication *app = value;
+    return __SparkSnapshotCompareStrings(key, length, base + app->identifier, app->length);
+  });
+}
+
+@end
+
+#pragma mark -
+#pragma mark Publication
+WB_INLINE
+NSString *SparkLibrarySnapshotName(uint64_t generation) {
+  /* shm names are limited to 31 characters */
+  return [NSString stringWithFormat:@"/spk.%x.%llx", getpid(), generation];
+}
+
+static
+uint32_t SparkSnapshotPoolAppend(NSMutableData *pool, const void *bytes, NSUInteger length) {
+  uint32_t offset = (uint32_t)[pool length];
+  [pool appendBytes:bytes length:length];
+  return offset;
+}
+
+NSString *SparkLibraryPublishSnapshot(SparkLibrary *library, uint64_t generation) {
+  NSCParameterAssert(library);
+  NSMutableData *pool = [NSMutableData data];
+
+  /* Objects */
+  NSMutableData *objects = [NSMutableData data];
+  const SparkObjectType types[] = { kSparkActionType, kSparkTriggerType, kSparkApplicationType };
+  for (NSUInteger idx = 0; idx < sizeof(types) / sizeof(*types); idx++) {
+    SparkObjectSet *set = SparkObjectSetForType(library, types[idx]);
+    [set enumerateObjectsUsingBlock:^(SparkObject *object, BOOL *stop) {
+      NSDictionary *plist = [set serialize:object error:NULL];
+      NSData *data = plist ? [NSPropertyListSerialization dataWithPropertyList:plist format:NSPropertyListBinaryFormat_v1_0 options:0 error:NULL] : nil;
+      if (!data) {
+        SPXDebug(@"Failed to serialize object: %@", object);
+        return;
+      }
+      SparkSnapshotObject record = {
+        .uid = object.uid, .type = types[idx],
+        .offset = SparkSnapshotPoolAppend(pool, [data bytes], [data length]),
+        .length = (uint32_t)[data length],
+      };
+      [objects appendBytes:&record length:sizeof(record)];
+    }];
+  }
+  uint32_t objectCount = (uint32_t)([objects length] / sizeof(SparkSnapshotObject));
+  qsort_b([objects mutableBytes], objectCount, sizeof(SparkSnapshotObject), ^int(const void *a, const void *b) {
+    return __SparkSnapshotCompareObjects(a, b);
+  });
+
+  /* Entries */
+  NSMutableData *entries = [NSMutableData data];
+  [library.entryManager enumerateEntriesUsingBlock:^(SparkEntry *entry, BOOL *stop) {
+    SparkSnapshotEntry record = {
+      .uid = entry.uid,
+      .action = entry.actionUID,
+      .trigger = entry.triggerUID,
+      .application = entry.applicationUID,
+      .parent = entry.parent.uid,
+      .flags = (entry.enabled ? kSparkSnapshotEntryEnabled : 0) | (entry.plugged ? kSparkSnapshotEntryPlugged : 0),
+    };
+    [entries appendBytes:&record length:sizeof(record)];
+  }];
+  uint32_t entryCount = (uint32_t)([entries length] / sizeof(SparkSnapshotEntry));
+  SparkSnapshotEntry *records = [entries mutableBytes];
+  qsort_b(records, entryCount, sizeof(SparkSnapshotEntry), ^int(const void *a, const void *b) {
+    return __SparkSnapshotCompareEntries(a, b);
+  });
+  NSMutableData *index = [NSMutableData dataWithLength:entryCount * sizeof(uint32_t)];
+  uint32_t *indices = [index mutableBytes];
+  for (uint32_t idx = 0; idx < entryCount; idx++)
+    indices[idx] = idx;
+  qsort_b(indices, entryCount, sizeof(uint32_t), ^int(const void *a, const void *b) {
+    return __SparkSnapshotCompareUID(records[*(const uint32_t *)a].uid, records[*(const uint32_t *)b].uid);
+  });
+
+  /* Applications */
+  NSMutableData *applications = [NSMutableData data];
+  [library.applicationSet enumerateObjectsUsingBlock:^(SparkApplication *app, BOOL *stop) {
+    const char *identifier = [app.bundleIdentifier UTF8String];
+    if (!identifier)
+      return;
+    SparkSnapshotApplication record = {
+      .uid = app.uid,
+      .flags = app.enabled ? kSparkSnapshotApplicationEnabled : 0,
+      .identifier = SparkSnapshotPoolAppend(pool, identifier, strlen(identifier)),
+      .length = (uint32_t)strlen(identifier),
+    };
+    [applications appendBytes:&record length:sizeof(record)];
+  }];
+  uint32_t applicationCount = (uint32_t)([applications length] / sizeof(SparkSnapshotApplication));
+  const void *strings = [pool bytes];
+  qsort_b([applications mutableBytes], applicationCount, sizeof(SparkSnapshotApplication), ^int(const void *a, const void *b) {
+    const SparkSnapshotApplication *app1 = a, *app2 = b;
+    return __SparkSnapshotCompareStrings(strings + app1->identifier, app1->length, strings + app2->identifier, app2->length);
+  });
+
+  /* Layout: header | objects | entries | index | applications | pool */
+  SparkSnapshotHeader header = {
+    .magic = kSparkSnapshotMagic,
+    .version = kSparkSnapshotVersion,
+    .generation = generation,
+    .objectCount = objectCount,
+    .entryCount = entryCount,
+    .applicationCount = applicationCount,
+  };
+  [library.uuid getUUIDBytes:header.uuid];
+  header.objects = sizeof(header);
+  header.entries = header.objects + (uint32_t)[objects length];
+  header.index = header.entries + (uint32_t)[entries length];
+  header.applications = header.index + (uint32_t)[index length];
+  uint64_t base = header.applications + (uint64_t)[applications length];
+  if (base + [pool length] > UINT32_MAX) {
+    SPXLogWarning(@"Library too large for snapshot");
+    return nil;
+  }
+  header.size = (uint32_t)(base + [pool length]);
+
+  /* Relocate pool references */
+  SparkSnapshotObject *object = [objects mutableBytes];
+  for (uint32_t idx = 0; idx < objectCount; idx++)
+    object[idx].offset += base;
+  SparkSnapshotApplication *app = [applications mutableBytes];
+  for (uint32_t idx = 0; idx < applicationCount; idx++)
+    app[idx].identifier += base;
+
+  /* Write segment */
+  NSString *name = SparkLibrarySnapshotName(generation);
+  int fd = shm_open([name UTF8String], O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+  if (fd < 0 && EEXIST == errno) {
+    /* stale segment from a previous session */
+    shm_unlink([name UTF8String]);
+    fd = shm_open([name UTF8String], O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+  }
+  if (fd < 0) {
+    SPXLogWarning(@"shm_open(%@): %s", name, strerror(errno));
+    return nil;
+  }
+  void *segment = MAP_FAILED;
+  if (0 == ftruncate(fd, header.size))
+    segment = mmap(NULL, header.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (MAP_FAILED == segment) {
+    SPXLogWarning(@"Failed to map snapshot %@: %s", name, strerror(errno));
+    shm_unlink([name UTF8String]);
+    return nil;
+  }
+  memcpy(segment, &header, sizeof(header));
+  memcpy(segment + header.objects, [objects bytes], [objects length]);
+  memcpy(segment + header.entries, [entries bytes], [entries length]);
+  memcpy(segment + header.index, [index bytes], [index length]);
+  memcpy(segment + header.applications, [applications bytes], [applications length]);
+  memcpy(segment + base, [pool bytes], [pool length]);
+  munmap(segment, header.size);
+
+  return name;
+}
+
+void SparkLibraryUnlinkSnapshot(NSString *name) {
+  if (name && shm_unlink([name UTF8String]) < 0)
+    SPXDebug(@"shm_unlink(%@): %s", name, strerror(errno));
+}
+
+#pragma mark -
+#pragma mark Reconciliation
+@implementation SparkLibrary (SparkLibrarySnapshot)
+
+- (void)applySnapshot:(SparkLibrarySnapshot *)snapshot {
+  NSParameterAssert([snapshot.uuid isEqual:self.uuid]);
+  SparkEntryManager *manager = self.entryManager;
+
+  [self beginTransaction];
+
+  /* Objects edited in place (same uid, new content) are replaced, and the entries using them rebuilt */
+  NSHashTable *edited = [NSHashTable hashTableWithOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality];
+  const SparkSnapshotObject *objects = snapshot.objects;
+  for (NSUInteger idx = 0; idx < snapshot.countOfObjects; idx++) {
+    SparkObjectSet *set = SparkObjectSetForType(self, objects[idx].type);
+    SparkObject *object = [set objectWithUID:objects[idx].uid];
+    if (!object || object.uid <= kSparkLibraryReserved)
+      continue;
+    NSDictionary *plist = [snapshot propertyListForObject:&objects[idx]];
+    if (plist && ![plist isEqual:[set serialize:object error:NULL]])
+      [edited addObject:object];
+  }
+
+  /* Remove entries that no longer exist (variants first) */
+  NSMutableArray *removed = [[NSMutableArray alloc] init];
+  [manager enumerateEntriesUsingBlock:^(SparkEntry *entry, BOOL *stop) {
+    const SparkSnapshotEntry *record = [snapshot entryWithUID:entry.uid];
+    if (!record || record->parent != entry.parent.uid ||
+        [edited containsObject:entry.action] || [edited containsObject:entry.trigger] || [edited containsObject:entry.application])
+      [removed addObject:entry];
+  }];
+  [removed sortUsingComparator:^NSComparisonResult(SparkEntry *e1, SparkEntry *e2) {
+    return (NSComparisonResult)((e1.isRoot ? 1 : 0) - (e2.isRoot ? 1 : 0));
+  }];
+  for (SparkEntry *entry in removed)
+    [manager removeEntry:entry];
+
+  for (SparkObject *object in edited) {
+    if ([object isKindOfClass:[SparkAction class]])
+      [self.actionSet removeObject:object];
+    else if ([object isKindOfClass:[SparkTrigger class]])
+      [self.triggerSet removeObject:object];
+    else
+      [self.applicationSet removeObject:object];
+  }
+
+  /* Remove objects that no longer exist */
+  const SparkObjectType types[] = { kSparkActionType, kSparkTriggerType, kSparkApplicationType };
+  for (NSUInteger idx = 0; idx < sizeof(types) / sizeof(*types); idx++) {
+    SparkObjectSet *set = SparkObjectSetForType(self, types[idx]);
+    NSMutableArray *orphans = [[NSMutableArray alloc] init];
+    [set enumerateObjectsUsingBlock:^(SparkObject *object, BOOL *stop) {
+      if (![snapshot objectWithUID:object.uid type:types[idx]])
+        [orphans addObject:object];
+    }];
+    if ([orphans count])
+      [set removeObjectsInArray:orphans];
+  }
+
+  /* Add missing and edited objects */
+  for (NSUInteger idx = 0; idx < snapshot.countOfObjects; idx++) {
+    SparkObjectSet *set = SparkObjectSetForType(self, objects[idx].type);
+    if (set && ![set containsObjectWithUID:objects[idx].uid]) {
+      NSDictionary *plist = [snapshot propertyListForObject:&objects[idx]];
+      SparkObject *object = plist ? [set deserialize:plist error:NULL] : nil;
+      if (object)
+        [set addObject:object];
+    }
+  }
+
+  /* Add and update entries. Roots are processed before variants */
+  const SparkSnapshotEntry *records = snapshot.entries;
+  for (NSUInteger pass = 0; pass < 2; pass++) {
+    for (NSUInteger idx = 0; idx < snapshot.countOfEntries; idx++) {
+      const SparkSnapshotEntry *record = &records[idx];
+      if ((record->parent == 0) != (pass == 0))
+        continue;
+
+      SparkAction *action = [self actionWithUID:record->action];
+      SparkTrigger *trigger = [self triggerWithUID:record->trigger];
+      SparkApplication *application = [self applicationWithUID:record->application];
+      if (!action || !trigger || !application) {
+        SPXDebug(@"Snapshot entry %u references missing objects", record->uid);
+        continue;
+      }
+      SparkEntry *entry = [manager entryWithUID:record->uid];
+      if (!entry) {
+        SparkEntry *parent = record->parent ? [manager entryWithUID:record->parent] : nil;
+        if (record->parent && !parent)
+          continue;
+        entry = [SparkEntry entryWithAction:action trigger:trigger application:application];
+        entry.uid = record->uid;
+        [manager addEntry:entry parent:parent];
+      } else if (entry.actionUID != record->action || entry.triggerUID != record->trigger || entry.applicationUID != record->application) {
+        [entry beginEditing];
+        [entry replaceAction:action];
+        [entry replaceTrigger:trigger];
+        [entry replaceApplication:application];
+        [entry endEditing];
+      }
+    }
+  }
+
+  /* Entries status: disable before enable to avoid transient conflicts */
+  for (NSUInteger pass = 0; pass < 2; pass++) {
+    for (NSUInteger idx = 0; idx < snapshot.countOfEntries; idx++) {
+      BOOL enabled = (records[idx].flags & kSparkSnapshotEntryEnabled) != 0;
+      if (enabled != (pass == 1))
+        continue;
+      SparkEntry *entry = [manager entryWithUID:records[idx].uid];
+      if (entry && entry.enabled != enabled)
+        entry.enabled = enabled;
+    }
+  }
+
+  /* Applications status */
+  const SparkSnapshotApplication *applications = snapshot.applications;
+  for (NSUInteger idx = 0; idx < snapshot.countOfApplications; idx++) {
+    SparkApplication *app = [self applicationWithUID:applications[idx].uid];
+    BOOL enabled = (applications[idx].flags & kSparkSnapshotApplicationEnabled) != 0;
+    if (app && app.enabled != enabled)
+      app.enabled = enabled;
+  }
+
+  [self commitTransaction];
+}
+
+@end
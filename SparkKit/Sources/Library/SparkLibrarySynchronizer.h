@@ -12,6 +12,7 @@ SPARK_EXPORT
 bool SparkLogSynchronization;
 
 @protocol SparkLibrary;
+@class SparkLibrarySnapshot;
 
 SPARK_OBJC_EXPORT
 @interface SparkLibrarySynchronizer : NSObject
@@ -29,6 +30,9 @@ SPARK_OBJC_EXPORT
 @property(nonatomic, readonly) SparkLibrary *library;
 @property(nonatomic, readonly) id<SparkLibrary> distantLibrary;
 
+/* last snapshot applied to the library (mapped read-only) */
+@property(readonly) SparkLibrarySnapshot *snapshot;
+
 @end
 
 @interface SparkLibrary (SparkDistantLibrary)
@@ -36,3 +40,33 @@ SPARK_OBJC_EXPORT
 @property(nonatomic, readonly) SparkDistantLibrary *distantLibrary;
 
 @end
+
+// MARK: Benchmark
+#if defined(DEBUG)
+SPARK_EXPORT
+NSString * const kSparkSyncReplayMessagesKey; // number of messages
+SPARK_EXPORT
+NSString * const kSparkSyncReplayDurationKey; // seconds spent in messages
+SPARK_EXPORT
+NSString * const kSparkSyncReplayConvergenceKey; // seconds until the library is idle
+SPARK_EXPORT
+NSString * const kSparkSyncReplayMessagesPerSecondKey;
+SPARK_EXPORT
+NSString * const kSparkSyncReplayEqualKey; // final state matches the recorded library
+
+/* Record the messages a synchronizer sends while operations run on library (property list array) */
+SPARK_EXPORT
+NSArray *SparkLibrarySyncRecord(SparkLibrary *library, void (^operations)(SparkLibrary *library));
+/* Replay recorded messages against library through a SparkDistantLibrary */
+SPARK_EXPORT
+NSDictionary *SparkLibrarySyncReplay(NSArray *messages, SparkLibrary *library);
+
+SPARK_EXPORT
+BOOL SparkLibraryContentIsEqual(SparkLibrary *library, SparkLibrary *other);
+
+/* Run scripted editor operations (bulk import, application removal, list toggle) in a transaction on a copy of library,
+ save the messages into replayURL (optional), replay them against a second copy and compare both copies. */
+SPARK_EXPORT
+NSDictionary *SparkLibrarySyncBenchmark(SparkLibrary *library, NSURL *replayURL);
+
+#endif /* DEBUG */
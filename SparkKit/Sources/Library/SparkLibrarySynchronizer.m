@@ -7,9 +7,12 @@
  */
 
 #import <SparkKit/SparkLibrarySynchronizer.h>
+#import <SparkKit/SparkLibrarySnapshot.h>
 
+#import <SparkKit/SparkPrivate.h>
 #import <SparkKit/SparkPreferences.h>
 
+#import <SparkKit/SparkList.h>
 #import <SparkKit/SparkEntry.h>
 #import <SparkKit/SparkAction.h>
 #import <SparkKit/SparkTrigger.h>
@@ -19,16 +22,13 @@
 #import <SparkKit/SparkPlugIn.h>
 #import <SparkKit/SparkObjectSet.h>
 #import <SparkKit/SparkActionLoader.h>
+#import <SparkKit/SparkLibraryObserver.h>
 
 #import "SparkEntryPrivate.h"
 #import "SparkLibraryPrivate.h"
 #import "SparkEntryManagerPrivate.h"
 
-typedef NS_ENUM(OSType, SparkObjectType) {
-  kSparkActionType      = 'acti',
-  kSparkTriggerType     = 'trig',
-  kSparkApplicationType = 'appl'
-};
+#include <mach/mach_time.h>
 
 bool SparkLogSynchronization = false;
 
@@ -54,13 +54,26 @@ bool SparkLogSynchronization = false;
 #pragma mark PlugIns Management
 - (oneway void)registerPlugIn:(bycopy NSURL *)bundlePath;
 
+#pragma mark Snapshots
+- (oneway void)loadSnapshot:(bycopy NSString *)name;
+
 @end
 
 #pragma mark -
+@interface SparkLibrarySynchronizer () <SparkLibraryObserver>
+- (void)setRecorder:(id<SparkLibrary>)recorder;
+@end
+
 @implementation SparkLibrarySynchronizer {
 @private
   SparkLibrary *_library;
   NSDistantObject<SparkLibrary> *_remote;
+  /* benchmark: messages are sent to the recorder instead of the daemon */
+  id<SparkLibrary> _recorder;
+
+  /* Transactions are sent as a snapshot */
+  uint64_t _generation;
+  NSString *_snapshot;
 }
 
 - (id)init {
@@ -72,50 +85,21 @@ bool SparkLogSynchronization = false;
   NSParameterAssert(aLibrary != nil);
   if (self = [super init]) {
     _library = aLibrary;
+    /* generations must keep increasing across editor sessions (the daemon outlives the editor) */
+    _generation = mach_absolute_time();
   }
   return self;
 }
 
 - (void)dealloc {
+  [self setRecorder:nil];
   [self setDistantLibrary:nil];
 }
 
 #pragma mark -
 - (void)registerObserver {
-  NSNotificationCenter *center = _library.notificationCenter;
-  
-  [center addObserver:self
-             selector:@selector(didAddObject:)
-                 name:SparkObjectSetDidAddObjectNotification 
-               object:nil];
-  [center addObserver:self
-             selector:@selector(willRemoveObject:)
-                 name:SparkObjectSetWillRemoveObjectNotification 
-               object:nil];
-  
-  /* Entry Manager */
-  [center addObserver:self
-             selector:@selector(didAddEntry:)
-                 name:SparkEntryManagerDidAddEntryNotification 
-               object:nil];
-  [center addObserver:self
-             selector:@selector(didUpdateEntry:)
-                 name:SparkEntryManagerDidUpdateEntryNotification 
-               object:nil];
-  [center addObserver:self
-             selector:@selector(didRemoveEntry:)
-                 name:SparkEntryManagerDidRemoveEntryNotification 
-               object:nil];
-  [center addObserver:self
-             selector:@selector(didChangeEntryStatus:)
-                 name:SparkEntryManagerDidChangeEntryStatusNotification 
-               object:nil];
-
-  /* Applications */
-  [center addObserver:self
-             selector:@selector(didChangeApplicationStatus:)
-                 name:SparkApplicationDidChangeEnabledNotification 
-               object:nil];
+  /* Objects, entries, applications and transactions */
+  [_library addLibraryObserver:self];
   
   /* PlugIns */
   [[NSNotificationCenter defaultCenter] addObserver:self
@@ -124,17 +108,34 @@ bool SparkLogSynchronization = false;
                                              object:nil];
 }
 - (void)removeObserver {
-  [_library.notificationCenter removeObserver:self];
+  [_library removeLibraryObserver:self];
   [[NSNotificationCenter defaultCenter] removeObserver:self];
 }
 
-- (NSDistantObject<SparkLibrary> *)distantLibrary {
-  return _remote;
+- (id<SparkLibrary>)distantLibrary {
+  return _recorder ? : _remote;
 }
 - (BOOL)isConnected {
+  if (_recorder)
+    return YES;
   return _remote && [[_remote connectionForProxy] isValid];
 }
 
+- (void)setRecorder:(id<SparkLibrary>)recorder {
+  if (!_remote) {
+    if (recorder && !_recorder)
+      [self registerObserver];
+    else if (!recorder && _recorder)
+      [self removeObserver];
+  }
+  _recorder = recorder;
+}
+
+/* changes made in a transaction are not sent one by one */
+- (BOOL)shouldSendMessage {
+  return ![_library isInTransaction] && [self isConnected];
+}
+
 - (void)setDistantLibrary:(NSDistantObject<SparkLibrary> *)remoteLibrary {
   if (remoteLibrary && ![remoteLibrary conformsToProtocol:@protocol(SparkLibrary)]) {
     SPXThrowException(NSInvalidArgumentException, @"Remote Library %@ MUST conform to <SparkLibrary>", remoteLibrary);
@@ -144,7 +145,9 @@ bool SparkLogSynchronization = false;
   if (remoteLibrary != _remote) {
     /* If set null => unregister */
     if (!remoteLibrary) {
-      [self removeObserver];
+      if (!_recorder)
+        [self removeObserver];
+      /* the daemon may not have mapped the last snapshot yet: it is unlinked when replaced, or on termination */
     } else {
       /* Check library UUID */
       uuidstr = [remoteLibrary uuid];
@@ -160,7 +163,7 @@ bool SparkLogSynchronization = false;
       }
       
       /* UUID OK, if not already registred => register */
-      if (!_remote)
+      if (!_remote && !_recorder)
         [self registerObserver];
     }
     /* Swap instance variable */
@@ -198,12 +201,11 @@ SparkObjectType SparkServerObjectType(SparkObject *anObject) {
   return 0;
 }
 
-- (void)didAddObject:(NSNotification *)aNotification {
-  if ([self isConnected]) {
+- (void)library:(SparkLibrary *)library didAddObject:(SparkObject *)object toSet:(SparkObjectSet *)aSet {
+  if ([self shouldSendMessage]) {
     SparkObjectType type;
-    SparkObject *object = SparkNotificationObject(aNotification);
     if (object && (type = SparkServerObjectType(object))) {
-      NSDictionary *plist = [[aNotification object] serialize:object error:NULL];
+      NSDictionary *plist = [aSet serialize:object error:NULL];
       if (plist) {
         SparkRemoteMessage(addObject:plist type:type);
       } else {
@@ -215,10 +217,9 @@ SparkObjectType SparkServerObjectType(SparkObject *anObject) {
   }
 }
 
-- (void)willRemoveObject:(NSNotification *)aNotification {
-  if ([self isConnected]) {
+- (void)library:(SparkLibrary *)library willRemoveObject:(SparkObject *)object fromSet:(SparkObjectSet *)aSet {
+  if ([self shouldSendMessage]) {
     SparkObjectType type;
-    SparkObject *object = SparkNotificationObject(aNotification);
     if (object && (type = SparkServerObjectType(object))) {
       SparkRemoteMessage(removeObject:[object uid] type:type);
     }
@@ -226,34 +227,30 @@ SparkObjectType SparkServerObjectType(SparkObject *anObject) {
 }
 
 #pragma mark Entries
-- (void)didAddEntry:(NSNotification *)aNotification {
-  if ([self isConnected]) {
-    SparkEntry *entry = SparkNotificationObject(aNotification);
+- (void)library:(SparkLibrary *)library didAddEntry:(SparkEntry *)entry {
+  if ([self shouldSendMessage]) {
     if (entry) {
       SparkRemoteMessage(addEntry:entry parent:[[entry parent] uid]);
     }
   }
 }
-- (void)didUpdateEntry:(NSNotification *)aNotification {
-  if ([self isConnected]) {
-    SparkEntry *entry = SparkNotificationObject(aNotification);
+- (void)library:(SparkLibrary *)library didUpdateEntry:(SparkEntry *)entry previous:(SparkEntry *)previous {
+  if ([self shouldSendMessage]) {
     if (entry) {
       SparkRemoteMessage(updateEntry:entry);
     }
   }
 }
-- (void)didRemoveEntry:(NSNotification *)aNotification {
-  if ([self isConnected]) {
-    SparkEntry *entry = SparkNotificationObject(aNotification);
+- (void)library:(SparkLibrary *)library didRemoveEntry:(SparkEntry *)entry {
+  if ([self shouldSendMessage]) {
     if (entry) {
       SparkRemoteMessage(removeEntry:[entry uid]);
     }
   }
 }
 
-- (void)didChangeEntryStatus:(NSNotification *)aNotification {
-  if ([self isConnected]) {
-    SparkEntry *entry = SparkNotificationObject(aNotification);
+- (void)library:(SparkLibrary *)library didChangeEntryStatus:(SparkEntry *)entry {
+  if ([self shouldSendMessage]) {
     if (entry) {
       if ([entry isEnabled]) {
         SparkRemoteMessage(enableEntry:[entry uid]);
@@ -265,9 +262,8 @@ SparkObjectType SparkServerObjectType(SparkObject *anObject) {
 }
 
 #pragma mark Applications
-- (void)didChangeApplicationStatus:(NSNotification *)aNotification {
-  if ([self isConnected]) {
-    SparkApplication *app = [aNotification object];
+- (void)library:(SparkLibrary *)library didChangeApplicationStatus:(SparkApplication *)app {
+  if ([self shouldSendMessage]) {
     if (app) {
       if ([app isEnabled])
         SparkRemoteMessage(enableApplication:[app uid]);
@@ -277,6 +273,91 @@ SparkObjectType SparkServerObjectType(SparkObject *anObject) {
   }
 }
 
+#pragma mark Transactions
+/* published segments not unlinked yet (they outlive the synchronizer) */
+static NSMutableSet *sSparkPublishedSnapshots = nil;
+
+static
+void SparkSynchronizerPublishedSnapshot(NSString *name, NSString *previous) {
+  static dispatch_once_t sOnce;
+  dispatch_once(&sOnce, ^{
+    sSparkPublishedSnapshots = [[NSMutableSet alloc] init];
+    [[NSNotificationCenter defaultCenter] addObserverForName:NSApplicationWillTerminateNotification
+                                                      object:nil queue:nil
+                                                  usingBlock:^(NSNotification *note) {
+      for (NSString *snapshot in sSparkPublishedSnapshots)
+        SparkLibraryUnlinkSnapshot(snapshot);
+      [sSparkPublishedSnapshots removeAllObjects];
+    }];
+  });
+  if (previous) {
+    SparkLibraryUnlinkSnapshot(previous);
+    [sSparkPublishedSnapshots removeObject:previous];
+  }
+  [sSparkPublishedSnapshots addObject:name];
+}
+
+/* send the transaction content one message at a time (snapshot not available) */
+- (void)sendChanges:(SparkLibraryChanges *)changes {
+  NSArray *sets = @[[_library actionSet], [_library triggerSet], [_library applicationSet]];
+  for (SparkEntry *entry in [changes removedEntries])
+    SparkRemoteMessage(removeEntry:[entry uid]);
+  for (SparkObjectSet *set in sets) {
+    for (SparkObject *object in [changes removedObjectsInSet:set])
+      SparkRemoteMessage(removeObject:[object uid] type:SparkServerObjectType(object));
+  }
+  for (SparkObjectSet *set in sets) {
+    for (SparkObject *object in [changes addedObjectsInSet:set]) {
+      NSDictionary *plist = [set serialize:object error:NULL];
+      if (plist)
+        SparkRemoteMessage(addObject:plist type:SparkServerObjectType(object));
+    }
+  }
+  /* parents before their variants */
+  NSSet *added = [changes addedEntries];
+  for (SparkEntry *entry in added) {
+    if (![entry parent])
+      SparkRemoteMessage(addEntry:entry parent:0);
+  }
+  for (SparkEntry *entry in added) {
+    if ([entry parent])
+      SparkRemoteMessage(addEntry:entry parent:[[entry parent] uid]);
+  }
+  for (SparkEntry *entry in [changes updatedEntries])
+    SparkRemoteMessage(updateEntry:entry);
+  for (SparkEntry *entry in [changes toggledEntries]) {
+    if ([entry isEnabled])
+      SparkRemoteMessage(enableEntry:[entry uid]);
+    else
+      SparkRemoteMessage(disableEntry:[entry uid]);
+  }
+  for (SparkApplication *app in [changes toggledApplications]) {
+    if ([app isEnabled])
+      SparkRemoteMessage(enableApplication:[app uid]);
+    else
+      SparkRemoteMessage(disableApplication:[app uid]);
+  }
+}
+
+- (void)library:(SparkLibrary *)library didCommitChanges:(SparkLibraryChanges *)changes {
+  /* nothing the daemon cares about (lists are not synchronized) */
+  if ([changes isEmpty])
+    return;
+  if ([self isConnected]) {
+    NSString *name = SparkLibraryPublishSnapshot(_library, ++_generation);
+    if (name) {
+      SparkRemoteMessage(loadSnapshot:name);
+      /* loadSnapshot: is oneway, so only the previous segment can be unlinked.
+       A snapshot is a full image: if the daemon did not map it yet, the next one supersedes it anyway. */
+      SparkSynchronizerPublishedSnapshot(name, _snapshot);
+      _snapshot = name;
+    } else {
+      SPXLogWarning(@"Failed to publish library snapshot, sending changes one by one");
+      [self sendChanges:changes];
+    }
+  }
+}
+
 #pragma mark PlugIns Synchronization
 - (void)didRegisterPlugIn:(NSNotification *)aNotification {
   if ([self isConnected]) {
@@ -288,6 +369,12 @@ SparkObjectType SparkServerObjectType(SparkObject *anObject) {
 @end
 
 #pragma mark -
+@interface SparkDistantLibrary ()
+
+@property(readwrite) SparkLibrarySnapshot *snapshot;
+
+@end
+
 @interface SparkDistantLibrary (SparkLibraryProtocol) <SparkLibrary>
 
 @end
@@ -320,19 +407,6 @@ SparkObjectType SparkServerObjectType(SparkObject *anObject) {
 
 #pragma mark -
 #pragma mark Protocol
-WB_INLINE
-SparkObjectSet *SparkObjectSetForType(SparkLibrary *library, SparkObjectType type) {
-  switch (type) {
-    case kSparkActionType:
-      return [library actionSet];
-    case kSparkTriggerType:
-      return [library triggerSet];
-    case kSparkApplicationType:
-      return [library applicationSet];
-  }
-  return nil;
-}
-
 #define SparkSyncTrace() ({if (SparkLogSynchronization) { NSLog(@"-[SparkDistantLibrary %@]", NSStringFromSelector(_cmd)); }})
 
 @implementation SparkDistantLibrary (SparkLibraryProtocol)
@@ -423,4 +497,333 @@ SparkObjectSet *SparkObjectSetForType(SparkLibrary *library, SparkObjectType typ
   }
 }
 
+#pragma mark Snapshots
+- (void)loadSnapshot:(NSString *)name {
+  SparkSyncTrace();
+  SparkLibrarySnapshot *snapshot = [[SparkLibrarySnapshot alloc] initWithName:name];
+  if (!snapshot) {
+    SPXDebug(@"Error while loading snapshot: %@", name);
+    return;
+  }
+  /* the mapping outlives the name, so the segment is not leaked if the editor crashes */
+  SparkLibraryUnlinkSnapshot(name);
+  if (![snapshot.uuid isEqual:_library.uuid]) {
+    SPXLogWarning(@"Snapshot %@ does not match library %@", name, _library.uuid);
+    return;
+  }
+  /* messages may be delivered out of order, ignore stale snapshots */
+  SparkLibrarySnapshot *current = self.snapshot;
+  if (current && snapshot.generation <= current.generation)
+    return;
+
+  [_library applySnapshot:snapshot];
+  self.snapshot = snapshot;
+}
+
 @end
+
+#pragma mark -
+#pragma mark Benchmark
+#if defined(DEBUG)
+
+NSString * const kSparkSyncReplayMessagesKey = @"Messages";
+NSString * const kSparkSyncReplayDurationKey = @"Duration";
+NSString * const kSparkSyncReplayConvergenceKey = @"Convergence";
+NSString * const kSparkSyncReplayMessagesPerSecondKey = @"MessagesPerSecond";
+NSString * const kSparkSyncReplayEqualKey = @"Equal";
+
+#define kSparkSyncSelectorKey   @"selector"
+#define kSparkSyncArgumentsKey  @"arguments"
+
+WB_INLINE
+NSDictionary *SparkSyncEntryRecord(SparkEntry *entry) {
+  return @{ @"uid": @(entry.uid), @"action": @(entry.actionUID), @"trigger": @(entry.triggerUID),
+            @"application": @(entry.applicationUID), @"enabled": @(entry.enabled) };
+}
+
+/* Replays entries the same way the port coder does, but against the target library */
+static
+SparkEntry *SparkSyncEntryFromRecord(NSDictionary *record, SparkLibrary *library) {
+  SparkEntry *entry = [SparkEntry entryWithAction:[library actionWithUID:[record[@"action"] unsignedIntValue]]
+                                          trigger:[library triggerWithUID:[record[@"trigger"] unsignedIntValue]]
+                                      application:[library applicationWithUID:[record[@"application"] unsignedIntValue]]];
+  entry.uid = [record[@"uid"] unsignedIntValue];
+  entry.enabled = [record[@"enabled"] boolValue];
+  return entry;
+}
+
+@interface SparkLibrarySyncRecorder : NSObject <SparkLibrary>
+
+- (instancetype)initWithLibrary:(SparkLibrary *)library;
+
+@property(nonatomic, readonly) NSMutableArray *messages;
+
+@end
+
+@implementation SparkLibrarySyncRecorder {
+@private
+  SparkLibrary *_library;
+}
+
+- (instancetype)initWithLibrary:(SparkLibrary *)library {
+  if (self = [super init]) {
+    _library = library;
+    _messages = [[NSMutableArray alloc] init];
+  }
+  return self;
+}
+
+- (void)record:(SEL)selector arguments:(NSArray *)arguments {
+  [_messages addObject:@{ kSparkSyncSelectorKey: NSStringFromSelector(selector), kSparkSyncArgumentsKey: arguments }];
+}
+
+- (NSString *)uuid {
+  return [_library.uuid UUIDString];
+}
+
+- (void)addObject:(id)plist type:(SparkObjectType)type {
+  [self record:_cmd arguments:@[plist, @(type)]];
+}
+- (void)removeObject:(SparkUID)uid type:(SparkObjectType)type {
+  [self record:_cmd arguments:@[@(uid), @(type)]];
+}
+
+- (void)addEntry:(SparkEntry *)anEntry parent:(SparkUID)parent {
+  [self record:_cmd arguments:@[SparkSyncEntryRecord(anEntry), @(parent)]];
+}
+- (void)updateEntry:(SparkEntry *)newEntry {
+  [self record:_cmd arguments:@[SparkSyncEntryRecord(newEntry)]];
+}
+- (void)removeEntry:(SparkUID)anEntry {
+  [self record:_cmd arguments:@[@(anEntry)]];
+}
+
+- (void)enableEntry:(SparkUID)anEntry {
+  [self record:_cmd arguments:@[@(anEntry)]];
+}
+- (void)disableEntry:(SparkUID)anEntry {
+  [self record:_cmd arguments:@[@(anEntry)]];
+}
+
+- (void)enableApplication:(SparkUID)uid {
+  [self record:_cmd arguments:@[@(uid)]];
+}
+- (void)disableApplication:(SparkUID)uid {
+  [self record:_cmd arguments:@[@(uid)]];
+}
+
+- (void)registerPlugIn:(NSURL *)bundlePath {
+  [self record:_cmd arguments:@[[bundlePath absoluteString]]];
+}
+
+- (void)loadSnapshot:(NSString *)name {
+  [self record:_cmd arguments:@[name]];
+}
+
+@end
+
+NSArray *SparkLibrarySyncRecord(SparkLibrary *library, void (^operations)(SparkLibrary *library)) {
+  NSCParameterAssert(library && operations);
+  SparkLibrarySyncRecorder *recorder = [[SparkLibrarySyncRecorder alloc] initWithLibrary:library];
+  SparkLibrarySynchronizer *sync = [[SparkLibrarySynchronizer alloc] initWithLibrary:library];
+  [sync setRecorder:recorder];
+  @try {
+    operations(library);
+  } @finally {
+    [sync setRecorder:nil];
+  }
+  return [recorder.messages copy];
+}
+
+static
+void SparkSyncReplayMessage(SparkDistantLibrary *distant, SparkLibrary *library, NSDictionary *message) {
+  SEL selector = NSSelectorFromString(message[kSparkSyncSelectorKey]);
+  NSArray *args = message[kSparkSyncArgumentsKey];
+  id<SparkLibrary> target = (id<SparkLibrary>)distant;
+  if (selector == @selector(addObject:type:)) {
+    [target addObject:args[0] type:[args[1] unsignedIntValue]];
+  } else if (selector == @selector(removeObject:type:)) {
+    [target removeObject:[args[0] unsignedIntValue] type:[args[1] unsignedIntValue]];
+  } else if (selector == @selector(addEntry:parent:)) {
+    [target addEntry:SparkSyncEntryFromRecord(args[0], library) parent:[args[1] unsignedIntValue]];
+  } else if (selector == @selector(updateEntry:)) {
+    [target updateEntry:SparkSyncEntryFromRecord(args[0], library)];
+  } else if (selector == @selector(removeEntry:)) {
+    [target removeEntry:[args[0] unsignedIntValue]];
+  } else if (selector == @selector(enableEntry:)) {
+    [target enableEntry:[args[0] unsignedIntValue]];
+  } else if (selector == @selector(disableEntry:)) {
+    [target disableEntry:[args[0] unsignedIntValue]];
+  } else if (selector == @selector(enableApplication:)) {
+    [target enableApplication:[args[0] unsignedIntValue]];
+  } else if (selector == @selector(disableApplication:)) {
+    [target disableApplication:[args[0] unsignedIntValue]];
+  } else if (selector == @selector(registerPlugIn:)) {
+    [target registerPlugIn:[NSURL URLWithString:args[0]]];
+  } else if (selector == @selector(loadSnapshot:)) {
+    /* the segment may have been unlinked since recording */
+    [target loadSnapshot:args[0]];
+  } else {
+    SPXLogWarning(@"Unsupported replay message: %@", message[kSparkSyncSelectorKey]);
+  }
+}
+
+NSDictionary *SparkLibrarySyncReplay(NSArray *messages, SparkLibrary *library) {
+  NSCParameterAssert(library);
+  SparkDistantLibrary *distant = [library distantLibrary];
+
+  CFAbsoluteTime duration = 0;
+  CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+  for (NSDictionary *message in messages) {
+    CFAbsoluteTime time = CFAbsoluteTimeGetCurrent();
+    @try {
+      SparkSyncReplayMessage(distant, library, message);
+    } @catch (id exception) {
+      SPXLogException(exception);
+    }
+    duration += CFAbsoluteTimeGetCurrent() - time;
+  }
+  /* let observers process delayed notifications */
+  while ([[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate date]])
+    ;
+  CFAbsoluteTime convergence = CFAbsoluteTimeGetCurrent() - start;
+
+  return @{
+    kSparkSyncReplayMessagesKey: @([messages count]),
+    kSparkSyncReplayDurationKey: @(duration),
+    kSparkSyncReplayConvergenceKey: @(convergence),
+    kSparkSyncReplayMessagesPerSecondKey: @(duration > 0 ? [messages count] / duration : 0),
+  };
+}
+
+/* same uids and same serialized content */
+static
+BOOL SparkObjectSetContentIsEqual(SparkObjectSet *set, SparkObjectSet *other) {
+  if ([set count] != [other count])
+    return NO;
+  __block BOOL equal = YES;
+  [set enumerateObjectsUsingBlock:^(SparkObject *object, BOOL *stop) {
+    SparkObject *match = [other objectWithUID:object.uid];
+    if (!match || ![[set serialize:object error:NULL] isEqual:[other serialize:match error:NULL]]) {
+      equal = NO;
+      *stop = YES;
+    }
+  }];
+  return equal;
+}
+
+BOOL SparkLibraryContentIsEqual(SparkLibrary *library, SparkLibrary *other) {
+  const SparkObjectType types[] = { kSparkActionType, kSparkTriggerType, kSparkApplicationType };
+  for (NSUInteger idx = 0; idx < sizeof(types) / sizeof(*types); idx++) {
+    if (!SparkObjectSetContentIsEqual(SparkObjectSetForType(library, types[idx]), SparkObjectSetForType(other, types[idx])))
+      return NO;
+  }
+  __block BOOL equal = YES;
+  __block NSUInteger count = 0;
+  SparkEntryManager *manager = other.entryManager;
+  [library.entryManager enumerateEntriesUsingBlock:^(SparkEntry *entry, BOOL *stop) {
+    SparkEntry *match = [manager entryWithUID:entry.uid];
+    count++;
+    if (!match || match.actionUID != entry.actionUID || match.triggerUID != entry.triggerUID ||
+        match.applicationUID != entry.applicationUID || match.parent.uid != entry.parent.uid || match.enabled != entry.enabled) {
+      equal = NO;
+      *stop = YES;
+    }
+  }];
+  if (equal) {
+    [manager enumerateEntriesUsingBlock:^(SparkEntry *entry, BOOL *stop) {
+      count--;
+    }];
+    equal = (0 == count);
+  }
+  return equal;
+}
+
+static
+SparkLibrary *SparkLibraryCopy(SparkLibrary *library) {
+  NSFileWrapper *wrapper = [library fileWrapper:NULL];
+  SparkLibrary *copy = [[SparkLibrary alloc] initWithURL:nil];
+  if (!wrapper || ![copy readFromFileWrapper:wrapper error:NULL])
+    return nil;
+  return copy;
+}
+
+/* Scripted editor operations */
+static
+void SparkSyncBenchmarkOperations(SparkLibrary *library) {
+  SparkEntryManager *manager = library.entryManager;
+
+  /* Bulk import: add a copy of every system entry (new action and trigger objects) */
+  NSMutableArray *roots = [[NSMutableArray alloc] init];
+  [manager enumerateEntriesUsingBlock:^(SparkEntry *entry, BOOL *stop) {
+    if (entry.isSystem)
+      [roots addObject:entry];
+  }];
+  for (SparkEntry *entry in roots) {
+    SparkAction *action = (SparkAction *)[library.actionSet deserialize:[library.actionSet serialize:entry.action error:NULL] error:NULL];
+    SparkTrigger *trigger = (SparkTrigger *)[library.triggerSet deserialize:[library.triggerSet serialize:entry.trigger error:NULL] error:NULL];
+    if (!action || !trigger)
+      continue;
+    action.uid = 0;
+    trigger.uid = 0;
+    [library.actionSet addObject:action];
+    [library.triggerSet addObject:trigger];
+    [manager addEntryWithAction:action trigger:trigger application:library.systemApplication];
+  }
+
+  /* Delete the application with the most variants */
+  __block SparkApplication *application = nil;
+  __block NSUInteger variants = 0;
+  [library.applicationSet enumerateObjectsUsingBlock:^(SparkApplication *app, BOOL *stop) {
+    NSUInteger count = [[manager entriesForApplication:app] count];
+    if (app.uid > kSparkLibraryReserved && count > variants) {
+      variants = count;
+      application = app;
+    }
+  }];
+  if (application)
+    [library.applicationSet removeObject:application];
+
+  /* Toggle the largest list */
+  __block SparkList *list = nil;
+  [library.listSet enumerateObjectsUsingBlock:^(SparkList *aList, BOOL *stop) {
+    if (!list || aList.count > list.count)
+      list = aList;
+  }];
+  for (SparkEntry *entry in [list entries]) {
+    if (entry.enabled)
+      entry.enabled = NO;
+    else if (![manager activeEntryForTrigger:entry.trigger application:entry.application])
+      entry.enabled = YES;
+  }
+}
+
+NSDictionary *SparkLibrarySyncBenchmark(SparkLibrary *library, NSURL *replayURL) {
+  SparkLibrary *source = SparkLibraryCopy(library);
+  SparkLibrary *target = SparkLibraryCopy(library);
+  if (!source || !target) {
+    SPXLogWarning(@"Failed to copy library %@", library.uuid);
+    return nil;
+  }
+
+  /* the editor groups bulk operations in a transaction */
+  NSArray *messages = SparkLibrarySyncRecord(source, ^(SparkLibrary *aLibrary) {
+    [aLibrary beginTransaction];
+    @try {
+      SparkSyncBenchmarkOperations(aLibrary);
+    } @finally {
+      [aLibrary commitTransaction];
+    }
+  });
+  if (replayURL) {
+    NSData *data = [NSPropertyListSerialization dataWithPropertyList:messages format:NSPropertyListBinaryFormat_v1_0 options:0 error:NULL];
+    if (![data writeToURL:replayURL atomically:YES])
+      SPXLogWarning(@"Failed to write replay file: %@", replayURL);
+  }
+
+  NSMutableDictionary *result = [SparkLibrarySyncReplay(messages, target) mutableCopy];
+  result[kSparkSyncReplayEqualKey] = @(SparkLibraryContentIsEqual(source, target));
+  return result;
+}
+
+#endif /* DEBUG */
@@ -13,6 +13,17 @@
 
 typedef bool(^SparkListFilter)(SparkList *, SparkEntry *);
 
+/* What a dynamic list filter depends on. Entry changes are only sent to the lists that may accept the entry. */
+typedef NS_ENUM(NSInteger, SparkListFilterKind) {
+  kSparkListFilterAny = 0,
+  /* accepts only entries whose action is kind of a class. value: class name */
+  kSparkListFilterActionClass,
+  /* accepts only entries of an application. value: SparkApplication */
+  kSparkListFilterApplication,
+  /* accepts only enabled or disabled entries. value: NSNumber */
+  kSparkListFilterEnabled,
+};
+
 SPARK_EXPORT
 NSString * const SparkListDidReloadNotification;
 
@@ -37,6 +48,11 @@ SPARK_OBJC_EXPORT
 
 @property(nonatomic, copy) SparkListFilter filter;
 
+/* filter kind is kSparkListFilterAny when using -setFilter: */
+- (void)setFilter:(SparkListFilter)aFilter kind:(SparkListFilterKind)kind value:(id)value;
+@property(nonatomic, readonly) SparkListFilterKind filterKind;
+@property(nonatomic, readonly) id filterValue;
+
 @property(nonatomic, readonly) NSUInteger count;
 
 - (BOOL)containsEntry:(SparkEntry *)anEntry;
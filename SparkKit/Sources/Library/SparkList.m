@@ -16,6 +16,10 @@
 #import <WonderBox/NSImage+WonderBox.h>
 
 #import "SparkEntryPrivate.h"
+#import "SparkListPrivate.h"
+#import "SparkUndoJournal.h"
+
+#import <objc/runtime.h>
 
 /* Reload when filter change */
 NSString * const SparkListDidReloadNotification = @"SparkListDidReload";
@@ -107,58 +111,23 @@ NSString * const kSparkObjectsKey = @"SparkObjects";
 
 - (void)setLibrary:(SparkLibrary *)aLibrary {
   if (aLibrary != self.library) {
-    if (self.library) {
-      NSNotificationCenter *nc = self.library.notificationCenter;
-      [nc removeObserver:self
-                    name:SparkEntryManagerDidAddEntryNotification
-                  object:nil];
-      [nc removeObserver:self
-                    name:SparkEntryManagerDidUpdateEntryNotification
-                  object:nil];
-      [nc removeObserver:self
-                    name:SparkEntryManagerWillRemoveEntryNotification
-                  object:nil];
-      /* Entry tree */
-      //			[nc removeObserver:self
-      //																										 name:SparkEntryDidAppendChildNotification
-      //																									 object:nil];
-      [nc removeObserver:self
-                    name:SparkEntryWillRemoveChildNotification
-                  object:nil];
-    }
+    [[self.library listRouter] removeList:self];
     [super setLibrary:aLibrary];
-    if (self.library) {
-      NSNotificationCenter *nc = self.library.notificationCenter;
-      /* Add */
-      [nc addObserver:self
-             selector:@selector(didAddEntry:)
-                 name:SparkEntryManagerDidAddEntryNotification
-               object:nil];
-      /* Update */
-      [nc addObserver:self
-             selector:@selector(didUpdateEntry:)
-                 name:SparkEntryManagerDidUpdateEntryNotification
-               object:nil];
-      /* Remove */
-      [nc addObserver:self
-             selector:@selector(willRemoveEntry:)
-                 name:SparkEntryManagerWillRemoveEntryNotification
-               object:nil];
-      /* Entry tree */
-      //			[nc addObserver:self
-      //                                              selector:@selector(didAppendEntryChild:)
-      //                                                  name:SparkEntryDidAppendChildNotification
-      //                                                object:nil];
-      //      [nc addObserver:self
-      //                                              selector:@selector(willRemoveEntryChild:)
-      //                                                  name:SparkEntryWillRemoveChildNotification
-      //                                                object:nil];
-    }
+    /* Entry changes */
+    [[self.library listRouter] addList:self];
   }
 }
 
 - (void)setFilter:(SparkListFilter)aFilter {
-  _filter = aFilter;
+  [self setFilter:aFilter kind:kSparkListFilterAny value:nil];
+}
+
+- (void)setFilter:(SparkListFilter)aFilter kind:(SparkListFilterKind)kind value:(id)value {
+  NSParameterAssert(kSparkListFilterAny == kind || value);
+  _filter = [aFilter copy];
+  _filterKind = aFilter ? kind : kSparkListFilterAny;
+  _filterValue = aFilter ? value : nil;
+  [[self.library listRouter] listDidChangeFilter:self];
   [self reload]; // Refresh contents
 }
 
@@ -226,7 +195,7 @@ NSString * const kSparkObjectsKey = @"SparkObjects";
 	if ([inserted count] > 0) {
 		/* Undo Manager */
 		if (!self.isDynamic)
-			[self.undoManager registerUndoWithTarget:self selector:@selector(removeEntriesInArray:) object:inserted];
+			[self.library.undoJournal recordList:self insertEntries:inserted];
 		
 		NSRange range = NSMakeRange([_entries count], [inserted count]);
 		NSIndexSet *idxs = [NSIndexSet indexSetWithIndexesInRange:range];
@@ -259,7 +228,7 @@ NSString * const kSparkObjectsKey = @"SparkObjects";
 		NSArray *removed = [_entries objectsAtIndexes:idxs];
 		/* Undo Manager */
     if (!self.isDynamic)
-      [self.undoManager registerUndoWithTarget:self selector:@selector(addEntriesFromArray:) object:removed];
+      [self.library.undoJournal recordList:self removeEntries:removed];
 		
 		[self willChange:NSKeyValueChangeRemoval valuesAtIndexes:idxs forKey:@"entries"];
 		[_entries removeObjectsAtIndexes:idxs];
@@ -310,17 +279,16 @@ NSString * const kSparkObjectsKey = @"SparkObjects";
  Add a new entry in the entry manager.:
  - if list is dynamic and entry is accepted, insert the entry 
  */
-- (void)didAddEntry:(NSNotification *)aNotification {
+- (void)didAddEntry:(SparkEntry *)entry {
 	if (self.isDynamic) {
-		SparkEntry *entry = SparkNotificationObject(aNotification);
-		NSAssert1(entry, @"invalid notification: %@", aNotification);
+		NSParameterAssert(entry);
 		/* we do not have to check the entry children */
 		if (![self containsEntry:entry] && [self acceptsEntry:entry])
 			[self insertObject:entry inEntriesAtIndex:[_entries count]];
 	}
 }
-- (void)didUpdateEntry:(NSNotification *)aNotification {
-  SparkEntry *entry = [SparkNotificationObject(aNotification) root];
+- (void)didUpdateEntry:(SparkEntry *)anEntry {
+  SparkEntry *entry = [anEntry root];
 	
 	NSUInteger idx = [self indexOfEntry:entry];
 	/* If contains old value */
@@ -338,9 +306,8 @@ NSString * const kSparkObjectsKey = @"SparkObjects";
 	}
 }
 
-- (void)willRemoveEntry:(NSNotification *)aNotification {
-  SparkEntry *entry = SparkNotificationObject(aNotification);
-  NSAssert1(entry, @"invalid notification: %@", aNotification);
+- (void)willRemoveEntry:(SparkEntry *)entry {
+  NSParameterAssert(entry);
 	
 	/* 'remove' will be handle by the redo if needed */
 	if (!self.isDynamic && [self.undoManager isRedoing])
@@ -400,7 +367,7 @@ NSString * const kSparkObjectsKey = @"SparkObjects";
     anEntry = [anEntry root];
   }
 	if (!self.isDynamic) {
-		[[self.undoManager prepareWithInvocationTarget:self] removeObjectFromEntriesAtIndex:idx];
+		[self.library.undoJournal recordList:self insertEntryAtIndex:idx];
 	}
   [_entries insertObject:anEntry atIndex:idx];
   SparkLibraryPostNotification([self library], SparkListDidAddObjectNotification, self, anEntry);
@@ -409,7 +376,7 @@ NSString * const kSparkObjectsKey = @"SparkObjects";
   SparkEntry *entry = [_entries objectAtIndex:idx];
   /* Undo Manager */
   if (!self.isDynamic) {
-    [[self.undoManager prepareWithInvocationTarget:self] insertObject:entry inEntriesAtIndex:idx];
+    [self.library.undoJournal recordList:self removeEntry:entry atIndex:idx];
 	}
   [_entries removeObjectAtIndex:idx];
   SparkLibraryPostNotification([self library], SparkListDidRemoveObjectNotification, self, entry);
@@ -419,7 +386,7 @@ NSString * const kSparkObjectsKey = @"SparkObjects";
 	if ([object root] == previous) return;
 	
 	if (!self.isDynamic)
-    [[self.undoManager prepareWithInvocationTarget:self] replaceObjectAtIndex:idx withObject:previous];
+    [self.library.undoJournal recordList:self replaceEntry:previous atIndex:idx];
   [_entries replaceObjectAtIndex:idx withObject:object];
 	SparkLibraryPostUpdateNotification([self library], SparkListDidUpdateObjectNotification, self, previous, object);
 }
@@ -447,3 +414,154 @@ NSString * const kSparkObjectsKey = @"SparkObjects";
 //    }
 //  }
 //}
+
+#pragma mark -
+@implementation SparkListRouter {
+@private
+  /* static lists receive all updates and removals */
+  NSHashTable *sp_static;
+  /* dynamic lists without index */
+  NSHashTable *sp_any;
+  /* filter value => lists */
+  NSMutableDictionary *sp_classes;
+  NSMutableDictionary *sp_applications;
+  NSMutableDictionary *sp_status;
+}
+
+- (instancetype)initWithLibrary:(SparkLibrary *)aLibrary {
+  NSParameterAssert(aLibrary);
+  if (self = [super init]) {
+    sp_static = [NSHashTable weakObjectsHashTable];
+    sp_any = [NSHashTable weakObjectsHashTable];
+    sp_classes = [[NSMutableDictionary alloc] init];
+    sp_applications = [[NSMutableDictionary alloc] init];
+    sp_status = [[NSMutableDictionary alloc] init];
+
+    /* owned by the library */
+    [aLibrary addLibraryObserver:self];
+  }
+  return self;
+}
+
+#pragma mark Index
+- (NSMutableDictionary *)indexForKind:(SparkListFilterKind)kind {
+  switch (kind) {
+    case kSparkListFilterActionClass:
+      return sp_classes;
+    case kSparkListFilterApplication:
+      return sp_applications;
+    case kSparkListFilterEnabled:
+      return sp_status;
+    default:
+      return nil;
+  }
+}
+
+- (id)keyForList:(SparkList *)aList {
+  id value = aList.filterValue;
+  if (kSparkListFilterApplication == aList.filterKind)
+    return @([(SparkApplication *)value uid]);
+  if (kSparkListFilterEnabled == aList.filterKind)
+    return @([value boolValue]);
+  return value;
+}
+
+- (NSHashTable *)tableForList:(SparkList *)aList create:(BOOL)create {
+  if (!aList.dynamic)
+    return sp_static;
+  NSMutableDictionary *index = [self indexForKind:aList.filterKind];
+  if (!index)
+    return sp_any;
+  id key = [self keyForList:aList];
+  NSHashTable *lists = index[key];
+  if (!lists && create) {
+    lists = [NSHashTable weakObjectsHashTable];
+    index[key] = lists;
+  }
+  return lists;
+}
+
+- (void)addList:(SparkList *)aList {
+  [[self tableForList:aList create:YES] addObject:aList];
+}
+
+- (void)removeList:(SparkList *)aList {
+  /* the list filter may have changed since it was added */
+  [sp_static removeObject:aList];
+  [sp_any removeObject:aList];
+  for (NSMutableDictionary *index in @[sp_classes, sp_applications, sp_status]) {
+    for (id key in [index allKeys]) {
+      NSHashTable *lists = index[key];
+      [lists removeObject:aList];
+      if (![lists count])
+        [index removeObjectForKey:key];
+    }
+  }
+}
+
+- (void)listDidChangeFilter:(SparkList *)aList {
+  [self removeList:aList];
+  [self addList:aList];
+}
+
+#pragma mark Routing
+static
+void _SparkListRouterAddLists(NSHashTable *lists, NSHashTable *result) {
+  for (SparkList *list in lists)
+    [result addObject:list];
+}
+
+/* lists that may accept the entry */
+- (void)addListsForEntry:(SparkEntry *)anEntry to:(NSHashTable *)result {
+  if ([sp_classes count]) {
+    for (Class cls = [anEntry.action class]; cls; cls = class_getSuperclass(cls))
+      _SparkListRouterAddLists(sp_classes[NSStringFromClass(cls)], result);
+  }
+  if ([sp_applications count])
+    _SparkListRouterAddLists(sp_applications[@(anEntry.application.uid)], result);
+  if ([sp_status count])
+    _SparkListRouterAddLists(sp_status[@(anEntry.enabled)], result);
+}
+
+/* dynamic lists contain root entries accepted by the root or one of its variants */
+- (void)addListsForEntryFamily:(SparkEntry *)anEntry to:(NSHashTable *)result {
+  SparkEntry *root = [anEntry root] ? : anEntry;
+  [self addListsForEntry:root to:result];
+  for (SparkEntry *child = [root firstChild]; child; child = [child sibling])
+    [self addListsForEntry:child to:result];
+  /* entry not attached yet */
+  if (anEntry != root)
+    [self addListsForEntry:anEntry to:result];
+}
+
+- (NSHashTable *)dynamicListsForEntry:(SparkEntry *)anEntry {
+  NSHashTable *lists = [NSHashTable hashTableWithOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality];
+  _SparkListRouterAddLists(sp_any, lists);
+  [self addListsForEntryFamily:anEntry to:lists];
+  return lists;
+}
+
+#pragma mark Library Observer
+- (void)library:(SparkLibrary *)library didAddEntry:(SparkEntry *)entry {
+  for (SparkList *list in [self dynamicListsForEntry:entry])
+    [list didAddEntry:entry];
+}
+
+- (void)library:(SparkLibrary *)library didUpdateEntry:(SparkEntry *)entry previous:(SparkEntry *)previous {
+  NSHashTable *lists = [self dynamicListsForEntry:entry];
+  /* lists that accepted the previous value */
+  if (previous)
+    [self addListsForEntry:previous to:lists];
+  _SparkListRouterAddLists(sp_static, lists);
+  for (SparkList *list in lists)
+    [list didUpdateEntry:entry];
+}
+
+- (void)library:(SparkLibrary *)library willRemoveEntry:(SparkEntry *)entry {
+  NSHashTable *lists = [self dynamicListsForEntry:entry];
+  _SparkListRouterAddLists(sp_static, lists);
+  for (SparkList *list in lists)
+    [list willRemoveEntry:entry];
+}
+
+@end
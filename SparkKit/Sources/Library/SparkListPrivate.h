@@ -0,0 +1,38 @@
+/*
+ *  SparkListPrivate.h
+ *  SparkKit
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+#import <SparkKit/SparkList.h>
+#import <SparkKit/SparkLibraryObserver.h>
+
+/*
+ Dispatch the entry manager changes to the lists of a library.
+ Dynamic lists are indexed by filter kind, so an entry change is only sent
+ to the lists that may accept the entry (or one of its variants).
+ */
+@interface SparkListRouter : NSObject <SparkLibraryObserver>
+
+- (instancetype)initWithLibrary:(SparkLibrary *)aLibrary;
+
+/* lists are not retained */
+- (void)addList:(SparkList *)aList;
+- (void)removeList:(SparkList *)aList;
+
+/* must be called when the list filter kind changed */
+- (void)listDidChangeFilter:(SparkList *)aList;
+
+@end
+
+@interface SparkList (SparkListRouter)
+- (void)didAddEntry:(SparkEntry *)anEntry;
+- (void)didUpdateEntry:(SparkEntry *)anEntry;
+- (void)willRemoveEntry:(SparkEntry *)anEntry;
+@end
+
+@interface SparkLibrary (SparkListRouter)
+- (SparkListRouter *)listRouter;
+@end
@@ -13,7 +13,7 @@
 @class SparkObjectSet
 @abstract Spark Objects Library.
 */
-@class SparkLibrary;
+@class SparkLibrary, SparkTrigger;
 
 SPARK_OBJC_EXPORT
 @interface SparkObjectSet : NSObject
@@ -36,6 +36,9 @@ SPARK_OBJC_EXPORT
 
 - (id)objectWithUID:(SparkUID)uid;
 
+/* trigger set only: returns the trigger equivalent to aTrigger (see -[SparkTrigger isEqualToTrigger:]) */
+- (SparkTrigger *)memberTrigger:(SparkTrigger *)aTrigger;
+
 - (BOOL)addObject:(SparkObject *)object;
 //- (BOOL)updateObject:(SparkObject *)object;
 - (void)removeObject:(SparkObject *)object;
@@ -16,10 +16,16 @@
 #import <SparkKit/SparkAction.h>
 #import <SparkKit/SparkTrigger.h>
 #import <SparkKit/SparkApplication.h>
+#import <SparkKit/SparkPlugIn.h>
+#import <SparkKit/SparkActionLoader.h>
 
 #import <WonderBox/WBSerialization.h>
 #import <WonderBox/NSImage+WonderBox.h>
 
+#import "SparkUndoJournal.h"
+#import "SparkLibraryPrivate.h"
+#import "SparkUIDTable.h"
+
 /* Notifications */
 NSString* const SparkObjectSetWillAddObjectNotification = @"SparkObjectSetWillAddObject";
 NSString* const SparkObjectSetDidAddObjectNotification = @"SparkObjectSetDidAddObject";
@@ -66,7 +72,9 @@ NSComparator SparkObjectCompare = ^NSComparisonResult(SparkObject *obj1, SparkOb
 @implementation SparkObjectSet {
 @private
   SparkUID sp_uid;
-  NSMutableDictionary *sp_objects;
+  SparkUIDTable *sp_objects;
+  /* trigger hash => equivalent triggers, built on demand */
+  NSMutableDictionary *sp_triggers;
 }
 
 + (instancetype)objectsSetWithLibrary:(SparkLibrary *)aLibrary {
@@ -84,7 +92,7 @@ NSComparator SparkObjectCompare = ^NSComparisonResult(SparkObject *obj1, SparkOb
   if (self = [super init]) {
     _library = aLibrary;
     sp_uid = kSparkLibraryReserved;
-    sp_objects = [[NSMutableDictionary alloc] init];
+    sp_objects = [[SparkUIDTable alloc] init];
   }
   return self;
 }
@@ -102,6 +110,7 @@ NSComparator SparkObjectCompare = ^NSComparisonResult(SparkObject *obj1, SparkOb
     [self.allObjects makeObjectsPerformSelector:@selector(setLibrary:)
                                      withObject:nil];
     [sp_objects removeAllObjects];
+    sp_triggers = nil;
     _library = aLibrary;
   }
 }
@@ -116,32 +125,61 @@ NSComparator SparkObjectCompare = ^NSComparisonResult(SparkObject *obj1, SparkOb
 }
 
 - (NSArray *)allObjects {
-  return [sp_objects allValues];
+  return [sp_objects allObjects];
 }
 
 - (void)enumerateObjectsUsingBlock:(void (^)(id obj, BOOL *stop))block {
-  [sp_objects enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL *stop) {
-    block(obj, stop);
-  }];
+  [sp_objects enumerateObjectsUsingBlock:block];
 }
 
 - (BOOL)containsObject:(SparkObject *)object {
-  __block BOOL contains = NO;
-  /* Must compare using equals and not using uid */
-  [sp_objects enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL *stop) {
-    if ([obj isEqual:object]) {
-      *stop = contains = YES;
-    }
-  }];
-  return contains;
+  /* Must compare using equals and not using uid (but equal objects have the same uid) */
+  SparkObject *obj = [sp_objects objectForUID:object.uid];
+  return obj && [obj isEqual:object];
 }
 
 - (BOOL)containsObjectWithUID:(SparkUID)uid {
-  return sp_objects[@(uid)] != nil;
+  return [sp_objects objectForUID:uid] != nil;
 }
 
 - (id)objectWithUID:(SparkUID)uid {
-  return sp_objects[@(uid)];
+  return [sp_objects objectForUID:uid];
+}
+
+#pragma mark Trigger Index
+- (void)sp_indexTrigger:(SparkTrigger *)aTrigger {
+  NSNumber *key = @([aTrigger triggerHash]);
+  NSMutableArray *triggers = sp_triggers[key];
+  if (!triggers) {
+    triggers = [[NSMutableArray alloc] initWithCapacity:1];
+    sp_triggers[key] = triggers;
+  }
+  [triggers addObject:aTrigger];
+}
+
+- (void)sp_unindexTrigger:(SparkTrigger *)aTrigger {
+  NSNumber *key = @([aTrigger triggerHash]);
+  NSMutableArray *triggers = sp_triggers[key];
+  [triggers removeObjectIdenticalTo:aTrigger];
+  if (triggers && ![triggers count])
+    [sp_triggers removeObjectForKey:key];
+}
+
+- (SparkTrigger *)memberTrigger:(SparkTrigger *)aTrigger {
+  if (!aTrigger)
+    return nil;
+  if (!sp_triggers) {
+    sp_triggers = [[NSMutableDictionary alloc] init];
+    [sp_objects enumerateObjectsUsingBlock:^(id obj, BOOL *stop) {
+      if ([obj isKindOfClass:[SparkTrigger class]])
+        [self sp_indexTrigger:obj];
+    }];
+  }
+  for (SparkTrigger *trigger in sp_triggers[@([aTrigger triggerHash])]) {
+    if ([aTrigger isEqualToTrigger:trigger])
+      return trigger;
+  }
+  return nil;
 }
 
 #pragma mark -
@@ -154,8 +192,10 @@ NSComparator SparkObjectCompare = ^NSComparisonResult(SparkObject *obj1, SparkOb
 }
 
 - (void)sp_addObject:(SparkObject *)object {
-  [sp_objects setObject:object forKey:@(object.uid)];
+  [sp_objects setObject:object forUID:object.uid];
   [object setLibrary:[self library]];
+  if (sp_triggers && [object isKindOfClass:[SparkTrigger class]])
+    [self sp_indexTrigger:(SparkTrigger *)object];
 }
 
 - (BOOL)addObject:(SparkObject *)object {
@@ -170,17 +210,14 @@ NSComparator SparkObjectCompare = ^NSComparisonResult(SparkObject *obj1, SparkOb
       SparkUID uid = [object uid], luid = [self currentUID];
       /* Update Object UID */
       [self sp_checkUID:object];
-      /* Check change and prepare undo */
-      if (uid != [object uid])
-        [[[self undoManager] prepareWithInvocationTarget:object] setUID:uid];
-      if (luid != [self currentUID])
-        [[[self undoManager] prepareWithInvocationTarget:self] setCurrentUID:luid];
-      [[self undoManager] registerUndoWithTarget:self selector:@selector(removeObject:) object:object];
+      /* prepare undo (restore uids if changed) */
+      [[[self library] undoJournal] recordAddObject:object inSet:self uid:uid currentUID:luid];
     } 
     
       [self sp_addObject:object];
     
       // Did add object
+      [[[self library] notifiedObservers] didAddObject:object toSet:self];
       SparkLibraryPostNotification([self library], SparkObjectSetDidAddObjectNotification, self, object);
       return YES;
     }
@@ -224,15 +261,19 @@ NSComparator SparkObjectCompare = ^NSComparisonResult(SparkObject *obj1, SparkOb
 - (void)removeObject:(SparkObject *)object {
   if (object && [self containsObject:object]) {
     // Will remove
+    [[[self library] notifiedObservers] willRemoveObject:object fromSet:self];
     SparkLibraryPostNotification([self library], SparkObjectSetWillRemoveObjectNotification, self, object);
     
     /* Register undo => [self addObject:object]; */
-    [[self undoManager] registerUndoWithTarget:self selector:@selector(addObject:) object:object];
+    [[[self library] undoJournal] recordRemoveObject:object fromSet:self];
 
     // Remove
     object.library = nil;
-    [sp_objects removeObjectForKey:@(object.uid)];
+    if (sp_triggers && [object isKindOfClass:[SparkTrigger class]])
+      [self sp_unindexTrigger:[sp_objects objectForUID:object.uid]];
+    [sp_objects removeObjectForUID:object.uid];
     // Did remove
+    [[[self library] notifiedObservers] didRemoveObject:object fromSet:self];
     SparkLibraryPostNotification([self library], SparkObjectSetDidRemoveObjectNotification, self, object);
   }
 }
@@ -280,7 +321,18 @@ NSComparator SparkObjectCompare = ^NSComparisonResult(SparkObject *obj1, SparkOb
 }
 
 - (SparkObject *)deserialize:(NSDictionary *)plist error:(OSStatus *)error {
-  return WBDeserializeObject(plist, error);
+  OSStatus err = noErr;
+  SparkObject *object = WBDeserializeObject(plist, &err);
+  if (!object && kWBClassNotFoundError == err) {
+    /* action plugins are loaded on demand (main thread only, background loads preload them) */
+    NSString *name = plist[kWBSerializationClassKey];
+    SparkPlugIn *plugin = name ? [[SparkActionLoader sharedLoader] plugInForActionClassName:name] : nil;
+    if ([plugin load])
+      object = WBDeserializeObject(plist, &err);
+  }
+  if (error)
+    *error = err;
+  return object;
 }
 
 #define spx_error(condition, var, error) do { \
@@ -295,9 +347,10 @@ NSComparator SparkObjectCompare = ^NSComparisonResult(SparkObject *obj1, SparkOb
   spx_error(data, outError, [NSError errorWithDomain:NSPOSIXErrorDomain code:EINVAL userInfo:nil]);
   
   /* Remove all */
-  NSArray *values = [sp_objects allValues];
+  NSArray *values = [sp_objects allObjects];
   /* Reset map and uid */
   [sp_objects removeAllObjects];
+  sp_triggers = nil;
   
   /* reinsert reserved objects */
   for (SparkObject *sobject in values) {
@@ -24,6 +24,8 @@ SPARK_OBJC_EXPORT
 
 /* Return YES only if the two trigger are equivalents */
 - (BOOL)isEqualToTrigger:(SparkTrigger *)aTrigger;
+/* Equivalent triggers must return the same value (raw key for hotkeys) */
+- (NSUInteger)triggerHash;
 - (NSComparisonResult)compare:(SparkTrigger *)aTrigger;
 
 @end
@@ -72,6 +72,9 @@
 - (BOOL)isEqualToTrigger:(SparkTrigger *)aTrigger {
   return [self isEqual:aTrigger];
 }
+- (NSUInteger)triggerHash {
+  return [self hash];
+}
 
 - (void)bypass {
 }
@@ -0,0 +1,32 @@
+/*
+ *  SparkUIDTable.h
+ *  SparkKit
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+#import <SparkKit/SparkKit.h>
+
+/*
+ Objects indexed by uid.
+ Library uids are allocated densely, so objects are stored in an array of slots
+ and a lookup is an array access. Distant uids (corrupted or hand edited files)
+ are stored in a dictionary instead, so they do not grow the slot array.
+ */
+@interface SparkUIDTable : NSObject
+
+@property(nonatomic, readonly) NSUInteger count;
+
+- (id)objectForUID:(SparkUID)uid;
+/* object MUST not be nil */
+- (void)setObject:(id)object forUID:(SparkUID)uid;
+- (void)removeObjectForUID:(SparkUID)uid;
+- (void)removeAllObjects;
+
+/* ordered by uid */
+- (NSArray *)allObjects;
+/* the table may be mutated by block */
+- (void)enumerateObjectsUsingBlock:(void (^)(id obj, BOOL *stop))block;
+
+@end
@@ -0,0 +1,134 @@
+/*
+ *  SparkUIDTable.m
+ *  SparkKit
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+#import "SparkUIDTable.h"
+
+/* slots are always allocated up to this uid (reserved objects are below 256) */
+static const SparkUID kSparkUIDTableDenseLimit = 1 << 16;
+
+@implementation SparkUIDTable {
+@private
+  __strong id *sp_slots;
+  SparkUID sp_capacity;
+  NSUInteger sp_count;
+  /* uid => object, for uids too far to be stored in slots */
+  NSMutableDictionary *sp_sparse;
+}
+
+- (void)dealloc {
+  [self removeAllObjects];
+  free(sp_slots);
+}
+
+- (NSString *)description {
+  return [NSString stringWithFormat:@"<%@ %p> {Objects: %lu, Slots: %lu}",
+          [self class], self, (unsigned long)[self count], (unsigned long)sp_capacity];
+}
+
+- (NSUInteger)count {
+  return sp_count + [sp_sparse count];
+}
+
+#pragma mark Slots
+/* do not allocate a large array for a few distant uids */
+- (BOOL)sp_acceptsUID:(SparkUID)uid {
+  return uid < MAX(kSparkUIDTableDenseLimit, 8 * (sp_count + 1));
+}
+
+- (void)sp_growToUID:(SparkUID)uid {
+  SparkUID capacity = MAX(MAX(sp_capacity * 2, uid + 1), 64);
+  sp_slots = (__strong id *)reallocf(sp_slots, capacity * sizeof(id));
+  if (!sp_slots)
+    SPXThrowException(NSMallocException, @"failed to allocate %lu slots", (unsigned long)capacity);
+  bzero(sp_slots + sp_capacity, (capacity - sp_capacity) * sizeof(id));
+  sp_capacity = capacity;
+
+  /* move sparse objects that now fit in slots */
+  if ([sp_sparse count]) {
+    for (NSNumber *key in [sp_sparse allKeys]) {
+      SparkUID suid = (SparkUID)[key unsignedIntValue];
+      if (suid < sp_capacity) {
+        sp_slots[suid] = sp_sparse[key];
+        [sp_sparse removeObjectForKey:key];
+        sp_count++;
+      }
+    }
+  }
+}
+
+#pragma mark Accessors
+- (id)objectForUID:(SparkUID)uid {
+  if (uid < sp_capacity)
+    return sp_slots[uid];
+  return sp_sparse ? sp_sparse[@(uid)] : nil;
+}
+
+- (void)setObject:(id)object forUID:(SparkUID)uid {
+  NSParameterAssert(object);
+  if (uid >= sp_capacity && [self sp_acceptsUID:uid])
+    [self sp_growToUID:uid];
+
+  if (uid < sp_capacity) {
+    if (!sp_slots[uid])
+      sp_count++;
+    sp_slots[uid] = object;
+  } else {
+    if (!sp_sparse)
+      sp_sparse = [[NSMutableDictionary alloc] init];
+    sp_sparse[@(uid)] = object;
+  }
+}
+
+- (void)removeObjectForUID:(SparkUID)uid {
+  if (uid < sp_capacity) {
+    if (sp_slots[uid]) {
+      sp_slots[uid] = nil;
+      sp_count--;
+    }
+  } else {
+    [sp_sparse removeObjectForKey:@(uid)];
+  }
+}
+
+- (void)removeAllObjects {
+  for (SparkUID uid = 0; uid < sp_capacity; uid++)
+    sp_slots[uid] = nil;
+  sp_count = 0;
+  [sp_sparse removeAllObjects];
+}
+
+#pragma mark Enumeration
+- (NSArray *)allObjects {
+  NSMutableArray *objects = [[NSMutableArray alloc] initWithCapacity:[self count]];
+  [self enumerateObjectsUsingBlock:^(id obj, BOOL *stop) {
+    [objects addObject:obj];
+  }];
+  return objects;
+}
+
+- (void)enumerateObjectsUsingBlock:(void (^)(id obj, BOOL *stop))block {
+  BOOL stop = NO;
+  /* re-read the capacity, the block may add objects */
+  for (SparkUID uid = 0; uid < sp_capacity && !stop; uid++) {
+    id obj = sp_slots[uid];
+    if (obj)
+      block(obj, &stop);
+  }
+  if (!stop && [sp_sparse count]) {
+    NSArray *keys = [[sp_sparse allKeys] sortedArrayUsingSelector:@selector(compare:)];
+    for (NSNumber *key in keys) {
+      id obj = sp_sparse[key];
+      if (obj) {
+        block(obj, &stop);
+        if (stop) break;
+      }
+    }
+  }
+}
+
+@end
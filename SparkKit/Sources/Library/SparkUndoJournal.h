@@ -0,0 +1,58 @@
+/*
+ *  SparkUndoJournal.h
+ *  SparkKit
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+#import <SparkKit/SparkLibrary.h>
+
+@class SparkList, SparkEntry, SparkObject, SparkObjectSet;
+@class SparkAction, SparkTrigger, SparkApplication;
+
+/*
+ Undo history of a library.
+ Changes are stored as compact records (operation, uids and previous values) instead of
+ one NSInvocation per change. All the records of an undo group are stored in a single batch,
+ registered once in the library undo manager, and replayed in a single transaction.
+ Nothing is recorded if the library has no undo manager, or if undo registration is disabled.
+ */
+@interface SparkUndoJournal : NSObject
+
+- (instancetype)initWithLibrary:(SparkLibrary *)aLibrary;
+
+@property(nonatomic, readonly, weak) SparkLibrary *library;
+
+/* approximative memory used by the undo history. Oldest groups are dropped when exceeded. Default is 4 MB */
+@property(nonatomic) NSUInteger capacity;
+@property(nonatomic, readonly) NSUInteger size;
+
+/* Entry Manager */
+- (void)recordAddEntry:(SparkEntry *)anEntry;
+- (void)recordRemoveEntry:(SparkEntry *)anEntry parent:(SparkEntry *)aParent;
+- (void)recordRemoveChildren:(NSArray *)children ofEntry:(SparkEntry *)anEntry;
+/* previous values, nil if unchanged */
+- (void)recordUpdateEntry:(SparkEntry *)anEntry action:(SparkAction *)anAction
+                  trigger:(SparkTrigger *)aTrigger application:(SparkApplication *)anApplication;
+/* consecutive status changes of an entry are coalesced */
+- (void)recordEntry:(SparkEntry *)anEntry enabled:(BOOL)previous;
+- (void)recordEntry:(SparkEntry *)anEntry name:(NSString *)previous;
+
+/* Object Sets */
+- (void)recordAddObject:(SparkObject *)anObject inSet:(SparkObjectSet *)aSet
+                    uid:(SparkUID)previousUID currentUID:(SparkUID)previousCurrentUID;
+- (void)recordRemoveObject:(SparkObject *)anObject fromSet:(SparkObjectSet *)aSet;
+
+/* Lists */
+- (void)recordList:(SparkList *)aList insertEntries:(NSArray *)entries;
+- (void)recordList:(SparkList *)aList removeEntries:(NSArray *)entries;
+- (void)recordList:(SparkList *)aList insertEntryAtIndex:(NSUInteger)idx;
+- (void)recordList:(SparkList *)aList removeEntry:(SparkEntry *)anEntry atIndex:(NSUInteger)idx;
+- (void)recordList:(SparkList *)aList replaceEntry:(SparkEntry *)anEntry atIndex:(NSUInteger)idx;
+
+@end
+
+@interface SparkLibrary (SparkUndoJournal)
+- (SparkUndoJournal *)undoJournal;
+@end
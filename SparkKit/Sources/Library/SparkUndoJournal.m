@@ -0,0 +1,447 @@
+/*
+ *  SparkUndoJournal.m
+ *  SparkKit
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+#import "SparkUndoJournal.h"
+
+#import <SparkKit/SparkList.h>
+#import <SparkKit/SparkEntry.h>
+#import <SparkKit/SparkPrivate.h>
+#import <SparkKit/SparkObjectSet.h>
+#import <SparkKit/SparkEntryManager.h>
+
+#import "SparkEntryPrivate.h"
+#import "SparkLibraryPrivate.h"
+#import "SparkEntryManagerPrivate.h"
+
+enum {
+  kSparkUndoAddEntry,
+  kSparkUndoRemoveEntry,
+  kSparkUndoRemoveChildren,
+  kSparkUndoUpdateEntry,
+  kSparkUndoEnableEntry,
+  kSparkUndoRenameEntry,
+
+  kSparkUndoAddObject,
+  kSparkUndoRemoveObject,
+
+  kSparkUndoListInsertEntries,
+  kSparkUndoListRemoveEntries,
+  kSparkUndoListInsertEntry,
+  kSparkUndoListRemoveEntry,
+  kSparkUndoListReplaceEntry,
+};
+
+enum {
+  /* update entry */
+  kSparkUndoActionChanged = 1 << 0,
+  kSparkUndoTriggerChanged = 1 << 1,
+  kSparkUndoApplicationChanged = 1 << 2,
+  /* add object */
+  kSparkUndoUIDChanged = 1 << 0,
+  kSparkUndoCurrentUIDChanged = 1 << 1,
+  /* remove entry */
+  kSparkUndoHasParent = 1 << 0,
+};
+
+#define kSparkUndoNoObject UINT32_MAX
+
+/* 24 bytes per change, objects are only retained when they are removed from the library */
+typedef struct _SparkUndoRecord {
+  uint8_t op;
+  uint8_t set;
+  uint16_t flags;
+  /* index in the batch objects */
+  uint32_t object;
+  /* entry, object or list */
+  SparkUID uid;
+  /* previous values */
+  SparkUID values[3];
+} SparkUndoRecord;
+
+/* Records of an undo group */
+@interface SparkUndoBatch : NSObject {
+@public
+  __weak SparkUndoJournal *sp_journal;
+  NSMutableData *sp_records;
+  NSMutableArray *sp_objects;
+  /* entries toggled since the last structural change */
+  NSMutableIndexSet *sp_toggles;
+}
+
+- (void)replay:(SparkUndoBatch *)aBatch;
+
+@end
+
+@interface SparkUndoJournal ()
+- (void)replayBatch:(SparkUndoBatch *)aBatch;
+@end
+
+@implementation SparkUndoBatch
+
+- (instancetype)initWithJournal:(SparkUndoJournal *)aJournal {
+  if (self = [super init]) {
+    sp_journal = aJournal;
+    sp_records = [[NSMutableData alloc] init];
+  }
+  return self;
+}
+
+- (NSUInteger)count {
+  return [sp_records length] / sizeof(SparkUndoRecord);
+}
+
+- (NSUInteger)size {
+  /* approximation of the retained objects cost */
+  return 64 + [sp_records length] + [sp_objects count] * 48;
+}
+
+- (uint32_t)addObject:(id)anObject {
+  if (!anObject)
+    return kSparkUndoNoObject;
+  if (!sp_objects)
+    sp_objects = [[NSMutableArray alloc] init];
+  [sp_objects addObject:anObject];
+  return (uint32_t)[sp_objects count] - 1;
+}
+
+- (id)objectAtIndex:(uint32_t)idx {
+  return kSparkUndoNoObject == idx ? nil : sp_objects[idx];
+}
+
+- (void)replay:(SparkUndoBatch *)aBatch {
+  [sp_journal replayBatch:self];
+}
+
+@end
+
+@implementation SparkUndoJournal {
+@private
+  __weak NSUndoManager *sp_manager;
+  /* batch of the current undo group */
+  SparkUndoBatch *sp_current;
+  /* registered batches, oldest first */
+  NSPointerArray *sp_batches;
+}
+
+- (instancetype)initWithLibrary:(SparkLibrary *)aLibrary {
+  if (self = [super init]) {
+    _library = aLibrary;
+    _capacity = 4 * 1024 * 1024;
+    sp_batches = [NSPointerArray weakObjectsPointerArray];
+  }
+  return self;
+}
+
+- (void)dealloc {
+  [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+#pragma mark Undo Manager
+- (void)groupDidChange:(NSNotification *)aNotification {
+  sp_current = nil;
+}
+
+- (void)setUndoManager:(NSUndoManager *)aManager {
+  NSNotificationCenter *center = [NSNotificationCenter defaultCenter];
+  if (sp_manager)
+    [center removeObserver:self name:nil object:sp_manager];
+
+  sp_manager = aManager;
+  sp_current = nil;
+  [sp_batches setCount:0];
+
+  if (aManager) {
+    for (NSString *name in @[NSUndoManagerDidCloseUndoGroupNotification,
+                             NSUndoManagerWillUndoChangeNotification, NSUndoManagerDidUndoChangeNotification,
+                             NSUndoManagerWillRedoChangeNotification, NSUndoManagerDidRedoChangeNotification]) {
+      [center addObserver:self selector:@selector(groupDidChange:) name:name object:aManager];
+    }
+  }
+}
+
+- (NSUInteger)size {
+  NSUInteger size = 0;
+  for (SparkUndoBatch *batch in sp_batches)
+    size += [batch size];
+  return size;
+}
+
+/* drop the oldest groups until the history fits in capacity */
+- (void)trimHistory:(NSUndoManager *)undo {
+  NSPointerArray *batches = [NSPointerArray weakObjectsPointerArray];
+  NSUInteger size = 0;
+  for (SparkUndoBatch *batch in sp_batches) {
+    if (batch) {
+      [batches addPointer:(__bridge void *)batch];
+      size += [batch size];
+    }
+  }
+  NSUInteger count = [batches count], idx = 0;
+  while (size > _capacity && idx < count) {
+    SparkUndoBatch *batch = [batches pointerAtIndex:idx++];
+    if (batch && batch != sp_current) {
+      size -= [batch size];
+      [undo removeAllActionsWithTarget:batch];
+    }
+  }
+  sp_batches = batches;
+}
+
+- (SparkUndoBatch *)currentBatch {
+  NSUndoManager *undo = [_library undoManager];
+  if (undo != sp_manager)
+    [self setUndoManager:undo];
+  if (!undo || ![undo isUndoRegistrationEnabled])
+    return nil;
+
+  if (!sp_current) {
+    [self trimHistory:undo];
+    sp_current = [[SparkUndoBatch alloc] initWithJournal:self];
+    [sp_batches addPointer:(__bridge void *)sp_current];
+    /* the batch is retained by the undo manager */
+    [undo registerUndoWithTarget:sp_current selector:@selector(replay:) object:sp_current];
+  }
+  return sp_current;
+}
+
+SPARK_INLINE
+void SparkUndoAppend(SparkUndoBatch *batch, SparkUndoRecord record) {
+  [batch->sp_records appendBytes:&record length:sizeof(record)];
+  /* toggles can no longer be merged across a structural change */
+  if (record.op != kSparkUndoEnableEntry)
+    [batch->sp_toggles removeAllIndexes];
+}
+
+- (uint8_t)kindOfSet:(SparkObjectSet *)aSet {
+  if (aSet == [_library listSet]) return kSparkListSet;
+  if (aSet == [_library actionSet]) return kSparkActionSet;
+  if (aSet == [_library triggerSet]) return kSparkTriggerSet;
+  NSAssert(aSet == [_library applicationSet], @"set does not belong to the library");
+  return kSparkApplicationSet;
+}
+
+- (SparkObjectSet *)setOfKind:(uint8_t)kind {
+  switch (kind) {
+    case kSparkListSet: return [_library listSet];
+    case kSparkActionSet: return [_library actionSet];
+    case kSparkTriggerSet: return [_library triggerSet];
+    case kSparkApplicationSet: return [_library applicationSet];
+  }
+  return nil;
+}
+
+#pragma mark Entry Manager
+- (void)recordAddEntry:(SparkEntry *)anEntry {
+  SparkUndoBatch *batch = [self currentBatch];
+  if (batch)
+    SparkUndoAppend(batch, (SparkUndoRecord){ .op = kSparkUndoAddEntry, .uid = [anEntry uid], .object = kSparkUndoNoObject });
+}
+
+- (void)recordRemoveEntry:(SparkEntry *)anEntry parent:(SparkEntry *)aParent {
+  SparkUndoBatch *batch = [self currentBatch];
+  if (batch) {
+    SparkUndoRecord record = { .op = kSparkUndoRemoveEntry, .uid = [anEntry uid] };
+    record.object = [batch addObject:anEntry];
+    if (aParent) {
+      /* parent follows the entry */
+      record.flags = kSparkUndoHasParent;
+      [batch addObject:aParent];
+    }
+    SparkUndoAppend(batch, record);
+  }
+}
+
+- (void)recordRemoveChildren:(NSArray *)children ofEntry:(SparkEntry *)anEntry {
+  SparkUndoBatch *batch = [self currentBatch];
+  if (batch) {
+    /* the entry is no longer managed when replaying, so keep it next to its children */
+    SparkUndoRecord record = { .op = kSparkUndoRemoveChildren, .uid = [anEntry uid] };
+    record.object = [batch addObject:anEntry];
+    [batch addObject:[children copy]];
+    SparkUndoAppend(batch, record);
+  }
+}
+
+- (void)recordUpdateEntry:(SparkEntry *)anEntry action:(SparkAction *)anAction
+                  trigger:(SparkTrigger *)aTrigger application:(SparkApplication *)anApplication {
+  SparkUndoBatch *batch = [self currentBatch];
+  if (batch) {
+    SparkUndoRecord record = { .op = kSparkUndoUpdateEntry, .uid = [anEntry uid], .object = kSparkUndoNoObject };
+    if (anAction) {
+      record.flags |= kSparkUndoActionChanged;
+      record.values[0] = [anAction uid];
+    }
+    if (aTrigger) {
+      record.flags |= kSparkUndoTriggerChanged;
+      record.values[1] = [aTrigger uid];
+    }
+    if (anApplication) {
+      record.flags |= kSparkUndoApplicationChanged;
+      record.values[2] = [anApplication uid];
+    }
+    SparkUndoAppend(batch, record);
+  }
+}
+
+- (void)recordEntry:(SparkEntry *)anEntry enabled:(BOOL)previous {
+  SparkUndoBatch *batch = [self currentBatch];
+  if (batch) {
+    if (!batch->sp_toggles)
+      batch->sp_toggles = [[NSMutableIndexSet alloc] init];
+    /* the first record already restores the original status */
+    if ([batch->sp_toggles containsIndex:[anEntry uid]])
+      return;
+    [batch->sp_toggles addIndex:[anEntry uid]];
+    SparkUndoAppend(batch, (SparkUndoRecord){ .op = kSparkUndoEnableEntry, .uid = [anEntry uid],
+      .object = kSparkUndoNoObject, .values = { previous } });
+  }
+}
+
+- (void)recordEntry:(SparkEntry *)anEntry name:(NSString *)previous {
+  SparkUndoBatch *batch = [self currentBatch];
+  if (batch)
+    SparkUndoAppend(batch, (SparkUndoRecord){ .op = kSparkUndoRenameEntry, .uid = [anEntry uid],
+      .object = [batch addObject:[previous copy]] });
+}
+
+#pragma mark Object Sets
+- (void)recordAddObject:(SparkObject *)anObject inSet:(SparkObjectSet *)aSet
+                    uid:(SparkUID)previousUID currentUID:(SparkUID)previousCurrentUID {
+  SparkUndoBatch *batch = [self currentBatch];
+  if (batch) {
+    SparkUndoRecord record = { .op = kSparkUndoAddObject, .set = [self kindOfSet:aSet],
+      .uid = [anObject uid], .object = kSparkUndoNoObject };
+    if (previousUID != [anObject uid]) {
+      record.flags |= kSparkUndoUIDChanged;
+      record.values[0] = previousUID;
+    }
+    if (previousCurrentUID != [aSet currentUID]) {
+      record.flags |= kSparkUndoCurrentUIDChanged;
+      record.values[1] = previousCurrentUID;
+    }
+    SparkUndoAppend(batch, record);
+  }
+}
+
+- (void)recordRemoveObject:(SparkObject *)anObject fromSet:(SparkObjectSet *)aSet {
+  SparkUndoBatch *batch = [self currentBatch];
+  if (batch)
+    SparkUndoAppend(batch, (SparkUndoRecord){ .op = kSparkUndoRemoveObject, .set = [self kindOfSet:aSet],
+      .uid = [anObject uid], .object = [batch addObject:anObject] });
+}
+
+#pragma mark Lists
+- (void)recordList:(SparkList *)aList op:(uint8_t)op object:(id)anObject index:(NSUInteger)idx {
+  SparkUndoBatch *batch = [self currentBatch];
+  if (batch) {
+    NSParameterAssert(idx <= UINT32_MAX);
+    SparkUndoAppend(batch, (SparkUndoRecord){ .op = op, .uid = [aList uid],
+      .object = [batch addObject:anObject], .values = { (SparkUID)idx } });
+  }
+}
+
+- (void)recordList:(SparkList *)aList insertEntries:(NSArray *)entries {
+  [self recordList:aList op:kSparkUndoListInsertEntries object:entries index:0];
+}
+- (void)recordList:(SparkList *)aList removeEntries:(NSArray *)entries {
+  [self recordList:aList op:kSparkUndoListRemoveEntries object:entries index:0];
+}
+
+- (void)recordList:(SparkList *)aList insertEntryAtIndex:(NSUInteger)idx {
+  [self recordList:aList op:kSparkUndoListInsertEntry object:nil index:idx];
+}
+- (void)recordList:(SparkList *)aList removeEntry:(SparkEntry *)anEntry atIndex:(NSUInteger)idx {
+  [self recordList:aList op:kSparkUndoListRemoveEntry object:anEntry index:idx];
+}
+- (void)recordList:(SparkList *)aList replaceEntry:(SparkEntry *)anEntry atIndex:(NSUInteger)idx {
+  [self recordList:aList op:kSparkUndoListReplaceEntry object:anEntry index:idx];
+}
+
+#pragma mark Replay
+- (void)replayRecord:(const SparkUndoRecord *)record batch:(SparkUndoBatch *)batch {
+  SparkEntryManager *manager = [_library entryManager];
+  switch (record->op) {
+    case kSparkUndoAddEntry:
+      [manager removeEntry:[manager entryWithUID:record->uid]];
+      break;
+    case kSparkUndoRemoveEntry: {
+      SparkEntry *parent = (record->flags & kSparkUndoHasParent) ? [batch objectAtIndex:record->object + 1] : nil;
+      [manager addEntry:[batch objectAtIndex:record->object] parent:parent];
+    }
+      break;
+    case kSparkUndoRemoveChildren:
+      [[batch objectAtIndex:record->object] addChildrenFromArray:[batch objectAtIndex:record->object + 1]];
+      break;
+    case kSparkUndoUpdateEntry: {
+      SparkEntry *entry = [manager entryWithUID:record->uid];
+      /* orphans removed by the update are already restored */
+      [manager updateEntry:entry
+                 setAction:(record->flags & kSparkUndoActionChanged) ? [_library actionWithUID:record->values[0]] : nil
+                   trigger:(record->flags & kSparkUndoTriggerChanged) ? [_library triggerWithUID:record->values[1]] : nil
+               application:(record->flags & kSparkUndoApplicationChanged) ? [_library applicationWithUID:record->values[2]] : nil];
+    }
+      break;
+    case kSparkUndoEnableEntry:
+      [[manager entryWithUID:record->uid] setEnabled:record->values[0] != 0];
+      break;
+    case kSparkUndoRenameEntry:
+      /* KVC to notify the entry observers */
+      [[manager entryWithUID:record->uid] setValue:[batch objectAtIndex:record->object] forKey:@"representation"];
+      break;
+
+    case kSparkUndoAddObject: {
+      SparkObjectSet *set = [self setOfKind:record->set];
+      SparkObject *object = [set objectWithUID:record->uid];
+      [set removeObject:object];
+      if (record->flags & kSparkUndoCurrentUIDChanged)
+        [set setCurrentUID:record->values[1]];
+      if (record->flags & kSparkUndoUIDChanged)
+        [object setUID:record->values[0]];
+    }
+      break;
+    case kSparkUndoRemoveObject:
+      [[self setOfKind:record->set] addObject:[batch objectAtIndex:record->object]];
+      break;
+
+    case kSparkUndoListInsertEntries:
+      [[_library listWithUID:record->uid] removeEntriesInArray:[batch objectAtIndex:record->object]];
+      break;
+    case kSparkUndoListRemoveEntries:
+      [[_library listWithUID:record->uid] addEntriesFromArray:[batch objectAtIndex:record->object]];
+      break;
+    case kSparkUndoListInsertEntry:
+      [[_library listWithUID:record->uid] removeObjectFromEntriesAtIndex:record->values[0]];
+      break;
+    case kSparkUndoListRemoveEntry:
+      [[_library listWithUID:record->uid] insertObject:[batch objectAtIndex:record->object] inEntriesAtIndex:record->values[0]];
+      break;
+    case kSparkUndoListReplaceEntry:
+      [[_library listWithUID:record->uid] replaceObjectInEntriesAtIndex:record->values[0]
+                                                             withObject:[batch objectAtIndex:record->object]];
+      break;
+  }
+}
+
+- (void)replayBatch:(SparkUndoBatch *)aBatch {
+  if (!_library)
+    return;
+
+  SPXDebug(@"Replay %lu undo records", (unsigned long)[aBatch count]);
+  /* observers process the whole group at once */
+  [_library beginTransaction];
+  @try {
+    const SparkUndoRecord *records = [aBatch->sp_records bytes];
+    NSUInteger count = [aBatch count];
+    while (count-- > 0)
+      [self replayRecord:&records[count] batch:aBatch];
+  } @finally {
+    [_library commitTransaction];
+  }
+}
+
+@end
@@ -20,6 +20,8 @@ NSString * const SparkActionLoaderDidRegisterPlugInNotification;
 
 /*!
 @abstract Action extension is "spact".
+@discussion Plugins found in the manifest cache are registered without loading their code.
+ A plugin is loaded when a library contains one of its actions, or when its class is requested.
 */
 SPARK_OBJC_EXPORT
 @interface SparkActionLoader : WBPlugInLoader
@@ -31,5 +33,7 @@ SPARK_OBJC_EXPORT
 
 - (SparkPlugIn *)plugInForAction:(SparkAction *)action;
 - (SparkPlugIn *)plugInForActionClass:(Class)cls;
+/* does not load the plugin */
+- (SparkPlugIn *)plugInForActionClassName:(NSString *)name;
 
 @end
@@ -13,17 +13,77 @@
 #import <SparkKit/SparkPlugIn.h>
 #import <SparkKit/SparkActionPlugIn.h>
 
+#import <os/lock.h>
+#import <objc/runtime.h>
+
 NSString * const SparkActionLoaderDidRegisterPlugInNotification = @"SparkActionLoaderDidRegisterPlugIn";
 
-@implementation SparkActionLoader
+@implementation SparkActionLoader {
+@private
+  /* action class => plugin (or NSNull), subclasses are added on first query */
+  NSMapTable *sp_classes;
+  /* bumped each time the cache is invalidated */
+  NSUInteger sp_generation;
+  os_unfair_lock sp_lock;
+
+  /* bundle path => manifest entry, only valid while loading plugins */
+  NSDictionary *sp_manifest;
+  NSMutableDictionary *sp_found;
+}
+
+/* Manifest entry keys */
+static NSString * const kSparkActionLoaderDateKey = @"Date";
+static NSString * const kSparkActionLoaderPlugInKey = @"PlugIn";
+
+static
+NSURL *SparkActionLoaderManifestURL(void) {
+  NSURL *caches = [[NSFileManager defaultManager] URLForDirectory:NSCachesDirectory inDomain:NSUserDomainMask
+                                                appropriateForURL:nil create:YES error:NULL];
+  return [[caches URLByAppendingPathComponent:kSparkKitBundleIdentifier isDirectory:YES]
+          URLByAppendingPathComponent:@"PlugIns.plist" isDirectory:NO];
+}
+
+static
+NSNumber *SparkBundleModificationDate(NSBundle *bundle) {
+  NSDate *date = nil;
+  /* a plugin update replaces the bundle, but also check the property list for in place edits */
+  if (![bundle.bundleURL getResourceValue:&date forKey:NSURLContentModificationDateKey error:NULL] || !date)
+    return nil;
+  NSDate *info = nil;
+  NSURL *plist = [bundle.bundleURL URLByAppendingPathComponent:@"Contents/Info.plist" isDirectory:NO];
+  if ([plist getResourceValue:&info forKey:NSURLContentModificationDateKey error:NULL] && info)
+    date = [date laterDate:info];
+  return @([date timeIntervalSinceReferenceDate]);
+}
+
+WB_INLINE
+bool SparkClassIsKindOfClassNamed(Class cls, NSString *name) {
+  for (Class c = cls; c; c = class_getSuperclass(c)) {
+    if ([name isEqualToString:NSStringFromClass(c)])
+      return true;
+  }
+  return false;
+}
 
 + (SparkActionLoader *)sharedLoader {
   static SparkActionLoader *loader = nil;
-  if (!loader) 
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
     loader = [[self alloc] init];
+  });
   return loader;
 }
 
+- (id)init {
+  if (self = [super init]) {
+    sp_lock = OS_UNFAIR_LOCK_INIT;
+    sp_classes = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsOpaquePersonality
+                                           valueOptions:NSPointerFunctionsStrongMemory
+                                               capacity:0];
+  }
+  return self;
+}
+
 - (NSString *)extension {
   return @"spact";
 }
@@ -54,13 +114,45 @@ NSString * const SparkActionLoaderDidRegisterPlugInNotification = @"SparkActionL
 
 - (id)createPlugInForBundle:(NSBundle *)bundle {
   SparkPlugIn *plug = nil;
-  Class principalClass = [bundle principalClass];
-  if (principalClass && [self isValidPlugIn:principalClass]) {
-    plug = [[SparkPlugIn alloc] initWithBundle:bundle];
+  NSNumber *date = sp_found ? SparkBundleModificationDate(bundle) : nil;
+  if (date) {
+    /* unchanged bundle: register it without loading its code */
+    NSDictionary *entry = sp_manifest[bundle.bundlePath];
+    if ([entry[kSparkActionLoaderDateKey] isEqual:date])
+      plug = [[SparkPlugIn alloc] initWithURL:bundle.bundleURL manifest:entry[kSparkActionLoaderPlugInKey]];
   }
+
+  if (!plug) {
+    Class principalClass = [bundle principalClass];
+    if (principalClass && [self isValidPlugIn:principalClass]) {
+      plug = [[SparkPlugIn alloc] initWithBundle:bundle];
+    }
+  }
+
+  if (plug && date)
+    sp_found[bundle.bundlePath] = @{ kSparkActionLoaderDateKey: date, kSparkActionLoaderPlugInKey: [plug manifest] };
   return plug;
 }
 
+- (void)loadPlugIns {
+  NSURL *url = SparkActionLoaderManifestURL();
+  sp_manifest = [NSDictionary dictionaryWithContentsOfURL:url];
+  sp_found = [[NSMutableDictionary alloc] init];
+
+  [super loadPlugIns];
+
+  /* also drop removed plugins */
+  if (![sp_found isEqualToDictionary:sp_manifest ? : @{}]) {
+    NSData *data = [NSPropertyListSerialization dataWithPropertyList:sp_found format:NSPropertyListBinaryFormat_v1_0 options:0 error:NULL];
+    [[NSFileManager defaultManager] createDirectoryAtURL:[url URLByDeletingLastPathComponent]
+                             withIntermediateDirectories:YES attributes:nil error:NULL];
+    if (![data writeToURL:url atomically:YES])
+      SPXLogWarning(@"Failed to save plugin manifest at %@", url);
+  }
+  sp_manifest = nil;
+  sp_found = nil;
+}
+
 - (WBPlugInBundle *)resolveConflict:(NSArray *)plugins {
   for (WBPlugInBundle *entry in plugins) {
     /* prefere built in version, else don't care */
@@ -72,11 +164,44 @@ NSString * const SparkActionLoaderDidRegisterPlugInNotification = @"SparkActionL
 }
 
 #pragma mark -
+- (void)invalidateClassCache {
+  os_unfair_lock_lock(&sp_lock);
+  [sp_classes removeAllObjects];
+  sp_generation++;
+  os_unfair_lock_unlock(&sp_lock);
+}
+
 - (SparkPlugIn *)plugInForActionClass:(Class)cls {
+  if (!cls) return nil;
+
+  os_unfair_lock_lock(&sp_lock);
+  id plugin = (__bridge id)NSMapGet(sp_classes, (__bridge void *)cls);
+  NSUInteger generation = sp_generation;
+  os_unfair_lock_unlock(&sp_lock);
+  if (plugin)
+    return plugin != [NSNull null] ? plugin : nil;
+
+  /* slow path: resolve outside of the lock, as -plugIns may load plugins.
+   Do not load plugins code to check their class. */
+  for (SparkPlugIn *candidate in [self plugIns]) {
+    if (candidate.loaded ? [cls isSubclassOfClass:[candidate actionClass]] : SparkClassIsKindOfClassNamed(cls, candidate.actionClassName)) {
+      plugin = candidate;
+      break;
+    }
+  }
+
+  os_unfair_lock_lock(&sp_lock);
+  /* do not cache a stale result if a plugin was registered meanwhile */
+  if (generation == sp_generation)
+    NSMapInsert(sp_classes, (__bridge void *)cls, (__bridge void *)(plugin ? : [NSNull null]));
+  os_unfair_lock_unlock(&sp_lock);
+  return plugin;
+}
+
+- (SparkPlugIn *)plugInForActionClassName:(NSString *)name {
   for (SparkPlugIn *plugin in [self plugIns]) {
-    if ([cls isSubclassOfClass:[plugin actionClass]]) {
+    if ([name isEqualToString:plugin.actionClassName])
       return plugin;
-    }
   }
   return nil;
 }
@@ -85,6 +210,11 @@ NSString * const SparkActionLoaderDidRegisterPlugInNotification = @"SparkActionL
   return [self plugInForActionClass:[action class]];
 }
 
+- (void)registerPlugIn:(id)plugin withIdentifier:(NSString *)identifier {
+  [super registerPlugIn:plugin withIdentifier:identifier];
+  [self invalidateClassCache];
+}
+
 - (SparkPlugIn *)registerPlugInClass:(Class)aClass {
   if ([self isValidPlugIn:aClass]) {
     SparkPlugIn *plugin = [[SparkPlugIn alloc] initWithClass:aClass identifier:[aClass identifier]];
@@ -98,6 +228,7 @@ NSString * const SparkActionLoaderDidRegisterPlugInNotification = @"SparkActionL
 - (id)loadPlugIn:(NSBundle *)aBundle {
   SparkPlugIn *plugin = [super loadPlugIn:aBundle];
   if (plugin) {
+    [self invalidateClassCache];
     [[NSNotificationCenter defaultCenter] postNotificationName:SparkActionLoaderDidRegisterPlugInNotification
                                                         object:plugin];
   }
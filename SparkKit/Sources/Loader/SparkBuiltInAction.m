@@ -15,6 +15,7 @@
 #import <SparkKit/SparkObjectSet.h>
 #import <SparkKit/SparkFunctions.h>
 #import <SparkKit/SparkEntryManager.h>
+#import <SparkKit/SparkExecutionContext.h>
 
 #import <WonderBox/WBFunctions.h>
 #import <WonderBox/WBAEFunctions.h>
@@ -270,7 +271,12 @@ void SparkSDActionToggleDaemonStatus(void) {
   err = WBAEAddPropertyObjectSpecifier(&aevt, keyDirectObject, typeBoolean, 'pSta', NULL);
   spx_require_noerr(err, bail);
 
-  err = WBAESendEventReturnBoolean(&aevt, &status);
+  /* bounded by the execution deadline */
+  AppleEvent reply = WBAEEmptyDesc();
+  err = SparkAESendEvent(&aevt, &reply);
+  if (noErr == err)
+    err = AEGetParamPtr(&reply, keyDirectObject, typeBoolean, NULL, &status, sizeof(status), NULL);
+  WBAEDisposeDesc(&reply);
   spx_require_noerr(err, bail);
   WBAEDisposeDesc(&aevt);
 
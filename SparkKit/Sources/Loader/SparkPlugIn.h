@@ -24,6 +24,9 @@ SPARK_OBJC_EXPORT
 /* Designated */
 - (instancetype)initWithClass:(Class)cls identifier:(NSString *)identifier;
 
+/* Does not load the bundle code. See -load */
+- (instancetype)initWithURL:(NSURL *)url manifest:(NSDictionary *)manifest;
+
 /*! localized name of this PlugIn. */
 @property(nonatomic, copy) NSString *name;
 
@@ -42,13 +45,24 @@ SPARK_OBJC_EXPORT
 @property(nonatomic, readonly) NSURL *sdefURL;
 
 
+/*! plugin and action classes. Nil until the plugin code is loaded (see -load). */
 @property(nonatomic, readonly) Class plugInClass;
 /*! Action Class provided by this plugin. */
 @property(nonatomic, readonly) Class actionClass;
+/*! Available without loading the plugin code. */
+@property(nonatomic, readonly) NSString *actionClassName;
+
+/*! NO until the plugin code is loaded */
+@property(nonatomic, readonly, getter=isLoaded) BOOL loaded;
+/*! Loads the plugin code. This is the only method that does. MUST be called on the main thread. */
+- (BOOL)load;
+
+/*! values required to create this plugin without loading it */
+- (NSDictionary *)manifest;
 
 /*!
   @method
- @abstract Returns a new plugin instance.
+ @abstract Returns a new plugin instance. Loads the plugin code if needed.
 */
 - (SparkActionPlugIn *)instantiatePlugIn;
 
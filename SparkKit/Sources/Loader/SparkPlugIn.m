@@ -14,9 +14,25 @@
 
 #import "SparkPrivate.h"
 
+#import <WonderBox/NSImage+WonderBox.h>
+
 NSString * const SparkPlugInDidChangeStatusNotification = @"SparkPlugInDidChangeStatus";
 
-@implementation SparkPlugIn
+/* Manifest keys */
+static NSString * const kSparkPlugInManifestNameKey = @"Name";
+static NSString * const kSparkPlugInManifestVersionKey = @"Version";
+static NSString * const kSparkPlugInManifestEnabledKey = @"Enabled";
+static NSString * const kSparkPlugInManifestIdentifierKey = @"Identifier";
+static NSString * const kSparkPlugInManifestActionClassKey = @"ActionClass";
+
+@implementation SparkPlugIn {
+@private
+  NSString *sp_actionClass;
+  /* default status */
+  BOOL sp_enabled;
+}
+
+@synthesize plugInClass = _plugInClass;
 
 /* Check status */
 static 
@@ -105,12 +121,36 @@ void SparkPlugInSetEnabled(NSString *identifier, BOOL enabled) {
     [self setVersion:[cls versionString]];
     
     /* Set status */
+    sp_enabled = [_plugInClass isEnabled];
     BOOL exists;
     BOOL status = SparkPlugInIsEnabled(identifier, &exists);
     if (exists)
       _enabled = status;
     else
-      _enabled = [_plugInClass isEnabled];
+      _enabled = sp_enabled;
+  }
+  return self;
+}
+
+- (instancetype)initWithURL:(NSURL *)url manifest:(NSDictionary *)manifest {
+  NSString *identifier = manifest[kSparkPlugInManifestIdentifierKey];
+  NSString *actionClass = manifest[kSparkPlugInManifestActionClassKey];
+  if (!url || !identifier || !actionClass) {
+    SPXDebug(@"Invalid plugin manifest: %@", manifest);
+    return nil;
+  }
+
+  if (self = [super init]) {
+    _URL = url;
+    _identifier = [identifier copy];
+    _name = [manifest[kSparkPlugInManifestNameKey] copy];
+    _version = [manifest[kSparkPlugInManifestVersionKey] copy];
+    sp_actionClass = [actionClass copy];
+
+    sp_enabled = [manifest[kSparkPlugInManifestEnabledKey] boolValue];
+    BOOL exists;
+    BOOL status = SparkPlugInIsEnabled(identifier, &exists);
+    _enabled = exists ? status : sp_enabled;
   }
   return self;
 }
@@ -140,21 +180,84 @@ void SparkPlugInSetEnabled(NSString *identifier, BOOL enabled) {
 - (NSString *)description {
   return [NSString stringWithFormat:@"<%@ %p> {Name: %@, Class: %@, Status: %@}",
     [self class], self,
-    [self name], _plugInClass,
+    [self name], _plugInClass ? NSStringFromClass(_plugInClass) : @"<not loaded>",
     ([self isEnabled] ? @"On" : @"Off")];
 }
 
 #pragma mark -
+- (BOOL)isLoaded {
+  return _plugInClass != nil;
+}
+
+- (BOOL)load {
+  if (_plugInClass)
+    return YES;
+  /* bundle code (+load, +initialize, nib) expects the main thread.
+   Libraries loaded in background load their plugins before reading the actions (see -[SparkLibrary loadInGroup:]) */
+  if (![NSThread isMainThread]) {
+    SPXLogWarning(@"Plugin %@ can only be loaded on the main thread", _identifier);
+    return NO;
+  }
+  @synchronized(self) {
+    if (_plugInClass)
+      return YES;
+
+    NSError *error = nil;
+    NSBundle *bundle = _URL ? [NSBundle bundleWithURL:_URL] : nil;
+    if (![bundle loadAndReturnError:&error]) {
+      SPXLogWarning(@"Failed to load plugin %@: %@", _URL, error);
+      return NO;
+    }
+    Class cls = [bundle principalClass];
+    if (![cls isSubclassOfClass:[SparkActionPlugIn class]] || ![sp_actionClass isEqualToString:NSStringFromClass([cls actionClass])]) {
+      SPXLogWarning(@"Plugin %@ does not match its manifest", _URL);
+      return NO;
+    }
+    SPXDebug(@"Load plugin: %@", _identifier);
+    _plugInClass = cls;
+  }
+  return YES;
+}
+
+- (NSString *)actionClassName {
+  if (!sp_actionClass && _plugInClass)
+    sp_actionClass = NSStringFromClass([_plugInClass actionClass]);
+  return sp_actionClass;
+}
+
+- (NSDictionary *)manifest {
+  NSMutableDictionary *manifest = [[NSMutableDictionary alloc] init];
+  manifest[kSparkPlugInManifestIdentifierKey] = _identifier;
+  manifest[kSparkPlugInManifestEnabledKey] = @(sp_enabled);
+  if (self.actionClassName)
+    manifest[kSparkPlugInManifestActionClassKey] = self.actionClassName;
+  if (self.name)
+    manifest[kSparkPlugInManifestNameKey] = self.name;
+  if (self.version)
+    manifest[kSparkPlugInManifestVersionKey] = self.version;
+  return manifest;
+}
+
+/* Unloaded plugins are described using their bundle resources (see SparkActionPlugIn) */
 - (NSString *)name {
   if (_name == nil) {
-    self.name = [_plugInClass plugInName];
+    if (_plugInClass)
+      self.name = [_plugInClass plugInName];
+    else
+      self.name = [[self bundle] objectForInfoDictionaryKey:@"SparkPluginName"] ? : _identifier;
   }
   return _name;
 }
 
 - (NSImage *)icon {
   if (_icon == nil) {
-    self.icon = [_plugInClass plugInIcon];
+    if (_plugInClass) {
+      self.icon = [_plugInClass plugInIcon];
+    } else {
+      NSBundle *bundle = [self bundle];
+      NSString *name = [bundle objectForInfoDictionaryKey:@"SparkPluginIcon"];
+      self.icon = (name ? [NSImage imageNamed:name inBundle:bundle] : nil) ? : [NSImage imageNamed:@"PluginIcon" inBundle:SparkKitBundle()];
+    }
   }
   return _icon;
 }
@@ -175,7 +278,7 @@ void SparkPlugInSetEnabled(NSString *identifier, BOOL enabled) {
   NSBundle *bundle = nil;
   if (self.URL)
     bundle = [NSBundle bundleWithURL:self.URL];
-  if (!bundle)
+  if (!bundle && _plugInClass)
     bundle = [NSBundle bundleForClass:_plugInClass];
   // FIXME: Why is this needed ?
   if (bundle != [NSBundle mainBundle])
@@ -192,7 +295,20 @@ void SparkPlugInSetEnabled(NSString *identifier, BOOL enabled) {
 }
 
 - (NSURL *)helpURL {
-  return [_plugInClass helpURL];
+  if (_plugInClass)
+    return [_plugInClass helpURL];
+
+  NSBundle *bundle = [self bundle];
+  NSString *help = [bundle objectForInfoDictionaryKey:@"SparkHelpFile"];
+  if (help) {
+    NSURL *url = [bundle URLForResource:help withExtension:nil];
+    for (NSString *ext in @[@"html", @"htm", @"rtf", @"rtfd"]) {
+      if (url) break;
+      url = [bundle URLForResource:help withExtension:ext];
+    }
+    return url;
+  }
+  return nil;
 }
 
 - (NSURL *)sdefURL {
@@ -207,9 +323,12 @@ void SparkPlugInSetEnabled(NSString *identifier, BOOL enabled) {
 }
 
 - (id)instantiatePlugIn {
-  NSString *nib = [_plugInClass nibName];
-  NSBundle *bundle = SPXBundleForClass(_plugInClass);
-  SparkActionPlugIn *plugin = [[_plugInClass alloc] initWithNibName:nib bundle:bundle];
+  if (![self load])
+    return nil;
+  Class cls = _plugInClass;
+  NSString *nib = [cls nibName];
+  NSBundle *bundle = SPXBundleForClass(cls);
+  SparkActionPlugIn *plugin = [[cls alloc] initWithNibName:nib bundle:bundle];
   // Make sure the plugin is loaded
   [plugin view];
   return plugin;
@@ -14,6 +14,17 @@
 
 @class SparkAlert;
 
+/*!
+ @enum
+ @abstract What the daemon does with a new event when the action queue is full.
+ */
+typedef NS_ENUM(NSInteger, SparkActionQueuePolicy) {
+  /*! the new event is dropped. */
+  kSparkActionQueuePolicyDrop = 0,
+  /*! the new event replaces the pending event of the same entry if any, else it is dropped. */
+  kSparkActionQueuePolicyCoalesce = 1,
+};
+
 /*!
 @function
  @abstract Returns the system default time interval for repeat keys.
@@ -105,6 +116,12 @@ SPARK_OBJC_EXPORT
 @property (nonatomic, readonly) BOOL supportsConcurrentRequests;
 
 // return a object uses to determine if two actions can be executed concurrently.
+// Actions with equal locks are never executed at the same time (ignored when supportsConcurrentRequests is YES).
 @property (nonatomic, readonly) id lock;
 
+@property (nonatomic, readonly) SparkActionQueuePolicy queuePolicy;
+
+// maximum execution time, used to build the execution context deadline (<= 0 means no deadline). Default is 30 seconds.
+@property (nonatomic, readonly) NSTimeInterval timeout;
+
 @end
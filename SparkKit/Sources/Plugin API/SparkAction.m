@@ -190,6 +190,12 @@ static NSString * const kSparkActionDescriptionKey = @"SADescription";
 - (id)lock {
   return [self class];
 }
+- (SparkActionQueuePolicy)queuePolicy {
+  return kSparkActionQueuePolicyDrop;
+}
+- (NSTimeInterval)timeout {
+  return 30;
+}
 
 //#pragma mark -
 //@implementation SparkAction (SparkExport)
@@ -0,0 +1,68 @@
+/*
+ *  SparkExecutionContext.h
+ *  SparkKit
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+/*!
+ @header SparkExecutionContext
+ @abstract Deadline and cancellation of an action execution.
+ */
+
+#import <SparkKit/SparkKit.h>
+
+#include <CoreServices/CoreServices.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ @abstract   Context of an action execution.
+ @discussion The daemon sets the current context while -[SparkAction performAction] runs.
+ Long running actions should check <i>cancelled</i> and stop when it becomes YES.
+ */
+SPARK_OBJC_EXPORT
+@interface SparkExecutionContext : NSObject
+
+/* Current context (per thread). The context is not retained, the caller must reset it when done */
++ (nullable SparkExecutionContext *)currentContext;
++ (void)setCurrentContext:(nullable SparkExecutionContext *)aContext;
+
+/* timeout <= 0 => no deadline */
+- (instancetype)initWithTimeout:(NSTimeInterval)timeout;
+
+/* Returns a pooled context if available. */
++ (instancetype)contextWithTimeout:(NSTimeInterval)timeout;
+/* Give the context back to the pool used by +contextWithTimeout:.
+ MUST only be called by the last owner of the context, once nothing can cancel it anymore. */
++ (void)recycleContext:(SparkExecutionContext *)aContext;
+
+/* system uptime (-[NSProcessInfo systemUptime]). 0 if no deadline */
+@property(nonatomic, readonly) NSTimeInterval deadline;
+/* negative once the deadline is exceeded, DBL_MAX if no deadline */
+@property(nonatomic, readonly) NSTimeInterval remainingTime;
+
+@property(readonly, getter=isCancelled) BOOL cancelled;
+- (void)cancel;
+
+/* AppleEvent send timeout (ticks) matching the remaining time */
+@property(nonatomic, readonly) long appleEventTimeout;
+
+@end
+
+/*!
+ @function
+ @abstract Returns the AppleEvent timeout of the current context, or kAEDefaultTimeout.
+ */
+SPARK_EXPORT
+long SparkAppleEventTimeout(void);
+
+/*!
+ @function
+ @abstract Sends an AppleEvent and waits for the reply, using SparkAppleEventTimeout().
+ @result Returns the handler error if any.
+ */
+SPARK_EXPORT
+OSStatus SparkAESendEvent(const AppleEvent *anEvent, AppleEvent *reply);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,122 @@
+/*
+ *  SparkExecutionContext.m
+ *  SparkKit
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007 Shadow Lab. All rights reserved.
+ */
+
+#import <SparkKit/SparkExecutionContext.h>
+
+#include <float.h>
+#include <os/lock.h>
+
+/* recycled contexts kept for reuse */
+#define kSparkExecutionContextPoolSize 16
+
+@implementation SparkExecutionContext {
+@private
+  volatile int32_t sp_cancelled;
+}
+
+static __thread __unsafe_unretained SparkExecutionContext *sCurrentContext = nil;
+
++ (SparkExecutionContext *)currentContext {
+  return sCurrentContext;
+}
+
++ (void)setCurrentContext:(SparkExecutionContext *)aContext {
+  sCurrentContext = aContext;
+}
+
+#pragma mark Pool
+static os_unfair_lock sPoolLock = OS_UNFAIR_LOCK_INIT;
+static __strong SparkExecutionContext *sPool[kSparkExecutionContextPoolSize];
+static NSUInteger sPoolCount = 0;
+
++ (void)recycleContext:(SparkExecutionContext *)aContext {
+  if ([aContext class] != [SparkExecutionContext class])
+    return;
+  os_unfair_lock_lock(&sPoolLock);
+  if (sPoolCount < kSparkExecutionContextPoolSize)
+    sPool[sPoolCount++] = aContext;
+  os_unfair_lock_unlock(&sPoolLock);
+}
+
++ (instancetype)contextWithTimeout:(NSTimeInterval)timeout {
+  SparkExecutionContext *ctxt = nil;
+  if (self == [SparkExecutionContext class]) {
+    os_unfair_lock_lock(&sPoolLock);
+    if (sPoolCount > 0) {
+      ctxt = sPool[--sPoolCount];
+      sPool[sPoolCount] = nil;
+    }
+    os_unfair_lock_unlock(&sPoolLock);
+  }
+  if (!ctxt)
+    return [[self alloc] initWithTimeout:timeout];
+  ctxt->_deadline = timeout > 0 ? [[NSProcessInfo processInfo] systemUptime] + timeout : 0;
+  ctxt->sp_cancelled = 0;
+  return ctxt;
+}
+
+- (instancetype)init {
+  return [self initWithTimeout:0];
+}
+
+- (instancetype)initWithTimeout:(NSTimeInterval)timeout {
+  if (self = [super init]) {
+    if (timeout > 0)
+      _deadline = [[NSProcessInfo processInfo] systemUptime] + timeout;
+  }
+  return self;
+}
+
+- (NSString *)description {
+  return [NSString stringWithFormat:@"<%@ %p> { remaining: %f, cancelled: %@ }",
+          [self class], self, self.remainingTime, self.cancelled ? @"YES" : @"NO"];
+}
+
+#pragma mark -
+- (NSTimeInterval)remainingTime {
+  if (_deadline <= 0)
+    return DBL_MAX;
+  return _deadline - [[NSProcessInfo processInfo] systemUptime];
+}
+
+- (BOOL)isCancelled {
+  return sp_cancelled != 0;
+}
+
+- (void)cancel {
+  __sync_bool_compare_and_swap(&sp_cancelled, 0, 1);
+}
+
+- (long)appleEventTimeout {
+  if (_deadline <= 0)
+    return kAEDefaultTimeout;
+  NSTimeInterval remaining = self.remainingTime;
+  if (self.cancelled || remaining <= 0)
+    return 1; // do not wait anymore
+  /* 60 ticks per second */
+  return (long)MIN(remaining * 60, (NSTimeInterval)LONG_MAX);
+}
+
+@end
+
+#pragma mark -
+long SparkAppleEventTimeout(void) {
+  SparkExecutionContext *ctxt = [SparkExecutionContext currentContext];
+  return ctxt ? ctxt.appleEventTimeout : kAEDefaultTimeout;
+}
+
+OSStatus SparkAESendEvent(const AppleEvent *anEvent, AppleEvent *reply) {
+  OSStatus err = AESendMessage(anEvent, reply, kAEWaitReply, SparkAppleEventTimeout());
+  if (noErr == err) {
+    /* handler error */
+    SInt32 herr = noErr;
+    if (noErr == AEGetParamPtr(reply, keyErrorNumber, typeSInt32, NULL, &herr, sizeof(herr), NULL))
+      err = herr;
+  }
+  return err;
+}
@@ -32,6 +32,12 @@ BOOL SparkPreferencesGetBooleanValue(NSString *key, SparkPreferencesDomain domai
 SPARK_EXPORT
 NSInteger SparkPreferencesGetIntegerValue(NSString *key, SparkPreferencesDomain domain);
 
+@class SparkLibrary;
+/* Library domain value of a given library (SparkPreferencesGetValue() uses the active library).
+ Use it from code that may run while a library is loading, with the library of the object. */
+SPARK_EXPORT
+__nullable id SparkPreferencesGetLibraryValue(SparkLibrary * __nullable library, NSString *key);
+
 SPARK_EXPORT
 void SparkPreferencesSetValue(NSString *key, __nullable id value, SparkPreferencesDomain domain);
 SPARK_EXPORT
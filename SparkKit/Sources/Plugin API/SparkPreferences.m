@@ -153,11 +153,15 @@ id SparkPreferencesGetValue(NSString *key, SparkPreferencesDomain domain) {
       return value;
     }
     case SparkPreferencesLibrary:
-      return [SparkActiveLibrary() preferenceValueForKey:key];
+      return SparkPreferencesGetLibraryValue(SparkActiveLibrary(), key);
   }
   SPXThrowException(NSInvalidArgumentException, @"Unsupported preference domain: %ti", domain);
 }
 
+id SparkPreferencesGetLibraryValue(SparkLibrary *library, NSString *key) {
+  return [library preferenceValueForKey:key];
+}
+
 BOOL SparkPreferencesGetBooleanValue(NSString *key, SparkPreferencesDomain domain) {
   return [SparkPreferencesGetValue(key, domain) boolValue];
 }
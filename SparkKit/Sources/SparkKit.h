@@ -20,6 +20,7 @@
 
 #import <SparkKit/SparkAction.h>
 #import <SparkKit/SparkActionPlugIn.h>
+#import <SparkKit/SparkExecutionContext.h>
 
 #import <SparkKit/SparkPluginView.h>
 #import <SparkKit/SparkMultipleAlerts.h>
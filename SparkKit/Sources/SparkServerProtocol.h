@@ -26,8 +26,37 @@
 
 - (NSDistantObject<SparkLibrary> *)library;
 
+/* Runtime metrics, see kSparkMetrics keys */
+- (bycopy NSDictionary *)metrics;
+
 @end
 
+#pragma mark Metrics
+/* Entries and triggers */
+#define kSparkMetricsRegistredHotKeysKey    @"RegistredHotKeys"
+#define kSparkMetricsDispatchTableSizeKey   @"DispatchTableSize" // number of triggers
+#define kSparkMetricsEntriesKey             @"Entries" // dictionary state => count
+#define kSparkMetricsEntryEnabled           @"Enabled"
+#define kSparkMetricsEntryDisabled          @"Disabled"
+#define kSparkMetricsEntryUnplugged         @"Unplugged"
+#define kSparkMetricsEntryRegistred         @"Registred"
+
+/* Execution */
+#define kSparkMetricsExecutionsKey          @"Executions" // dictionary plugin identifier => count
+#define kSparkMetricsQueueDepthKey          @"QueueDepth" // dictionary serialization key => pending events
+#define kSparkMetricsDroppedEventsKey       @"DroppedEvents"
+#define kSparkMetricsCoalescedRepeatsKey    @"CoalescedRepeats" // repeats skipped while the previous one was running
+#define kSparkMetricsFailuresKey            @"Failures" // dictionary action uid => count
+#define kSparkMetricsOverrunsKey            @"Overruns" // dictionary action uid => executions past deadline
+#define kSparkMetricsLatencyP50Key          @"LatencyP50" // seconds
+#define kSparkMetricsLatencyP99Key          @"LatencyP99" // seconds
+#define kSparkMetricsDispatchP50Key         @"DispatchP50" // seconds
+#define kSparkMetricsDispatchP99Key         @"DispatchP99" // seconds
+
+/* Process */
+#define kSparkMetricsLibraryLoadTimeKey     @"LibraryLoadTime" // seconds
+#define kSparkMetricsResidentSizeKey        @"ResidentSize" // bytes
+
 #endif /* __OBJC__ */
 
 #endif /* __SPARK_SERVER_PROTOCOL_H */
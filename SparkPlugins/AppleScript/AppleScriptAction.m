@@ -7,6 +7,7 @@
  */
 
 #import "AppleScriptAction.h"
+#import "AppleScriptCache.h"
 
 #import <OSAKit/OSAKit.h>
 
@@ -14,6 +15,10 @@
 #import <WonderBox/WBFunctions.h>
 #import <WonderBox/NSImage+WonderBox.h>
 
+#import <SparkKit/SparkPrivate.h>
+
+#include <fcntl.h>
+
 static NSString * const kOSAScriptActionDataKey = @"OSAScriptData";
 static NSString * const kOSAScriptActionTypeKey = @"OSAScriptType";
 static NSString * const kOSAScriptActionSourceKey = @"OSAScriptSource";
@@ -26,10 +31,30 @@ NSBundle *AppleScriptActionBundle(void) {
   return bundle;
 }
 
+static
+dispatch_queue_t AppleScriptCompileQueue(void) {
+  static dispatch_queue_t sQueue;
+  static dispatch_once_t sOnce;
+  dispatch_once(&sOnce, ^{
+    sQueue = dispatch_queue_create("org.shadowlab.spark.action.applescript.compile",
+                                   dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+  });
+  return sQueue;
+}
+
 @implementation AppleScriptAction {
 @private
   OSAScript *as_script;
   NSTimeInterval as_repeat;
+  /* compiled script used for execution */
+  OSAScript *as_compiled;
+  /* script file changes observer */
+  dispatch_source_t as_watcher;
+}
+
+- (void)dealloc {
+  if (as_watcher)
+    dispatch_source_cancel(as_watcher);
 }
 
 #pragma mark Protocols Implementation
@@ -57,6 +82,7 @@ NSBundle *AppleScriptActionBundle(void) {
     if (nil != src)
       as_script = [[OSAScript alloc] initWithSource:src];
     as_repeat = [coder decodeDoubleForKey:kOSAScriptActionRepeatInterval];
+    [self precompile];
   }
   return self;
 }
@@ -102,6 +128,8 @@ NSBundle *AppleScriptActionBundle(void) {
           _scriptBookmark = [WBAlias aliasFromData:data];
         case 'bokm':
           _scriptBookmark = [WBAlias aliasFromBookmarkData:data];
+          /* source scripts are precompiled by -setScriptSource: */
+          [self precompile];
           break;
       }
       NSNumber *repeat = [plist objectForKey:kOSAScriptActionRepeatInterval];
@@ -155,14 +183,80 @@ NSBundle *AppleScriptActionBundle(void) {
   return -1; // Repeat Interval.
 }
 
+#pragma mark Compilation
+/* MUST be called with lock held */
+- (OSAScript *)compiledScript:(NSDictionary **)error {
+  if (!as_compiled) {
+    AppleScriptCache *cache = [AppleScriptCache cacheForLibrary:self.library];
+    if (as_script) {
+      as_compiled = [cache compiledScriptWithSource:[as_script source] error:error];
+    } else {
+      NSURL *url = self.URL;
+      if (url) {
+        as_compiled = [cache compiledScriptWithContentsOfURL:url error:error];
+        [self watchScriptFile:url];
+      }
+    }
+  }
+  return as_compiled;
+}
+
+- (void)precompile {
+  dispatch_async(AppleScriptCompileQueue(), ^{
+    @synchronized(self) {
+      NSDictionary *error = nil;
+      if (![self compiledScript:&error] && error)
+        SPXDebug(@"Error while compiling script %@: %@", self.name, error);
+    }
+  });
+}
+
+- (void)invalidateCompiledScript {
+  @synchronized(self) {
+    as_compiled = nil;
+    if (as_watcher) {
+      dispatch_source_cancel(as_watcher);
+      as_watcher = nil;
+    }
+  }
+  /* actions may be added or edited after the library is loaded (sync) */
+  [self precompile];
+}
+
+/* MUST be called with lock held */
+- (void)watchScriptFile:(NSURL *)anURL {
+  if (as_watcher || ![anURL isFileURL])
+    return;
+
+  int fd = open([anURL fileSystemRepresentation], O_EVTONLY);
+  if (fd < 0)
+    return;
+
+  as_watcher = dispatch_source_create(DISPATCH_SOURCE_TYPE_VNODE, fd,
+                                      DISPATCH_VNODE_WRITE | DISPATCH_VNODE_EXTEND | DISPATCH_VNODE_DELETE | DISPATCH_VNODE_RENAME,
+                                      AppleScriptCompileQueue());
+  __weak AppleScriptAction *action = self;
+  dispatch_source_set_event_handler(as_watcher, ^{
+    /* file replaced (atomic save) or edited: the watcher is recreated on next compilation */
+    [action invalidateCompiledScript];
+  });
+  dispatch_source_set_cancel_handler(as_watcher, ^{
+    close(fd);
+  });
+  dispatch_resume(as_watcher);
+}
+
 - (SparkAlert *)performAction {
   NSDictionary *error = nil;
-  if (as_script) {
-    [as_script executeAndReturnError:&error];
-  } else if (self.URL) {
-    as_script = [[OSAScript alloc] initWithContentsOfURL:self.URL error:&error];
-    if (!error)
-      [as_script executeAndReturnError:&error];
+  OSAScript *script = nil;
+  @synchronized(self) {
+    /* compile now if the action was not precompiled yet */
+    script = [self compiledScript:&error];
+  }
+  if (script) {
+    [AppleScriptOSALock() lock];
+    [script executeAndReturnError:&error];
+    [AppleScriptOSALock() unlock];
   }
   SparkAlert *alert = nil;
   if (error) {
@@ -199,6 +293,7 @@ NSBundle *AppleScriptActionBundle(void) {
   } else {
     _scriptBookmark = nil;
   }
+  [self invalidateCompiledScript];
 }
 
 - (NSString *)scriptSource {
@@ -206,11 +301,14 @@ NSBundle *AppleScriptActionBundle(void) {
 }
 
 - (void)setScriptSource:(NSString *)source {
-  if (as_script) {
-    as_script = nil;
+  @synchronized(self) {
+    if (as_script) {
+      as_script = nil;
+    }
+    if (source)
+      as_script = [[OSAScript alloc] initWithSource:source];
   }
-  if (source)
-    as_script = [[OSAScript alloc] initWithSource:source];
+  [self invalidateCompiledScript];
 }
 @end
 
@@ -0,0 +1,155 @@
+/*
+ *  AppleScriptCache.m
+ *  Spark Plugins
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007, Shadow Lab. All rights reserved.
+ */
+
+#import "AppleScriptCache.h"
+#import "AppleScriptAction.h"
+
+#import <SparkKit/SparkLibrary.h>
+
+#import <OSAKit/OSAKit.h>
+#import <CommonCrypto/CommonDigest.h>
+
+static
+NSString *AppleScriptContentHash(NSData *data) {
+  unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+  CC_SHA256(data.bytes, (CC_LONG)data.length, digest);
+  NSMutableString *hash = [[NSMutableString alloc] initWithCapacity:2 * CC_SHA256_DIGEST_LENGTH];
+  for (NSUInteger idx = 0; idx < CC_SHA256_DIGEST_LENGTH; idx++)
+    [hash appendFormat:@"%02x", digest[idx]];
+  return hash;
+}
+
+/* compiled data kept in memory (per library) */
+#define kAppleScriptCacheMemoryLimit (4 * 1024 * 1024)
+
+NSLock *AppleScriptOSALock(void) {
+  static NSLock *sLock;
+  static dispatch_once_t sOnce;
+  dispatch_once(&sOnce, ^{
+    sLock = [[NSLock alloc] init];
+  });
+  return sLock;
+}
+
+@implementation AppleScriptCache {
+@private
+  NSURL *as_folder;
+  /* content hash => compiled data */
+  NSCache *as_scripts;
+}
+
++ (instancetype)cacheForLibrary:(SparkLibrary *)library {
+  static NSMutableDictionary *sCaches = nil;
+  id key = library.uuid ? : [NSNull null];
+  @synchronized(self) {
+    if (!sCaches)
+      sCaches = [[NSMutableDictionary alloc] init];
+    AppleScriptCache *cache = sCaches[key];
+    if (!cache) {
+      NSURL *folder = nil;
+      if (library.uuid) {
+        folder = [[[NSFileManager defaultManager] URLForDirectory:NSCachesDirectory inDomain:NSUserDomainMask
+                                                appropriateForURL:nil create:YES error:NULL]
+                  URLByAppendingPathComponent:[AppleScriptActionBundle() bundleIdentifier]];
+        folder = [folder URLByAppendingPathComponent:[library.uuid UUIDString]];
+      }
+      cache = [[self alloc] initWithFolder:folder];
+      sCaches[key] = cache;
+    }
+    return cache;
+  }
+}
+
+- (instancetype)initWithFolder:(NSURL *)folder {
+  if (self = [super init]) {
+    as_folder = folder;
+    as_scripts = [[NSCache alloc] init];
+    /* edited scripts leave stale entries behind */
+    as_scripts.totalCostLimit = kAppleScriptCacheMemoryLimit;
+    if (as_folder)
+      [[NSFileManager defaultManager] createDirectoryAtURL:as_folder withIntermediateDirectories:YES attributes:nil error:NULL];
+  }
+  return self;
+}
+
+#pragma mark -
+- (NSURL *)URLForKey:(NSString *)key {
+  return [[as_folder URLByAppendingPathComponent:key] URLByAppendingPathExtension:@"scpt"];
+}
+
+- (OSAScript *)scriptForKey:(NSString *)key {
+  NSData *data = [as_scripts objectForKey:key];
+  if (!data && as_folder) {
+    data = [NSData dataWithContentsOfURL:[self URLForKey:key]];
+    if (data)
+      [as_scripts setObject:data forKey:key cost:data.length];
+  }
+  if (data) {
+    NSDictionary *error = nil;
+    [AppleScriptOSALock() lock];
+    OSAScript *script = [[OSAScript alloc] initWithCompiledData:data fromURL:nil usingStorageOptions:OSANull error:&error];
+    [AppleScriptOSALock() unlock];
+    if (script)
+      return script;
+    /* invalid cache entry */
+    SPXDebug(@"Invalid compiled script: %@", error);
+    [as_scripts removeObjectForKey:key];
+    if (as_folder)
+      [[NSFileManager defaultManager] removeItemAtURL:[self URLForKey:key] error:NULL];
+  }
+  return nil;
+}
+
+/* MUST be called with the OSA lock held */
+- (void)setScript:(OSAScript *)script forKey:(NSString *)key {
+  NSData *data = [script compiledDataForType:@"scpt" usingStorageOptions:OSANull error:NULL];
+  if (data) {
+    [as_scripts setObject:data forKey:key cost:data.length];
+    if (as_folder)
+      [data writeToURL:[self URLForKey:key] atomically:YES];
+  }
+}
+
+- (OSAScript *)scriptForKey:(NSString *)key compiler:(OSAScript *(^)(NSDictionary **error))compiler error:(NSDictionary **)error {
+  OSAScript *script = [self scriptForKey:key];
+  if (!script) {
+    [AppleScriptOSALock() lock];
+    script = compiler(error);
+    if (script && [script compileAndReturnError:error])
+      [self setScript:script forKey:key];
+    else
+      script = nil;
+    [AppleScriptOSALock() unlock];
+  }
+  return script;
+}
+
+#pragma mark -
+- (OSAScript *)compiledScriptWithSource:(NSString *)source error:(NSDictionary **)error {
+  NSData *data = [source dataUsingEncoding:NSUTF8StringEncoding];
+  if (!data)
+    return nil;
+  return [self scriptForKey:AppleScriptContentHash(data) compiler:^OSAScript *(NSDictionary **error) {
+    return [[OSAScript alloc] initWithSource:source];
+  } error:error];
+}
+
+- (OSAScript *)compiledScriptWithContentsOfURL:(NSURL *)anURL error:(NSDictionary **)error {
+  NSData *data = [NSData dataWithContentsOfURL:anURL options:NSDataReadingMappedIfSafe error:NULL];
+  if (!data) {
+    [AppleScriptOSALock() lock];
+    OSAScript *script = [[OSAScript alloc] initWithContentsOfURL:anURL error:error];
+    [AppleScriptOSALock() unlock];
+    return script;
+  }
+  return [self scriptForKey:AppleScriptContentHash(data) compiler:^OSAScript *(NSDictionary **error) {
+    return [[OSAScript alloc] initWithContentsOfURL:anURL error:error];
+  } error:error];
+}
+
+@end
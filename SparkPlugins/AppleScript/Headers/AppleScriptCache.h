@@ -0,0 +1,31 @@
+/*
+ *  AppleScriptCache.h
+ *  Spark Plugins
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007, Shadow Lab. All rights reserved.
+ */
+
+#import <SparkKit/SparkKit.h>
+
+@class OSAScript, SparkLibrary;
+
+/* The OSA component is not thread safe: scripts are compiled and executed with this lock held */
+SPARK_PRIVATE
+NSLock *AppleScriptOSALock(void);
+
+/*
+ Compiled scripts cache.
+ Compiled forms are keyed by the hash of the script content, and saved
+ in the user caches folder, in a folder per library. The memory cache is bounded. Thread safe.
+ */
+@interface AppleScriptCache : NSObject
+
+/* nil library => memory only cache */
++ (instancetype)cacheForLibrary:(SparkLibrary *)library;
+
+/* Returns a new compiled script instance */
+- (OSAScript *)compiledScriptWithSource:(NSString *)source error:(NSDictionary **)error;
+- (OSAScript *)compiledScriptWithContentsOfURL:(NSURL *)anURL error:(NSDictionary **)error;
+
+@end
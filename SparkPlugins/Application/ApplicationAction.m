@@ -47,27 +47,30 @@ NSBundle *ApplicationActionBundle(void) {
 
 static bool sInit = false;
 
+/* library may be nil while the active library is loading: do not cache the default values */
 static 
-ApplicationVisualSetting *AAGetSharedSettings(void) {
-  static ApplicationVisualSetting sShared = {NO, NO};
-  if (!sInit) {
+ApplicationVisualSetting *AAGetSharedSettings(SparkLibrary *library) {
+  static ApplicationVisualSetting sShared = {YES, NO};
+  if (!sInit && library) {
     sInit = true;
     
-    NSNumber *value = SparkPreferencesGetValue(@"AAVisualLaunch", SparkPreferencesLibrary);
-    if (!value || [value boolValue])
-      sShared.launch = YES;
-    
-    sShared.activation = SparkPreferencesGetBooleanValue(@"AAVisualActivate", SparkPreferencesLibrary);
+    NSNumber *value = SparkPreferencesGetLibraryValue(library, @"AAVisualLaunch");
+    sShared.launch = !value || [value boolValue];
+    sShared.activation = [SparkPreferencesGetLibraryValue(library, @"AAVisualActivate") boolValue];
   }
   return &sShared;
 }
 
 + (void)getSharedSettings:(ApplicationVisualSetting *)settings {
-  *settings = *AAGetSharedSettings();
+  *settings = *AAGetSharedSettings(SparkActiveLibrary());
+}
+
+- (void)getSharedSettings:(ApplicationVisualSetting *)settings {
+  *settings = *AAGetSharedSettings(self.library);
 }
 
 + (void)setSharedSettings:(ApplicationVisualSetting *)settings {
-  ApplicationVisualSetting *shared = AAGetSharedSettings();
+  ApplicationVisualSetting *shared = AAGetSharedSettings(SparkActiveLibrary());
   if (settings) {
     if (settings->launch != shared->launch)
       SparkPreferencesSetBooleanValue(@"AAVisualLaunch", settings->launch, SparkPreferencesLibrary);
@@ -97,13 +100,13 @@ ApplicationVisualSetting *AAGetSharedSettings(void) {
     if (kSparkContext_Daemon == SparkGetCurrentContext()) {
       SparkPreferencesRegisterObserver(@"AAVisualLaunch", SparkPreferencesLibrary,
                                        ^(NSString *key, id value) {
-                                         ApplicationVisualSetting *shared = AAGetSharedSettings();
+                                         ApplicationVisualSetting *shared = AAGetSharedSettings(SparkActiveLibrary());
                                          shared->launch = [value boolValue];
                                        });
 
       SparkPreferencesRegisterObserver(@"AAVisualActivate", SparkPreferencesLibrary,
                                        ^(NSString *key, id value) {
-                                         ApplicationVisualSetting *shared = AAGetSharedSettings();
+                                         ApplicationVisualSetting *shared = AAGetSharedSettings(SparkActiveLibrary());
                                          shared->activation = [value boolValue];
                                        });
     }
@@ -506,7 +509,7 @@ ApplicationActionType _ApplicationTypeFromTag(int tag) {
     /* Handle visual settings */
     ApplicationVisualSetting settings;
     if ([self usesSharedVisual])
-      [ApplicationAction getSharedSettings:&settings];
+      [self getSharedSettings:&settings];
     else
       [self getVisualSettings:&settings];
 
@@ -528,7 +531,7 @@ ApplicationActionType _ApplicationTypeFromTag(int tag) {
 		/* Handle visual feedback */
 		ApplicationVisualSetting settings;
 		if ([self usesSharedVisual])
-			[ApplicationAction getSharedSettings:&settings];
+			[self getSharedSettings:&settings];
 		else
 			[self getVisualSettings:&settings];
 		
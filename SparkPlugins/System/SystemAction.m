@@ -242,7 +242,33 @@ NSString * const kSystemUserNameKey = @"SystemUserName";
   return NO;
 }
 - (BOOL)supportsConcurrentRequests {
-  return YES;
+  switch ([self action]) {
+    case kSystemVolumeUp:
+    case kSystemVolumeDown:
+    case kSystemVolumeMute:
+    case kSystemBrightnessUp:
+    case kSystemBrightnessDown:
+      return NO;
+    default:
+      return YES;
+  }
+}
+/* volume and brightness steps are relative: serialize them per device */
+- (id)lock {
+  switch ([self action]) {
+    case kSystemVolumeUp:
+    case kSystemVolumeDown:
+    case kSystemVolumeMute:
+      return @"org.shadowlab.spark.system.audio";
+    case kSystemBrightnessUp:
+    case kSystemBrightnessDown:
+      return @"org.shadowlab.spark.system.display";
+    default:
+      return [super lock];
+  }
+}
+- (SparkActionQueuePolicy)queuePolicy {
+  return kSparkActionQueuePolicyCoalesce;
 }
 
 #pragma mark -
@@ -15,6 +15,9 @@
 
 - (void)sendKeystroke:(CGEventSourceRef)src latency:(useconds_t)latency;
 
+/* build reusable events for src. sendKeystroke:latency: posts them when called with the same source */
+- (void)prepareEvents:(CGEventSourceRef)src;
+
 @property(nonatomic, readonly) NSString *shortcut;
 
 @property(nonatomic, readonly) uint64_t rawKey;
@@ -8,6 +8,39 @@
 
 #import "TAKeystroke.h"
 
+#import <Carbon/Carbon.h>
+
+#include <mach/mach_time.h>
+
+/* event timestamps are nanoseconds since startup */
+static
+CGEventTimestamp TAEventTimestampNow(void) {
+  static mach_timebase_info_data_t sTimebase;
+  if (!sTimebase.denom)
+    mach_timebase_info(&sTimebase);
+  return mach_absolute_time() * sTimebase.numer / sTimebase.denom;
+}
+
+static
+void TAPostEvents(CFArrayRef events) {
+  for (CFIndex idx = 0, count = CFArrayGetCount(events); idx < count; idx++) {
+    CGEventRef event = (CGEventRef)CFArrayGetValueAtIndex(events, idx);
+    /* prepared events are reused: they must not carry the time of a previous post */
+    CGEventSetTimestamp(event, TAEventTimestampNow());
+    CGEventPost(kCGHIDEventTap, event);
+  }
+}
+
+static const struct {
+  CGEventFlags flag;
+  CGKeyCode code;
+} sTAModifierKeys[] = {
+  { kCGEventFlagMaskControl, kVK_Control },
+  { kCGEventFlagMaskAlternate, kVK_Option },
+  { kCGEventFlagMaskShift, kVK_Shift },
+  { kCGEventFlagMaskCommand, kVK_Command },
+};
+
 @implementation TAKeystroke {
 @private
   UniChar ta_char;
@@ -15,6 +48,17 @@
   HKModifier ta_modifier;
 
   NSString *_shortcut;
+
+  /* prepared events */
+  CGEventSourceRef ta_source;
+  CFMutableArrayRef ta_down;
+  CFMutableArrayRef ta_up;
+}
+
+- (void)dealloc {
+  if (ta_up) CFRelease(ta_up);
+  if (ta_down) CFRelease(ta_down);
+  if (ta_source) CFRelease(ta_source);
 }
 
 - (void)encodeWithCoder:(NSCoder *)aCoder {
@@ -60,8 +104,53 @@
   return _shortcut;
 }
 
+- (void)prepareEvents:(CGEventSourceRef)src {
+  if (ta_source == src && ta_down)
+    return;
+
+  if (ta_up) CFRelease(ta_up);
+  if (ta_down) CFRelease(ta_down);
+  if (ta_source) CFRelease(ta_source);
+  ta_source = src ? (CGEventSourceRef)CFRetain(src) : NULL;
+  ta_down = CFArrayCreateMutable(kCFAllocatorDefault, 0, &kCFTypeArrayCallBacks);
+  ta_up = CFArrayCreateMutable(kCFAllocatorDefault, 0, &kCFTypeArrayCallBacks);
+
+  /* modifiers down, key down / key up, modifiers up (reverse order) */
+  CGEventFlags flags = 0;
+  for (size_t idx = 0; idx < sizeof(sTAModifierKeys) / sizeof(*sTAModifierKeys); idx++) {
+    if (ta_modifier & sTAModifierKeys[idx].flag) {
+      flags |= sTAModifierKeys[idx].flag;
+      CGEventRef event = CGEventCreateKeyboardEvent(src, sTAModifierKeys[idx].code, true);
+      CGEventSetFlags(event, flags);
+      CFArrayAppendValue(ta_down, event);
+      CFRelease(event);
+
+      event = CGEventCreateKeyboardEvent(src, sTAModifierKeys[idx].code, false);
+      CGEventSetFlags(event, flags & ~sTAModifierKeys[idx].flag);
+      CFArrayInsertValueAtIndex(ta_up, 0, event);
+      CFRelease(event);
+    }
+  }
+  CGEventRef event = CGEventCreateKeyboardEvent(src, ta_code, true);
+  CGEventSetFlags(event, flags);
+  CFArrayAppendValue(ta_down, event);
+  CFRelease(event);
+
+  event = CGEventCreateKeyboardEvent(src, ta_code, false);
+  CGEventSetFlags(event, flags);
+  CFArrayInsertValueAtIndex(ta_up, 0, event);
+  CFRelease(event);
+}
+
 - (void)sendKeystroke:(CGEventSourceRef)src latency:(useconds_t)latency {
-  HKEventPostKeystroke(ta_code, ta_modifier, src, latency);
+  if (!ta_down || ta_source != src) {
+    HKEventPostKeystroke(ta_code, ta_modifier, src, latency);
+    return;
+  }
+  TAPostEvents(ta_down);
+  if (latency > 0)
+    usleep(latency);
+  TAPostEvents(ta_up);
 }
 
 @end
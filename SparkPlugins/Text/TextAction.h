@@ -51,6 +51,9 @@ typedef NS_ENUM(OSType, KeyboardActionType) {
 
 @property(nonatomic) useconds_t latency;
 
+/* UTF-16 units posted per keyboard event. 1 => one keystroke per character, 0 => default */
+@property(nonatomic) NSUInteger chunkSize;
+
 @property(nonatomic) BOOL autorepeat;
 
 @property(nonatomic) KeyboardActionType action;
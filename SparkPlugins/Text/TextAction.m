@@ -18,10 +18,82 @@ NSString * const kKeyboardActionBundleIdentifier = @"org.shadowlab.spark.action.
 /* 500 ms */
 #define kTextActionMaxLatency 500000U
 
+/* CGEventKeyboardSetUnicodeString() limit */
+#define kTextActionMaxChunkSize 20U
+
+/* Bundle identifiers of applications that ignore unicode string events */
+static NSString * const kTextActionCharacterInputApplications = @"TACharacterInputApplications";
+
+static
+BOOL TATargetNeedsCharacterInput(NSRunningApplication *target) {
+  NSString *identifier = target.bundleIdentifier;
+  if (!identifier)
+    return NO;
+  NSArray *applications = SparkPreferencesGetValue(kTextActionCharacterInputApplications, SparkPreferencesDaemon);
+  return [applications isKindOfClass:[NSArray class]] && [applications containsObject:identifier];
+}
+
+/* incremented when the current locale changes */
+static NSUInteger sTALocaleGeneration = 1;
+
+static
+void TAObserveLocaleChanges(void) {
+  static dispatch_once_t sOnce;
+  dispatch_once(&sOnce, ^{
+    [[NSNotificationCenter defaultCenter] addObserverForName:NSCurrentLocaleDidChangeNotification
+                                                      object:nil queue:nil
+                                                  usingBlock:^(NSNotification *note) {
+                                                    __sync_add_and_fetch(&sTALocaleGeneration, 1);
+                                                  }];
+  });
+}
+
+/* control characters (return, tab, …) are not typed by unicode string events */
+WB_INLINE
+BOOL TAIsControlCharacter(UniChar ch) {
+  return ch < 0x20 || 0x7f == ch;
+}
+
+static
+void TAPostUnicodeString(const UniChar *chars, UniCharCount length, pid_t pid, CGEventSourceRef src) {
+  for (int down = 1; down >= 0; down--) {
+    CGEventRef event = CGEventCreateKeyboardEvent(src, 0, down);
+    if (event) {
+      CGEventKeyboardSetUnicodeString(event, length, chars);
+      /* modifiers held by the user must not apply to the text */
+      CGEventSetFlags(event, 0);
+      if (pid > 0)
+        CGEventPostToPid(pid, event);
+      else
+        CGEventPost(kCGHIDEventTap, event);
+      CFRelease(event);
+    }
+  }
+}
+
 @implementation TextAction {
 @private
   BOOL _locked;
   useconds_t _latency;
+  NSUInteger _chunkSize;
+
+  /* cached event source and date formatter */
+  CGEventSourceRef _source;
+  CFDateFormatterRef _formatter;
+  NSUInteger _formatterGeneration;
+}
+
+- (void)dealloc {
+  SPXCFRelease(_formatter);
+  SPXCFRelease(_source);
+}
+
+- (id)init {
+  if (self = [super init]) {
+    /* new actions post text in chunks */
+    _chunkSize = kTextActionMaxChunkSize;
+  }
+  return self;
 }
 
 - (id)copyWithZone:(NSZone *)aZone {
@@ -29,7 +101,10 @@ NSString * const kKeyboardActionBundleIdentifier = @"org.shadowlab.spark.action.
   copy->_action = _action;
 	copy->_autorepeat = _autorepeat;
 	copy->_latency = _latency;
+  copy->_chunkSize = _chunkSize;
   copy->_data = [_data copy];
+  /* keystrokes are shared, and their events are prepared for this source */
+  copy->_source = _source ? (CGEventSourceRef)CFRetain(_source) : NULL;
   return copy;
 }
 
@@ -42,6 +117,8 @@ NSString * const kKeyboardActionBundleIdentifier = @"org.shadowlab.spark.action.
 			[plist setObject:@(_autorepeat) forKey:@"TARepeat"];
     if (_latency > 0)
       [plist setObject:@(_latency) forKey:@"TALatency"];
+    if (_chunkSize > 0)
+      [plist setObject:@(_chunkSize) forKey:@"TAChunkSize"];
     [plist setObject:WBStringForOSType(_action) forKey:@"TAAction"];
     return YES;
   }
@@ -53,6 +130,9 @@ NSString * const kKeyboardActionBundleIdentifier = @"org.shadowlab.spark.action.
 		[self setAutorepeat:[[plist objectForKey:@"TARepeat"] boolValue]];
     [self setAction:WBOSTypeFromString([plist objectForKey:@"TAAction"])];
     [self setLatency:(useconds_t)[[plist objectForKey:@"TALatency"] integerValue]];
+    /* actions saved before chunking was introduced keep typing one character at a time */
+    NSNumber *chunk = [plist objectForKey:@"TAChunkSize"];
+    [self setChunkSize:chunk ? [chunk unsignedIntegerValue] : 1];
     [self setSerializedData:[plist objectForKey:@"TAData"]];
   }
   return self;
@@ -64,7 +144,9 @@ NSString * const kKeyboardActionBundleIdentifier = @"org.shadowlab.spark.action.
     case kTATextAction:
     case kTADateStyleAction:
     case kTADateFormatAction:
+      return nil;
     case kTAKeystrokeAction:
+      /* keystrokes events are built when the keystrokes are set */
       return nil;
     default:
       return [SparkAlert alertWithMessageText:NSLocalizedStringFromTableInBundle(@"INVALID_ACTION_ALERT",
@@ -78,55 +160,107 @@ NSString * const kKeyboardActionBundleIdentifier = @"org.shadowlab.spark.action.
   }
 }
 
+- (CGEventSourceRef)eventSource {
+  if (!_source)
+    _source = HKEventCreatePrivateSource();
+  return _source;
+}
+
+/* returns a formatter configured for the current locale and receiver data */
+- (CFDateFormatterRef)dateFormatter {
+  if (_formatter && _formatterGeneration != sTALocaleGeneration) {
+    CFRelease(_formatter);
+    _formatter = NULL;
+  }
+  if (!_formatter) {
+    TAObserveLocaleChanges();
+    _formatterGeneration = sTALocaleGeneration;
+    CFLocaleRef locale = CFLocaleCopyCurrent();
+    if (kTADateStyleAction == _action) {
+      NSInteger style = [[self data] integerValue];
+      _formatter = CFDateFormatterCreate(kCFAllocatorDefault, locale,
+                                         TADateFormatterStyle(style), TATimeFormatterStyle(style));
+    } else if (kTADateFormatAction == _action && [self data]) {
+      _formatter = CFDateFormatterCreate(kCFAllocatorDefault, locale,
+                                         kCFDateFormatterNoStyle, kCFDateFormatterNoStyle);
+      if (_formatter)
+        CFDateFormatterSetFormat(_formatter, (CFStringRef)[self data]);
+    }
+    SPXCFRelease(locale);
+  }
+  return _formatter;
+}
+
 - (SparkAlert *)simulateText:(NSString *)text {
-  if (text && [text length] > 0) {
-    CGEventSourceRef src = HKEventCreatePrivateSource();
+  NSUInteger length = [text length];
+  if (length > 0) {
+    CGEventSourceRef src = [self eventSource];
     NSAssert(src != nil, @"Invalid event source");
-    /* Use new event API */
-    HKEventTarget target = { .pid = [NSWorkspace.sharedWorkspace frontmostApplication].processIdentifier };
-    for (NSUInteger idx = 0; idx < [text length]; idx++) {
-      HKEventPostCharacterKeystrokesToTarget([text characterAtIndex:idx], target, kHKEventTargetProcess, src, [self latency]);
+    NSRunningApplication *front = [NSWorkspace.sharedWorkspace frontmostApplication];
+    HKEventTarget target = { .pid = front.processIdentifier };
+    useconds_t latency = [self latency];
+    NSUInteger chunk = [self chunkSize];
+    if (chunk > 1 && TATargetNeedsCharacterInput(front))
+      chunk = 1;
+
+    UniChar buffer[kTextActionMaxChunkSize];
+    NSUInteger idx = 0;
+    while (idx < length) {
+      /* never split a grapheme cluster (and so a surrogate pair) */
+      NSRange range = [text rangeOfComposedCharacterSequenceAtIndex:idx];
+      if (TAIsControlCharacter([text characterAtIndex:idx])) {
+        /* "\r\n" is a single cluster */
+        for (NSUInteger ctrl = range.location; ctrl < NSMaxRange(range); ctrl++)
+          HKEventPostCharacterKeystrokesToTarget([text characterAtIndex:ctrl], target, kHKEventTargetProcess, src, latency);
+      } else if (1 == chunk && 1 == range.length) {
+        /* one keystroke per character */
+        HKEventPostCharacterKeystrokesToTarget([text characterAtIndex:idx], target, kHKEventTargetProcess, src, latency);
+      } else if (range.length > kTextActionMaxChunkSize) {
+        /* very long cluster: post it as is */
+        UniChar *chars = malloc(range.length * sizeof(*chars));
+        [text getCharacters:chars range:range];
+        TAPostUnicodeString(chars, range.length, target.pid, src);
+        free(chars);
+        if (latency > 0) usleep(latency);
+      } else {
+        /* grow the chunk with whole clusters */
+        while (1 != chunk && NSMaxRange(range) < length) {
+          NSRange next = [text rangeOfComposedCharacterSequenceAtIndex:NSMaxRange(range)];
+          if (range.length + next.length > chunk || TAIsControlCharacter([text characterAtIndex:next.location]))
+            break;
+          range.length += next.length;
+        }
+        [text getCharacters:buffer range:range];
+        TAPostUnicodeString(buffer, range.length, target.pid, src);
+        if (latency > 0) usleep(latency);
+      }
+      idx = NSMaxRange(range);
     }
-    if (src) CFRelease(src);
   }
   return nil;
 }
 
 - (SparkAlert *)simulateDateStyle {
-  NSInteger style = [[self data] integerValue];
-
-  CFLocaleRef locale = CFLocaleCopyCurrent();
-  CFDateFormatterRef formatter = CFDateFormatterCreate(kCFAllocatorDefault, locale,
-                                                       TADateFormatterStyle(style), TATimeFormatterStyle(style));
-  SPXCFRelease(locale);
-
+  CFDateFormatterRef formatter = [self dateFormatter];
   NSAssert(formatter, @"error while creating date formatter");
   if (formatter) {
     CFStringRef str = CFDateFormatterCreateStringWithAbsoluteTime(kCFAllocatorDefault, formatter, CFAbsoluteTimeGetCurrent());
     NSAssert(str, @"error while formatting date");
     if (str)
       [self simulateText:SPXCFStringBridgingRelease(str)];
-    CFRelease(formatter);
   }
   return nil;
 }
 
 - (SparkAlert *)simulateDateFormat {
-  NSString *format = [self data];
-  if (format) {
-    CFLocaleRef locale = CFLocaleCopyCurrent();
-    CFDateFormatterRef formatter = CFDateFormatterCreate(kCFAllocatorDefault, locale, 
-                                                         kCFDateFormatterNoStyle, kCFDateFormatterNoStyle);
-    SPXCFRelease(locale);
-
+  if ([self data]) {
+    CFDateFormatterRef formatter = [self dateFormatter];
     NSAssert(formatter, @"error while creating date formatter");
     if (formatter) {
-      CFDateFormatterSetFormat(formatter, (CFStringRef)format);
       CFStringRef str = CFDateFormatterCreateStringWithAbsoluteTime(kCFAllocatorDefault, formatter, CFAbsoluteTimeGetCurrent());
       NSAssert(str, @"error while formatting date");
       if (str)
         [self simulateText:SPXCFStringBridgingRelease(str)];
-      CFRelease(formatter);
     }
   }
   return nil;
@@ -134,11 +268,10 @@ NSString * const kKeyboardActionBundleIdentifier = @"org.shadowlab.spark.action.
 
 - (SparkAlert *)simulateKeystroke {
   useconds_t latency = [self latency];
-  CGEventSourceRef src = HKEventCreatePrivateSource();
+  CGEventSourceRef src = [self eventSource];
   for (NSUInteger idx = 0; idx < [_data count]; idx++) {
 		[[_data objectAtIndex:idx] sendKeystroke:src latency:latency];
   }
-  SPXCFRelease(src);
   return nil;
 }
 
@@ -219,6 +352,21 @@ NSString * const kKeyboardActionBundleIdentifier = @"org.shadowlab.spark.action.
   }
 }
 
+- (void)setData:(id)data {
+  if (data != _data) {
+    _data = [data copy];
+    /* formatter depends on data */
+    SPXCFRelease(_formatter);
+    _formatter = NULL;
+    /* build the keystrokes events now (new, synced or edited action) */
+    if (kTAKeystrokeAction == _action) {
+      CGEventSourceRef src = [self eventSource];
+      for (TAKeystroke *stroke in _data)
+        [stroke prepareEvents:src];
+    }
+  }
+}
+
 - (void)setAction:(KeyboardActionType)action {
   if (action != _action) {
     [self setData:nil];
@@ -233,4 +381,11 @@ NSString * const kKeyboardActionBundleIdentifier = @"org.shadowlab.spark.action.
   _latency = MIN(latency, kTextActionMaxLatency);
 }
 
+- (NSUInteger)chunkSize {
+  return _chunkSize > 0 ? _chunkSize : kTextActionMaxChunkSize;
+}
+- (void)setChunkSize:(NSUInteger)chunkSize {
+  _chunkSize = MIN(chunkSize, kTextActionMaxChunkSize);
+}
+
 @end
@@ -127,6 +127,35 @@ CFStringRef iTunesCopyTrackStringProperty(iTunesTrack *track, ITunesTrackPropert
 WB_PRIVATE
 OSStatus iTunesGetTrackIntegerProperty(iTunesTrack *track, ITunesTrackProperty property, int32_t *value);
 
+/* Track info fetched with one event for the track properties, and one for the player properties */
+typedef struct _ITunesTrackInfo {
+  OSType cls;
+  CFStringRef uid; // persistent ID
+  CFStringRef name;
+  CFStringRef album;
+  CFStringRef artist;
+  CFStringRef category;
+  int32_t duration;
+  int32_t rate;
+  /* player */
+  uint32_t position;
+  CFStringRef streamTitle;
+  /* artwork (optional) */
+  CFDataRef artwork;
+  OSType artworkType;
+} ITunesTrackInfo;
+
+WB_PRIVATE
+OSStatus iTunesGetTrackInfo(iTunesTrack *track, bool artwork, ITunesTrackInfo *info);
+WB_PRIVATE
+void iTunesTrackInfoDispose(ITunesTrackInfo *info);
+
+#if defined(__BLOCKS__)
+/* fetch on a background queue. The info is disposed when handler returns */
+WB_PRIVATE
+void iTunesGetTrackInfoAsync(iTunesTrack *track, bool artwork, dispatch_queue_t queue, void (^handler)(OSStatus err, ITunesTrackInfo *info));
+#endif
+
 #pragma mark -
 #pragma mark Playlists
 WB_PRIVATE
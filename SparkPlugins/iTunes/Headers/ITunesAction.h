@@ -53,6 +53,8 @@ enum {
 @interface ITunesAction : SparkAction <NSCoding, NSCopying>
 
 + (ITunesVisual *)defaultVisual;
+/* shared visual stored in library preferences */
++ (const ITunesVisual *)defaultVisualForLibrary:(SparkLibrary *)library;
 + (void)setDefaultVisual:(const ITunesVisual *)visual;
 
 @property(nonatomic) int32_t rating;
@@ -35,7 +35,7 @@ const NSPoint kiTunesBottomRight;
 WB_PRIVATE
 const ITunesVisual kiTunesDefaultSettings;
 
-@class ITunesStarView, ITunesProgressView;
+@class ITunesStarView, ITunesProgressView, ITunesCachedTrack;
 @interface ITunesInfo : NSWindowController <NSWindowDelegate>
 
 + (ITunesInfo *)sharedWindow;
@@ -43,6 +43,10 @@ const ITunesVisual kiTunesDefaultSettings;
 - (IBAction)display:(id)sender;
 
 - (void)setTrack:(iTunesTrack *)track visual:(const ITunesVisual *)visual;
+/* info can be NULL */
+- (void)setTrackInfo:(const ITunesTrackInfo *)info visual:(const ITunesVisual *)visual;
+/* track can be nil. position is the player position */
+- (void)setCachedTrack:(ITunesCachedTrack *)track position:(uint32_t)position visual:(const ITunesVisual *)visual;
 
 /* Settings */
 - (void)getVisual:(ITunesVisual *)visual;
@@ -0,0 +1,68 @@
+/*
+ *  ITunesTrackCache.h
+ *  Spark Plugins
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007, Shadow Lab. All rights reserved.
+ */
+
+#import "ITunesAESuite.h"
+
+/* Track info ready to display: text fields and decoded, pre-scaled artwork */
+@interface ITunesCachedTrack : NSObject
+
+/* safe to call on any thread */
+- (instancetype)initWithTrackInfo:(const ITunesTrackInfo *)info artworkSize:(NSSize)size scale:(CGFloat)scale;
+
+@property(nonatomic, readonly) NSString *uid;
+
+@property(nonatomic, readonly, getter=isRadio) BOOL radio;
+
+/* display values (stream title, radio name and category for radios) */
+@property(nonatomic, readonly) NSString *name;
+@property(nonatomic, readonly) NSString *album;
+@property(nonatomic, readonly) NSString *artist;
+
+@property(nonatomic, readonly) SInt32 duration;
+@property(nonatomic, readonly) SInt32 rate;
+
+/* YES if the artwork was requested, even if the track does not have one */
+@property(nonatomic, readonly) BOOL hasArtwork;
+@property(nonatomic, readonly) NSImage *artwork;
+
+/* estimated memory size in bytes */
+@property(nonatomic, readonly) NSUInteger cost;
+
+@end
+
+/*
+ Bounded LRU cache of displayed tracks, keyed by persistent ID.
+ Radio tracks are never cached as the stream title changes while playing.
+ Thread safe.
+ */
+@interface ITunesTrackCache : NSObject
+
++ (ITunesTrackCache *)sharedCache;
+
+/* maximum memory size in bytes (default 8 MB) */
+@property(nonatomic) NSUInteger capacity;
+@property(nonatomic, readonly) NSUInteger size;
+
+/* artwork are scaled to fit this size (in points) */
+@property(nonatomic) NSSize artworkSize;
+/* backing scale factor used to render the artwork (default 1) */
+@property(nonatomic) CGFloat artworkScale;
+/* set artworkScale from the main screen. MUST be called on the main thread */
+- (void)updateArtworkScale;
+
+/* returns nil if not cached */
+- (ITunesCachedTrack *)trackForUID:(NSString *)uid;
+/* decode the info and cache it if possible */
+- (ITunesCachedTrack *)trackWithInfo:(const ITunesTrackInfo *)info;
+
+- (void)removeAllTracks;
+
+/* prefill the cache when the player changes track */
+- (void)startObservingPlayer;
+
+@end
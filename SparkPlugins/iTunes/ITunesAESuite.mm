@@ -8,6 +8,8 @@
 
 #include "ITunesAESuite.h"
 
+#import <SparkKit/SparkExecutionContext.h>
+
 CFStringRef const kiTunesBundleIdentifier = CFSTR("com.apple.iTunes");
 
 static 
@@ -21,15 +23,65 @@ OSStatus _iTunesCreateEvent(AEEventClass cls, AEEventID method, AppleEvent *even
   return WBAECreateEventWithTargetBundleID(kiTunesBundleIdentifier, cls, method, event);
 }
 
+#pragma mark Send
+/* Events waiting for a reply are bounded by the execution context deadline */
+static
+OSStatus _iTunesSendEventReturnAEDesc(AppleEvent *event, DescType type, AEDesc *result) {
+  wb::AppleEvent reply;
+  OSStatus err = SparkAESendEvent(event, &reply);
+  if (noErr != err) return err;
+
+  return AEGetParamDesc(&reply, keyDirectObject, type, result);
+}
+
+static
+OSStatus _iTunesSendEventReturnData(AppleEvent *event, DescType type, void *data, Size size) {
+  wb::AppleEvent reply;
+  OSStatus err = SparkAESendEvent(event, &reply);
+  if (noErr != err) return err;
+
+  return AEGetParamPtr(&reply, keyDirectObject, type, NULL, data, size, NULL);
+}
+
 WB_INLINE
-OSStatus _WBAESendEventReturnBool(AppleEvent* pAppleEvent, bool* pValue) {
+OSStatus _iTunesSendEventReturnBool(AppleEvent* pAppleEvent, bool* pValue) {
   Boolean b;
-  OSStatus err = WBAESendEventReturnBoolean(pAppleEvent, &b);
+  OSStatus err = _iTunesSendEventReturnData(pAppleEvent, typeBoolean, &b, sizeof(b));
   if (noErr == err && pValue)
     *pValue = b != FALSE;
   return err;
 }
 
+static
+CFStringRef _iTunesSendEventReturnString(AppleEvent *event, WBAEError error) {
+  wb::AEError<CFStringRef> res(error);
+  wb::AEDesc desc;
+  OSStatus err = _iTunesSendEventReturnAEDesc(event, typeWildCard, &desc);
+  if (noErr != err) return res(err);
+
+  return WBAECopyStringFromDescriptor(&desc, error);
+}
+
+static
+CFDataRef _iTunesSendEventReturnCFData(AppleEvent *event, DescType type, OSType *actualType, WBAEError error) {
+  wb::AEError<CFDataRef> res(error);
+  wb::AEDesc desc;
+  OSStatus err = _iTunesSendEventReturnAEDesc(event, type, &desc);
+  if (noErr != err) return res(err);
+
+  if (actualType)
+    *actualType = desc.descriptorType;
+  Size size = AEGetDescDataSize(&desc);
+  CFMutableDataRef data = CFDataCreateMutable(kCFAllocatorDefault, size);
+  CFDataSetLength(data, size);
+  err = AEGetDescData(&desc, CFDataGetMutableBytePtr(data), size);
+  if (noErr != err) {
+    CFRelease(data);
+    return res(err);
+  }
+  return data;
+}
+
 static
 CFStringRef _iTunesCopyObjectStringProperty(AEDesc *object, AEKeyword property, WBAEError pError) {
   wb::AppleEvent theEvent;
@@ -44,7 +96,7 @@ CFStringRef _iTunesCopyObjectStringProperty(AEDesc *object, AEKeyword property,
   if (noErr != err)
     return res(err);
   
-  return WBAESendEventReturnString(&theEvent, pError);
+  return _iTunesSendEventReturnString(&theEvent, pError);
 }
 
 static
@@ -58,7 +110,7 @@ OSStatus _iTunesGetObjectIntegerProperty(AEDesc *object, AEKeyword property, SIn
   err = WBAEAddPropertyObjectSpecifier(&theEvent, keyDirectObject, typeSInt32, property, object);
   if (noErr != err) return err;
   
-  return WBAESendEventReturnSInt32(&theEvent, value);
+  return _iTunesSendEventReturnData(&theEvent, typeSInt32, value, sizeof(*value));
 }
 
 #pragma mark -
@@ -72,7 +124,7 @@ OSStatus iTunesGetPlayerState(ITunesState *state) {
   err = WBAEAddPropertyObjectSpecifier(&theEvent, keyDirectObject, typeProperty, 'pPlS', NULL);
   if (noErr != err) return err;
 	
-  return WBAESendEventReturnData(&theEvent, typeEnumerated, NULL, state, sizeof(OSType), NULL);
+  return _iTunesSendEventReturnData(&theEvent, typeEnumerated, state, sizeof(OSType));
 }
 
 OSStatus iTunesGetPlayerPosition(UInt32 *position) {
@@ -83,7 +135,7 @@ OSStatus iTunesGetPlayerPosition(UInt32 *position) {
   err = WBAEAddPropertyObjectSpecifier(&theEvent, keyDirectObject, typeProperty, 'pPos', NULL);
   if (noErr != err) return err;
   
-  return WBAESendEventReturnUInt32(&theEvent, position);
+  return _iTunesSendEventReturnData(&theEvent, typeUInt32, position, sizeof(*position));
 }
 
 OSStatus iTunesGetVisualEnabled(bool *state) {
@@ -94,7 +146,7 @@ OSStatus iTunesGetVisualEnabled(bool *state) {
   err = WBAEAddPropertyObjectSpecifier(&theEvent, keyDirectObject, typeProperty, 'pVsE', NULL);
   if (noErr != err) return err;
   
-  return _WBAESendEventReturnBool(&theEvent, state);
+  return _iTunesSendEventReturnBool(&theEvent, state);
 }
 
 OSStatus iTunesSetVisualEnabled(bool state) {
@@ -119,7 +171,7 @@ OSStatus iTunesIsMuted(bool *mute) {
   err = WBAEAddPropertyObjectSpecifier(&theEvent, keyDirectObject, typeProperty,'pMut', NULL);
   if (noErr != err) return err;
   
-  return _WBAESendEventReturnBool(&theEvent, mute);
+  return _iTunesSendEventReturnBool(&theEvent, mute);
 }
 
 OSStatus iTunesSetMuted(bool mute) {
@@ -144,7 +196,7 @@ OSStatus iTunesGetSoundVolume(SInt16 *volume) {
   err = WBAEAddPropertyObjectSpecifier(&theEvent, keyDirectObject, typeProperty,'pVol', NULL);
   if (noErr != err) return err;
   
-  return WBAESendEventReturnSInt16(&theEvent, volume);
+  return _iTunesSendEventReturnData(&theEvent, typeSInt16, volume, sizeof(*volume));
 }
 
 OSStatus iTunesSetSoundVolume(SInt16 volume) {
@@ -170,7 +222,7 @@ CFStringRef iTunesCopyCurrentStreamTitle(WBAEError error) {
   err = WBAEAddPropertyObjectSpecifier(&theEvent, keyDirectObject, typeProperty, 'pStT', NULL);
   if (noErr != err) return res(err);
   
-  return WBAESendEventReturnString(&theEvent, error);
+  return _iTunesSendEventReturnString(&theEvent, error);
 }
 
 #pragma mark -
@@ -185,7 +237,7 @@ OSStatus iTunesGetObjectType(AEDesc *obj, OSType *cls) {
   if (noErr != err) return err;
 
   wb::AEDesc reply;
-  err = WBAESendEventReturnAEDesc(&theEvent, typeType, &reply);
+  err = _iTunesSendEventReturnAEDesc(&theEvent, typeType, &reply);
   if (noErr != err) return err;
   
   return AEGetDescData(&reply, cls, sizeof(*cls));
@@ -219,7 +271,7 @@ OSStatus iTunesGetTrackRate(iTunesTrack *track, UInt32 *rate) {
   err = WBAEAddPropertyObjectSpecifier(&theEvent, keyDirectObject, typeSInt16, kiTunesRateKey, track);
   if (noErr != err) return err;
   
-  return WBAESendEventReturnUInt32(&theEvent, rate);
+  return _iTunesSendEventReturnData(&theEvent, typeUInt32, rate, sizeof(*rate));
 }
 
 OSStatus iTunesGetCurrentTrack(iTunesTrack *track) {
@@ -233,7 +285,7 @@ OSStatus iTunesGetCurrentTrack(iTunesTrack *track) {
   if (noErr != err) return err;
   
   /* Do not force return type to 'cTrk', because iTunes returns a 'cTrk' subclass */
-  return WBAESendEventReturnAEDesc(&theEvent, typeWildCard, track);
+  return _iTunesSendEventReturnAEDesc(&theEvent, typeWildCard, track);
 }
 
 OSStatus iTunesSetCurrentTrackRate(UInt32 rate) {
@@ -271,13 +323,101 @@ CFDataRef iTunesCopyTrackArtworkData(iTunesTrack *track, OSType *type, WBAEError
   err = WBAEAddPropertyObjectSpecifier(&aevt, keyDirectObject, typePict, 'pPCT', &artwork);
   if (noErr != err) return res(err);
   
-  return WBAESendEventReturnCFData(&aevt, typeWildCard, type, error);
+  return _iTunesSendEventReturnCFData(&aevt, typeWildCard, type, error);
 }
 
 OSStatus iTunesGetTrackIntegerProperty(iTunesTrack *track, ITunesTrackProperty property, SInt32 *value) {
   return _iTunesGetObjectIntegerProperty(track, property, value);
 }
 
+#pragma mark Track Info
+/* get properties of 'object' (a record) */
+static
+OSStatus _iTunesGetObjectProperties(AEDesc *object, AERecord *properties) {
+  wb::AppleEvent theEvent;
+  /* tell application "iTunes" to get ... */
+  OSStatus err = _iTunesCreateEvent(kAECoreSuite, kAEGetData, &theEvent);
+  if (noErr != err) return err;
+
+  /* ... properties of 'object' */
+  err = WBAEAddPropertyObjectSpecifier(&theEvent, keyDirectObject, typeAERecord, pALL, object);
+  if (noErr != err) return err;
+
+  return _iTunesSendEventReturnAEDesc(&theEvent, typeAERecord, properties);
+}
+
+static
+CFStringRef _iTunesCopyRecordString(AERecord *record, AEKeyword key) {
+  wb::AEDesc desc;
+  if (noErr != AEGetKeyDesc(record, key, typeWildCard, &desc) || typeType == desc.descriptorType) // missing value
+    return NULL;
+  return WBAECopyStringFromDescriptor(&desc, NULL);
+}
+
+OSStatus iTunesGetTrackInfo(iTunesTrack *track, bool artwork, ITunesTrackInfo *info) {
+  bzero(info, sizeof(*info));
+
+  wb::AEDesc record;
+  OSStatus err = _iTunesGetObjectProperties(track, &record);
+  if (noErr != err) return err;
+
+  AEGetKeyPtr(&record, pClass, typeType, NULL, &info->cls, sizeof(info->cls), NULL);
+  AEGetKeyPtr(&record, kiTunesDurationKey, typeSInt32, NULL, &info->duration, sizeof(info->duration), NULL);
+  AEGetKeyPtr(&record, kiTunesRateKey, typeSInt32, NULL, &info->rate, sizeof(info->rate), NULL);
+  info->uid = _iTunesCopyRecordString(&record, kiTunesPersistentID);
+  info->name = _iTunesCopyRecordString(&record, kiTunesNameKey);
+  info->album = _iTunesCopyRecordString(&record, kiTunesAlbumKey);
+  info->artist = _iTunesCopyRecordString(&record, kiTunesArtistKey);
+  info->category = _iTunesCopyRecordString(&record, kiTunesCategoryKey);
+
+  /* player properties (position and stream title) */
+  wb::AEDesc player;
+  if (noErr == _iTunesGetObjectProperties(NULL, &player)) {
+    AEGetKeyPtr(&player, 'pPos', typeUInt32, NULL, &info->position, sizeof(info->position), NULL);
+    if ('cURT' == info->cls)
+      info->streamTitle = _iTunesCopyRecordString(&player, 'pStT');
+  }
+
+  if (artwork)
+    info->artwork = iTunesCopyTrackArtworkData(track, &info->artworkType, NULL);
+
+  return noErr;
+}
+
+void iTunesTrackInfoDispose(ITunesTrackInfo *info) {
+  SPXCFRelease(info->uid);
+  SPXCFRelease(info->name);
+  SPXCFRelease(info->album);
+  SPXCFRelease(info->artist);
+  SPXCFRelease(info->category);
+  SPXCFRelease(info->streamTitle);
+  SPXCFRelease(info->artwork);
+  bzero(info, sizeof(*info));
+}
+
+void iTunesGetTrackInfoAsync(iTunesTrack *track, bool artwork, dispatch_queue_t queue, void (^handler)(OSStatus err, ITunesTrackInfo *info)) {
+  AEDesc copy = WBAEEmptyDesc();
+  OSStatus err = AEDuplicateDesc(track, &copy);
+  if (noErr != err) {
+    dispatch_async(queue, ^{ handler(err, NULL); });
+    return;
+  }
+  /* keep the caller deadline */
+  SparkExecutionContext *ctxt = [SparkExecutionContext currentContext];
+  dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+    AEDesc desc = copy;
+    __block ITunesTrackInfo info;
+    [SparkExecutionContext setCurrentContext:ctxt];
+    OSStatus status = iTunesGetTrackInfo(&desc, artwork, &info);
+    [SparkExecutionContext setCurrentContext:nil];
+    AEDisposeDesc(&desc);
+    dispatch_async(queue, ^{
+      handler(status, noErr == status ? &info : NULL);
+      iTunesTrackInfoDispose(&info);
+    });
+  });
+}
+
 #pragma mark -
 #pragma mark Playlists
 OSStatus iTunesPlayPlaylist(iTunesPlaylist *playlist) {
@@ -322,7 +462,7 @@ OSStatus iTunesGetCurrentPlaylist(iTunesPlaylist *playlist) {
   err = WBAEAddPropertyObjectSpecifier(&theEvent, keyDirectObject, 'cPly', 'pPla', NULL);
   if (noErr != err) return err;
   
-  return WBAESendEventReturnAEDesc(&theEvent, typeWildCard, playlist);
+  return _iTunesSendEventReturnAEDesc(&theEvent, typeWildCard, playlist);
 }
 
 WB_INLINE
@@ -367,7 +507,7 @@ OSStatus iTunesGetPlaylistWithID(SInt64 uid, iTunesPlaylist *playlist) {
   if (noErr != err) return err;
 
   wb::AEDescList list;
-  err = WBAESendEventReturnAEDescList(&theEvent, &list);
+  err = _iTunesSendEventReturnAEDesc(&theEvent, typeAEList, &list);
   if (noErr != err) return err;
   
   long count = 0;
@@ -390,7 +530,7 @@ OSStatus iTunesGetPlaylistWithName(CFStringRef name, iTunesPlaylist *playlist) {
   err = WBAEAddNameObjectSpecifier(&theEvent, keyDirectObject, 'cPly', name, nullptr);
   if (noErr != err) return err;
   
-  return WBAESendEventReturnAEDesc(&theEvent, typeWildCard, playlist);
+  return _iTunesSendEventReturnAEDesc(&theEvent, typeWildCard, playlist);
 }
 
 CFStringRef iTunesCopyPlaylistStringProperty(iTunesPlaylist *playlist, AEKeyword property, WBAEError error) {
@@ -413,7 +553,7 @@ OSStatus iTunesGetPlaylistShuffle(iTunesPlaylist *playlist, bool *shuffle) {
   err = WBAEAddPropertyObjectSpecifier(&theEvent, keyDirectObject, typeProperty, 'pShf', playlist);
   if (noErr != err) return err;
   
-  return _WBAESendEventReturnBool(&theEvent, shuffle);
+  return _iTunesSendEventReturnBool(&theEvent, shuffle);
 }
 
 static
@@ -508,7 +648,7 @@ OSStatus __iTunesGetPlaylistsProperty(AEDesc *playlists, DescType type, AEKeywor
   err = WBAEAddPropertyObjectSpecifier(&theEvent, keyDirectObject, type, property, playlists);
   if (noErr != err) return err;
 	
-  return WBAESendEventReturnAEDescList(&theEvent, properties);
+  return _iTunesSendEventReturnAEDesc(&theEvent, typeAEList, properties);
 }
 
 static
@@ -526,7 +666,7 @@ OSStatus _iTunesPlaylistIsSmart(UInt32 id, bool *smart) {
   err = WBAEAddPropertyObjectSpecifier(&theEvent, keyDirectObject, typeBoolean, 'pSmt', &playlist);
   if (noErr != err) return err;
   
-  return _WBAESendEventReturnBool(&theEvent, smart);
+  return _iTunesSendEventReturnBool(&theEvent, smart);
 }
 
 CFArrayRef iTunesCopyPlaylistNames(WBAEError error) {
@@ -7,6 +7,9 @@
  */
 
 #import "ITunesAction.h"
+#import "ITunesTrackCache.h"
+
+#import <SparkKit/SparkPrivate.h>
 
 #import <WonderBox/WBFunctions.h>
 #import <WonderBox/WBAEFunctions.h>
@@ -67,16 +70,24 @@ iTunesAction _iTunesConvertAction(int act) {
 
 static ITunesVisual sDefaultVisual = { .delay = -1 };
 + (ITunesVisual *)defaultVisual {
+  return [self defaultVisualForLibrary:SparkActiveLibrary()];
+}
+
+/* library may be nil while the active library is loading: do not cache the default values */
++ (const ITunesVisual *)defaultVisualForLibrary:(SparkLibrary *)library {
   if (sDefaultVisual.delay >= 0) {
     return &sDefaultVisual;
+  } else if (!library) {
+    return &kiTunesDefaultSettings;
   } else {
     @synchronized(self) {
       if (sDefaultVisual.delay < 0) {
-        NSData *data = SparkPreferencesGetValue(@"iTunesSharedVisual", SparkPreferencesLibrary);
+        NSData *data = SparkPreferencesGetLibraryValue(library, @"iTunesSharedVisual");
         if (data) {
           if (!ITunesVisualUnpack(data, &sDefaultVisual)) {
             SPXDebug(@"Invalid shared visual: %@", data);
-            SparkPreferencesSetValue(@"iTunesSharedVisual", nil, SparkPreferencesLibrary);
+            if (library == SparkActiveLibrary())
+              SparkPreferencesSetValue(@"iTunesSharedVisual", nil, SparkPreferencesLibrary);
           }
         }
       }
@@ -319,13 +330,16 @@ static ITunesVisual sDefaultVisual = { .delay = -1 };
     case kiTunesNextTrack:
     case kiTunesBackTrack:
     case kiTunesStop:
-    case kiTunesShowTrackInfo:
     case kiTunesVisual:
     case kiTunesVolumeDown:
     case kiTunesVolumeUp:
     case kiTunesToggleMute:
     case kiTunesEjectCD:
       return nil;
+    case kiTunesShowTrackInfo:
+      /* prefill the track cache on track change */
+      [[ITunesTrackCache sharedCache] startObservingPlayer];
+      return nil;
     case kiTunesPlayPlaylist:
       //TODO: Check if playlist exist.
       return nil;
@@ -365,19 +379,35 @@ static ITunesVisual sDefaultVisual = { .delay = -1 };
   //if ([SparkAction currentEventTime] > 0 || (absTime - sLastDisplayTime) > 0.25) {
   iTunesTrack track = WBAEEmptyDesc();
   if (noErr == iTunesGetCurrentTrack(&track)) {
-    ITunesInfo *info = [ITunesInfo sharedWindow];
-    switch ([self visualMode]) {
-      case kiTunesSettingCustom:
-        if (ia_visual) {
-          [info setTrack:&track visual:ia_visual];
-          break;
-        }
-        // fall
-      case kiTunesSettingDefault:
-        [info setTrack:&track visual:[[self class] defaultVisual]];
-        break;
+    const ITunesVisual *visual = [[self class] defaultVisualForLibrary:self.library];
+    if (kiTunesSettingCustom == [self visualMode] && ia_visual)
+      visual = ia_visual;
+    ITunesVisual settings = *visual;
+    /* served from memory if the track was already displayed or prefetched */
+    ITunesTrackCache *cache = [ITunesTrackCache sharedCache];
+    CFStringRef uid = iTunesCopyTrackStringProperty(&track, kiTunesPersistentID, NULL);
+    ITunesCachedTrack *cached = [cache trackForUID:SPXCFToNSString(uid)];
+    SPXCFRelease(uid);
+    if (cached && (cached.hasArtwork || !settings.artwork)) {
+      uint32_t position = 0;
+      iTunesGetPlayerPosition(&position);
+      dispatch_async(dispatch_get_main_queue(), ^{
+        ITunesInfo *info = [ITunesInfo sharedWindow];
+        [info setCachedTrack:cached position:position visual:&settings];
+        [info display:nil];
+      });
+    } else {
+      /* fetch all track info at once, decode it in background, and display when done */
+      iTunesGetTrackInfoAsync(&track, settings.artwork, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(OSStatus err, ITunesTrackInfo *trackInfo) {
+        ITunesCachedTrack *decoded = trackInfo ? [cache trackWithInfo:trackInfo] : nil;
+        uint32_t position = trackInfo ? trackInfo->position : 0;
+        dispatch_async(dispatch_get_main_queue(), ^{
+          ITunesInfo *info = [ITunesInfo sharedWindow];
+          [info setCachedTrack:decoded position:position visual:&settings];
+          [info display:nil];
+        });
+      });
     }
-    [info display:nil];
     WBAEDisposeDesc(&track);
   }
   //}
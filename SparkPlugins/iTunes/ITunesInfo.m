@@ -9,6 +9,7 @@
 #import "ITunesInfo.h"
 #import "ITunesAction.h"
 #import "ITunesStarView.h"
+#import "ITunesTrackCache.h"
 #import "ITunesProgressView.h"
 
 #import <WonderBox/WBGradient.h>
@@ -217,6 +218,8 @@ BOOL ITunesVisualIsEqualTo(const ITunesVisual *v1, const ITunesVisual *v2) {
   if (self = [super initWithWindow:info]) {
     [kiTunesActionBundle loadNibNamed:@"iTunesInfo" owner:self topLevelObjects:NULL];
 		NSAssert(_ibArtwork, @"nib not loaded ?");
+    [ITunesTrackCache sharedCache].artworkSize = [_ibArtwork bounds].size;
+    [[ITunesTrackCache sharedCache] updateArtworkScale];
     [self setVisual:&kiTunesDefaultSettings];
 		[info setDelegate:self];
   }
@@ -356,96 +359,57 @@ void __iTunesGetColorComponents(NSColor *color, CGFloat rgba[]) {
 }
 
 - (void)setTrack:(iTunesTrack *)track visual:(const ITunesVisual *)visual {
-  OSType cls = 0;
-  CFStringRef value = NULL;
-  
+  /* visual defines whether the artwork is fetched */
+  [self setVisual:visual];
+  ITunesTrackInfo info;
+  if (track && noErr == iTunesGetTrackInfo(track, _displayArtwork, &info)) {
+    [self setTrackInfo:&info visual:visual];
+    iTunesTrackInfoDispose(&info);
+  } else {
+    [self setTrackInfo:NULL visual:visual];
+  }
+}
+
+- (void)setTrackInfo:(const ITunesTrackInfo *)info visual:(const ITunesVisual *)visual {
+  ITunesCachedTrack *track = info ? [[ITunesTrackCache sharedCache] trackWithInfo:info] : nil;
+  [self setCachedTrack:track position:info ? info->position : 0 visual:visual];
+}
+
+- (void)setCachedTrack:(ITunesCachedTrack *)track position:(uint32_t)position visual:(const ITunesVisual *)visual {
 	/* should be call first */
 	[self setVisual:visual];
-	
-  if (track)
-    iTunesGetObjectType(track, &cls);
-  
+
   /* Track Name */
-  if (track) {
-    if ('cURT' == cls)
-      value = iTunesCopyCurrentStreamTitle(NULL); /* current stream title */
-    else
-      value = iTunesCopyTrackStringProperty(track, kiTunesNameKey, NULL);
-  }
-  if (value) {
-    [_ibName setStringValue:SPXCFStringBridgingRelease(value)];
-    value = NULL;
+  if (track.name) {
+    [_ibName setStringValue:track.name];
   } else {
     [_ibName setStringValue:NSLocalizedStringFromTableInBundle(@"<untiled>", nil, kiTunesActionBundle, @"Untitled track info")];
   }
-  
-  /* Album */
-  if (track) {
-    if ('cURT' == cls)
-      value = iTunesCopyTrackStringProperty(track, kiTunesNameKey, NULL); /* radio name */
-    else
-      value = iTunesCopyTrackStringProperty(track, kiTunesAlbumKey, NULL);
-  }
-  if (value) {
-    [_ibAlbum setStringValue:SPXCFStringBridgingRelease(value)];
-    value = NULL;
-  } else {
-    [_ibAlbum setStringValue:@""];
-  }
-  
-  /* Artist */
-  if (track) {
-    if ('cURT' == cls)
-      value = iTunesCopyTrackStringProperty(track, kiTunesCategoryKey, NULL); /* category not available for radio */
-    else
-      value = iTunesCopyTrackStringProperty(track, kiTunesArtistKey, NULL);
-  }
-  
-  if (value) {
-    [_ibArtist setStringValue:SPXCFStringBridgingRelease(value)];
-    value = NULL;
-  } else {
-    [_ibArtist setStringValue:@""];
-  }
-  
+
+  /* Album (radio name) */
+  [_ibAlbum setStringValue:track.album ? : @""];
+
+  /* Artist (category not available for radio) */
+  [_ibArtist setStringValue:track.artist ? : @""];
+
   /* Time and rate */
-  SInt32 duration = 0, rate = 0;
-  if (track) {
-    if ('cURT' == cls) {
-      iTunesGetPlayerPosition((UInt32 *)&duration); /* duration not available for radio */
-    } else {
-      iTunesGetTrackIntegerProperty(track, kiTunesDurationKey, &duration);
-      iTunesGetTrackIntegerProperty(track, kiTunesRateKey, &rate);
-    }
-  }
-  [self setDuration:duration rate:rate];
-  
-  if ('cURT' == cls) {
+  SInt32 duration = track.duration;
+  [self setDuration:duration rate:track.rate];
+
+  if (!track || track.radio || duration <= 0) {
     [_ibProgress setProgress:0];
   } else {
-    UInt32 progress = 0;
-    spx_verify_noerr(iTunesGetPlayerPosition(&progress));
-    if (duration > 0)
-      [_ibProgress setProgress:(CGFloat)progress / duration];
-    else
-      [_ibProgress setProgress:0];
+    [_ibProgress setProgress:(CGFloat)position / duration];
   }
-	
-	/* Image */
+
+	/* Image (already decoded and scaled) */
 	BOOL display = NO;
 	[_ibArtwork setImage:nil];
-	if (track && _displayArtwork) {
-    OSType type;
-		CFDataRef data = NULL;
-		if ((data = iTunesCopyTrackArtworkData(track, &type, NULL))) {
-			NSImage *image = [[NSImage alloc] initWithData:SPXCFDataBridgingRelease(data)];
-			if (image) {
-				// display image zone
-				[self setArtworkVisible:YES];
-				[_ibArtwork setImage:image];
-				display = YES;
-			}
-		}
+	if (track.artwork && _displayArtwork) {
+    // display image zone
+    [self setArtworkVisible:YES];
+    [_ibArtwork setImage:track.artwork];
+    display = YES;
 	}
 	[self setArtworkVisible:display];
 }
@@ -0,0 +1,298 @@
+/*
+ *  ITunesTrackCache.m
+ *  Spark Plugins
+ *
+ *  Created by Black Moon Team.
+ *  Copyright (c) 2004 - 2007, Shadow Lab. All rights reserved.
+ */
+
+#import "ITunesTrackCache.h"
+
+#import <WonderBox/WBAEFunctions.h>
+
+#include <ImageIO/ImageIO.h>
+#import <objc/runtime.h>
+
+@implementation ITunesCachedTrack {
+@package
+  /* LRU list, owned by the cache */
+  __unsafe_unretained ITunesCachedTrack *ia_prev;
+  __unsafe_unretained ITunesCachedTrack *ia_next;
+}
+
+/* ImageIO and CoreGraphics only, so it can run on any thread */
+static
+NSImage *_ITunesScaledArtwork(CFDataRef data, NSSize size, CGFloat scale, NSUInteger *cost) {
+  CGImageSourceRef source = CGImageSourceCreateWithData(data, NULL);
+  if (!source)
+    return nil;
+
+  CGImageRef img = NULL;
+  NSSize dest = NSZeroSize;
+  CFDictionaryRef props = CGImageSourceCopyPropertiesAtIndex(source, 0, NULL);
+  if (props) {
+    CGFloat width = 0, height = 0;
+    CFNumberRef value = CFDictionaryGetValue(props, kCGImagePropertyPixelWidth);
+    if (value) CFNumberGetValue(value, kCFNumberCGFloatType, &width);
+    value = CFDictionaryGetValue(props, kCGImagePropertyPixelHeight);
+    if (value) CFNumberGetValue(value, kCFNumberCGFloatType, &height);
+    CFRelease(props);
+
+    if (width > 0 && height > 0 && size.width > 0 && size.height > 0) {
+      /* keep ratio */
+      CGFloat ratio = MIN(size.width / width, size.height / height);
+      dest = NSMakeSize(round(width * ratio), round(height * ratio));
+      /* render for retina screens */
+      NSDictionary *options = @{
+        (id)kCGImageSourceCreateThumbnailFromImageAlways: @YES,
+        (id)kCGImageSourceCreateThumbnailWithTransform: @YES,
+        (id)kCGImageSourceThumbnailMaxPixelSize: @(MAX(dest.width, dest.height) * scale),
+      };
+      img = CGImageSourceCreateThumbnailAtIndex(source, 0, SPXNSToCFDictionary(options));
+    }
+  }
+  /* no size to fit */
+  if (!img && NSEqualSizes(dest, NSZeroSize))
+    img = CGImageSourceCreateImageAtIndex(source, 0, NULL);
+  CFRelease(source);
+  if (!img)
+    return nil;
+
+  NSImage *image = [[NSImage alloc] initWithCGImage:img size:dest];
+  *cost += CGImageGetBytesPerRow(img) * CGImageGetHeight(img);
+  CGImageRelease(img);
+  return image;
+}
+
+- (instancetype)initWithTrackInfo:(const ITunesTrackInfo *)info artworkSize:(NSSize)size scale:(CGFloat)scale {
+  NSParameterAssert(info);
+  if (self = [super init]) {
+    _radio = 'cURT' == info->cls;
+    _uid = SPXCFToNSString(info->uid);
+    if (_radio) {
+      _name = SPXCFToNSString(info->streamTitle);
+      _album = SPXCFToNSString(info->name);
+      _artist = SPXCFToNSString(info->category);
+      /* duration not available for radio */
+      _duration = (SInt32)info->position;
+    } else {
+      _name = SPXCFToNSString(info->name);
+      _album = SPXCFToNSString(info->album);
+      _artist = SPXCFToNSString(info->artist);
+      _duration = info->duration;
+      _rate = info->rate;
+    }
+    _cost = class_getInstanceSize([self class]) + 2 * ([_uid length] + [_name length] + [_album length] + [_artist length]);
+    if (info->artwork) {
+      _hasArtwork = YES;
+      _artwork = _ITunesScaledArtwork(info->artwork, size, scale, &_cost);
+    }
+  }
+  return self;
+}
+
+@end
+
+#pragma mark -
+@implementation ITunesTrackCache {
+@private
+  NSMutableDictionary *ia_tracks;
+  /* most recently used first */
+  __unsafe_unretained ITunesCachedTrack *ia_head;
+  __unsafe_unretained ITunesCachedTrack *ia_tail;
+  BOOL ia_observing;
+  NSString *ia_prefetching;
+}
+
+@synthesize capacity = _capacity;
+
++ (ITunesTrackCache *)sharedCache {
+  static ITunesTrackCache *shared = nil;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    shared = [[ITunesTrackCache alloc] init];
+  });
+  return shared;
+}
+
+- (instancetype)init {
+  if (self = [super init]) {
+    _capacity = 8 * 1024 * 1024;
+    _artworkSize = NSMakeSize(256, 256);
+    _artworkScale = 1;
+    ia_tracks = [[NSMutableDictionary alloc] init];
+  }
+  return self;
+}
+
+- (void)dealloc {
+  if (ia_observing)
+    [[NSDistributedNotificationCenter defaultCenter] removeObserver:self];
+}
+
+#pragma mark LRU
+/* MUST be called while locked */
+- (void)unlink:(ITunesCachedTrack *)track {
+  if (track->ia_prev) track->ia_prev->ia_next = track->ia_next;
+  else ia_head = track->ia_next;
+  if (track->ia_next) track->ia_next->ia_prev = track->ia_prev;
+  else ia_tail = track->ia_prev;
+  track->ia_prev = track->ia_next = nil;
+}
+
+- (void)pushFront:(ITunesCachedTrack *)track {
+  track->ia_next = ia_head;
+  if (ia_head) ia_head->ia_prev = track;
+  ia_head = track;
+  if (!ia_tail) ia_tail = track;
+}
+
+- (void)evict {
+  while (_size > _capacity && ia_tail) {
+    ITunesCachedTrack *last = ia_tail;
+    [self unlink:last];
+    _size -= last.cost;
+    [ia_tracks removeObjectForKey:last.uid];
+  }
+}
+
+#pragma mark -
+- (void)setCapacity:(NSUInteger)capacity {
+  @synchronized(self) {
+    _capacity = capacity;
+    [self evict];
+  }
+}
+
+- (NSUInteger)capacity {
+  @synchronized(self) {
+    return _capacity;
+  }
+}
+
+- (void)setArtworkSize:(NSSize)size {
+  @synchronized(self) {
+    if (!NSEqualSizes(size, _artworkSize)) {
+      _artworkSize = size;
+      /* scaled for an other size */
+      [self removeAllTracks];
+    }
+  }
+}
+
+- (void)setArtworkScale:(CGFloat)scale {
+  @synchronized(self) {
+    if (scale > 0 && scale != _artworkScale) {
+      _artworkScale = scale;
+      [self removeAllTracks];
+    }
+  }
+}
+
+- (void)updateArtworkScale {
+  NSAssert([NSThread isMainThread], @"MUST be called on the main thread");
+  self.artworkScale = [[NSScreen mainScreen] backingScaleFactor] ? : 1;
+}
+
+- (ITunesCachedTrack *)trackForUID:(NSString *)uid {
+  if (!uid) return nil;
+  @synchronized(self) {
+    ITunesCachedTrack *track = ia_tracks[uid];
+    if (track && track != ia_head) {
+      [self unlink:track];
+      [self pushFront:track];
+    }
+    return track;
+  }
+}
+
+- (ITunesCachedTrack *)trackWithInfo:(const ITunesTrackInfo *)info {
+  NSSize size;
+  CGFloat scale;
+  @synchronized(self) {
+    size = _artworkSize;
+    scale = _artworkScale;
+  }
+  /* decode outside of the lock */
+  ITunesCachedTrack *track = [[ITunesCachedTrack alloc] initWithTrackInfo:info artworkSize:size scale:scale];
+  if (track.radio || !track.uid)
+    return track;
+
+  @synchronized(self) {
+    if (track.cost > _capacity)
+      return track;
+    ITunesCachedTrack *previous = ia_tracks[track.uid];
+    if (previous) {
+      [self unlink:previous];
+      _size -= previous.cost;
+    }
+    ia_tracks[track.uid] = track;
+    [self pushFront:track];
+    _size += track.cost;
+    [self evict];
+  }
+  return track;
+}
+
+- (void)removeAllTracks {
+  @synchronized(self) {
+    ia_head = ia_tail = nil;
+    [ia_tracks removeAllObjects];
+    _size = 0;
+  }
+}
+
+#pragma mark Prefetching
+- (void)startObservingPlayer {
+  @synchronized(self) {
+    if (ia_observing) return;
+    ia_observing = YES;
+  }
+  /* the screen can not be queried from the prefetching queue */
+  if ([NSThread isMainThread]) {
+    [self updateArtworkScale];
+  } else {
+    dispatch_async(dispatch_get_main_queue(), ^{
+      [self updateArtworkScale];
+    });
+  }
+  [[NSDistributedNotificationCenter defaultCenter] addObserver:self
+                                                      selector:@selector(playerInfoDidChange:)
+                                                          name:@"com.apple.iTunes.playerInfo"
+                                                        object:@"com.apple.iTunes.player"
+                                            suspensionBehavior:NSNotificationSuspensionBehaviorDeliverImmediately];
+}
+
+- (void)playerInfoDidChange:(NSNotification *)aNotification {
+  NSDictionary *info = [aNotification userInfo];
+  if (![info[@"Player State"] isEqual:@"Playing"])
+    return;
+  /* persistent ID is reported as a 64 bits integer, but scripting uses its hexadecimal representation */
+  NSNumber *pid = info[@"PersistentID"];
+  if (![pid isKindOfClass:[NSNumber class]])
+    return;
+  NSString *uid = [NSString stringWithFormat:@"%016llX", [pid unsignedLongLongValue]];
+  @synchronized(self) {
+    if (ia_tracks[uid] || [uid isEqualToString:ia_prefetching])
+      return;
+    ia_prefetching = uid;
+  }
+
+  iTunesTrack track = WBAEEmptyDesc();
+  if (noErr == iTunesGetCurrentTrack(&track)) {
+    iTunesGetTrackInfoAsync(&track, true, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^(OSStatus err, ITunesTrackInfo *trackInfo) {
+      if (noErr == err && trackInfo)
+        [self trackWithInfo:trackInfo];
+      @synchronized(self) {
+        self->ia_prefetching = nil;
+      }
+    });
+    WBAEDisposeDesc(&track);
+  } else {
+    @synchronized(self) {
+      ia_prefetching = nil;
+    }
+  }
+}
+
+@end